@@ -1419,3 +1419,1542 @@ TEST(ut_xpjson, zh_cn)
 		ASSERT_TRUE(false);
 	}
 }
+
+TEST(ut_xpjson, sso)
+{
+	try {
+		ASSERT_TRUE(sizeof(JSON::Value) == JSON::detail::json_sso<char>::size);
+		ASSERT_TRUE(JSON::detail::json_sso<char>::capacity >= 14);
+
+		for(size_t l = 0; l < 20; ++l) {
+			string str(l, 'a');
+			JSON::Value v(str, AUTO_DETECT, false);
+			ASSERT_TRUE(v._sso == (l <= JSON::detail::json_sso<char>::capacity));
+			ASSERT_TRUE(v.length() == l);
+			ASSERT_TRUE(v == str);
+
+			JSON::Value v1(v);
+			ASSERT_TRUE(v1._sso == v._sso);
+			ASSERT_TRUE(v1 == str);
+
+			string out;
+			v1.write(out);
+			ASSERT_TRUE(out == "\"" + str + "\"");
+		}
+
+		// sso -> string -> sso
+		JSON::Value v("short", AUTO_DETECT, false);
+		ASSERT_TRUE(v._sso);
+		v.s() += " but not short any more";
+		ASSERT_FALSE(v._sso);
+		v.assign("short", AUTO_DETECT, false);
+		ASSERT_TRUE(v._sso);
+		ASSERT_TRUE(v == string("short"));
+
+		// sso is preferred to dma
+		const char* sz = "abc";
+		v.assign(sz, AUTO_DETECT, true);
+		ASSERT_TRUE(v._sso && !v._dma);
+		string long_str(JSON::detail::json_sso<char>::capacity + 1, 'a');
+		v.assign(long_str, AUTO_DETECT, true);
+		ASSERT_TRUE(!v._sso && v._dma);
+		ASSERT_TRUE(v.c_str() == long_str.c_str());
+		v.clear(JSON::STRING);
+		ASSERT_TRUE(v._sso && v.length() == 0);
+
+		// escaped string read into sso, encoded again on write
+		string in("[\"a\\nb\",\"\\u0041\"]");
+		v.read(in);
+		ASSERT_TRUE(v[0]._sso && v[0]._e);
+		ASSERT_TRUE(v[0] == string("a\nb"));
+		ASSERT_TRUE(v[1] == string("A"));
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == "[\"a\\nb\",\"A\"]");
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, share)
+{
+	try {
+		JSON::Value v;
+		string in("{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}");
+		v.read(in);
+		ASSERT_FALSE(v.shared());
+
+		// deep copy if not shared
+		JSON::Value copy(v);
+		ASSERT_TRUE(copy._o != v._o);
+
+		v.share();
+		ASSERT_TRUE(v.shared());
+		ASSERT_TRUE(v._o->_refs == 1);
+		const JSON::Value& cv = v;
+		ASSERT_TRUE(cv.o().find("a")->second.shared());
+
+		// O(1) copy
+		JSON::Value v1(v);
+		ASSERT_TRUE(v1._o == v._o);
+		ASSERT_TRUE(v._o->_refs == 2);
+		JSON::Value v2;
+		v2 = v;
+		ASSERT_TRUE(v2._o == v._o);
+		ASSERT_TRUE(v._o->_refs == 3);
+		ASSERT_TRUE(v2 == v);
+
+		// copy on write, only the path is copied
+		const JSON::Value* e = &cv.o().find("e")->second;
+		v1["a"]["b"][0] = 100;
+		ASSERT_TRUE(v1._o != v._o);
+		ASSERT_TRUE(v._o->_refs == 2);
+		ASSERT_FALSE(v1.shared());
+		ASSERT_TRUE(v1.o().find("e")->second._a == e->_a);
+		ASSERT_TRUE(e->_a->_refs == 2);
+		ASSERT_TRUE(cv.o().find("a")->second.o().find("b")->second.a()[0] == 1);
+		ASSERT_TRUE(v1["a"]["b"][0] == 100);
+		ASSERT_TRUE(v != v1);
+
+		// mutable access of the last owner does not copy
+		v2.clear();
+		ASSERT_TRUE(v._o->_refs == 1);
+		JSON::Object* o = v._o;
+		v["g"] = 1;
+		ASSERT_TRUE(v._o == o);
+		ASSERT_FALSE(v.shared());
+
+		// share again, copy and assign containers
+		v.share();
+		JSON::Value v3(JSON::ARRAY);
+		v3.a().push_back(v);
+		v3.a().push_back(v);
+		ASSERT_TRUE(v._o->_refs == 3);
+		v3.clear(JSON::ARRAY);
+		ASSERT_TRUE(v._o->_refs == 1);
+		v3 = v;
+		v3.clear(JSON::OBJECT);
+		ASSERT_TRUE(v3.o().empty());
+		ASSERT_TRUE(v._o->_refs == 1);
+		ASSERT_TRUE(v["g"] == 1);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+inline long& ut_alloc_live() {static long n = 0; return n;}
+
+template<class T>
+struct ut_counting_allocator : public std::allocator<T>
+{
+	template<class U> struct rebind {typedef ut_counting_allocator<U> other;};
+	ut_counting_allocator() {}
+	template<class U> ut_counting_allocator(const ut_counting_allocator<U>&) {}
+	T* allocate(size_t n, const void* = 0) {++ut_alloc_live(); return std::allocator<T>::allocate(n);}
+	void deallocate(T* p, size_t n) {--ut_alloc_live(); std::allocator<T>::deallocate(p, n);}
+};
+
+TEST(ut_xpjson, allocator)
+{
+	try {
+		typedef JSON::ValueT<char, ut_counting_allocator<char> > CValue;
+		ASSERT_TRUE(sizeof(CValue) == sizeof(JSON::Value));
+		{
+			CValue v;
+			const char* s = "{\"a\":[1,2.5,\"a long string which exceeds sso\"],\"b\":{\"c\":\"\\u4e2d\"},\"d\":null}";
+			v.read(s, strlen(s), false);
+			ASSERT_TRUE(ut_alloc_live() > 0);
+			ASSERT_TRUE(v["a"][2] == string("a long string which exceeds sso"));
+			ASSERT_TRUE(v["a"][1].get<string>(string()) == "2.5");
+			CValue::tstring out;
+			v.write(out);
+			ASSERT_TRUE(out == "{\"a\":[1,2.5,\"a long string which exceeds sso\"],\"b\":{\"c\":\"\xe4\xb8\xad\"},\"d\":null}");
+
+			CValue v1(v);
+			v1["a"].a().push_back(CValue(JSON::OBJECT));
+			v1.share();
+			CValue v2(v1);
+			ASSERT_TRUE(v1 == v2);
+			v2["e"].s() = out;
+		}
+		ASSERT_TRUE(ut_alloc_live() == 0);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, memory_usage)
+{
+	try {
+		JSON::Value v;
+		const char* s = "{\"a\":\"short\",\"b\":\"a long string which exceeds sso\",\"c\":[1,2,null],\"d\":{\"e\":true}}";
+		v.read(s, strlen(s));
+		JSON::MemoryUsage mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::NIL] == 1);
+		ASSERT_TRUE(mu.count[JSON::BOOLEAN] == 1);
+		ASSERT_TRUE(mu.count[JSON::INTEGER] == 2);
+		ASSERT_TRUE(mu.count[JSON::STRING] == 2);
+		ASSERT_TRUE(mu.count[JSON::OBJECT] == 2);
+		ASSERT_TRUE(mu.count[JSON::ARRAY] == 1);
+		ASSERT_TRUE(mu.sso_count == 1);
+		ASSERT_TRUE(mu.dma_bytes == strlen("a long string which exceeds sso"));
+		ASSERT_TRUE(mu.string_bytes == 0);
+		ASSERT_TRUE(mu.key_bytes == 0);
+		ASSERT_TRUE(mu.shared_bytes == 0);
+		ASSERT_TRUE(mu.container_bytes == 2 * sizeof(JSON::Object) + 5 * (sizeof(JSON::Object::value_type) + JSON::detail::json_map_node_overhead())
+			+ sizeof(JSON::Array) + JSON::detail::json_deque_heap<JSON::Value>(3));
+		ASSERT_TRUE(mu.heap_bytes() == mu.container_bytes);
+
+		// owned string and long key
+		v["f"].s() = string(40, 'x');
+		v[string(40, 'k')] = 1;
+		mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::STRING] == 3);
+		ASSERT_TRUE(mu.string_bytes >= sizeof(string) + 41);
+		ASSERT_TRUE(mu.key_bytes >= 41);
+
+		// shared subtree, accumulated
+		JSON::MemoryUsage sum;
+		v["d"].share();
+		v.memory_usage(sum);
+		v.memory_usage(sum);
+		ASSERT_TRUE(sum.count[JSON::OBJECT] == 4);
+		ASSERT_TRUE(sum.heap_bytes() == 2 * mu.heap_bytes());
+		ASSERT_TRUE(sum.shared_bytes == 2 * (sizeof(JSON::Object) + sizeof(JSON::Object::value_type) + JSON::detail::json_map_node_overhead()));
+		v.share();
+		mu = v.memory_usage();
+		ASSERT_TRUE(mu.shared_bytes == mu.heap_bytes());
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, pointer)
+{
+	try {
+		JSON::Value v;
+		// example of RFC 6901
+		const char* s = "{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8,\"01\":9}";
+		v.read(s, strlen(s));
+		ASSERT_TRUE(JSON::Pointer("").get(v) == &v);
+		ASSERT_TRUE(*JSON::Pointer("/foo").get(v) == v["foo"]);
+		ASSERT_TRUE(*JSON::Pointer("/foo/0").get(v) == string("bar"));
+		ASSERT_TRUE(*JSON::Pointer("/").get(v) == 0);
+		ASSERT_TRUE(*JSON::Pointer("/a~1b").get(v) == 1);
+		ASSERT_TRUE(*JSON::Pointer("/c%d").get(v) == 2);
+		ASSERT_TRUE(*JSON::Pointer("/e^f").get(v) == 3);
+		ASSERT_TRUE(*JSON::Pointer("/g|h").get(v) == 4);
+		ASSERT_TRUE(*JSON::Pointer("/i\\j").get(v) == 5);
+		ASSERT_TRUE(*JSON::Pointer("/k\"l").get(v) == 6);
+		ASSERT_TRUE(*JSON::Pointer("/ ").get(v) == 7);
+		ASSERT_TRUE(*JSON::Pointer("/m~0n").get(v) == 8);
+		ASSERT_TRUE(*JSON::Pointer("/01").get(v) == 9);
+
+		// not found, nothing inserted
+		const size_t size = v.o().size();
+		JSON::Pointer p("/foo/2");
+		ASSERT_TRUE(p.size() == 2 && p[0] == "foo" && p[1] == "2");
+		ASSERT_TRUE(p.get(v) == NULL);
+		ASSERT_TRUE(JSON::Pointer("/foo/01").get(v) == NULL);
+		ASSERT_TRUE(JSON::Pointer("/foo/-").get(v) == NULL);
+		ASSERT_TRUE(JSON::Pointer("/x/y").get(v) == NULL);
+		ASSERT_TRUE(JSON::Pointer("/a~1b/c").get(v) == NULL);
+		ASSERT_TRUE(v.o().size() == size);
+
+		// compile once, resolve many, copy on write by mutable access
+		v.share();
+		JSON::Value v1(v);
+		JSON::Pointer p1("/foo/1");
+		const JSON::Value& cv = v1;
+		ASSERT_TRUE(p1.get(cv) == p1.get(static_cast<const JSON::Value&>(v)));
+		*p1.get(v1) = "qux";
+		ASSERT_TRUE(*p1.get(cv) == string("qux"));
+		ASSERT_TRUE(v["foo"][1] == string("baz"));
+
+		// invalid pointers
+		ASSERT_THROW(JSON::Pointer("foo"), std::logic_error);
+		ASSERT_THROW(JSON::Pointer("/foo~"), std::logic_error);
+		ASSERT_THROW(JSON::Pointer("/foo~2"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, path)
+{
+	try {
+		JSON::Value v;
+		const char* s = "{\"store\":{\"book\":["
+			"{\"category\":\"reference\",\"author\":\"Nigel Rees\",\"title\":\"Sayings of the Century\",\"price\":8.95},"
+			"{\"category\":\"fiction\",\"author\":\"Evelyn Waugh\",\"title\":\"Sword of Honour\",\"price\":12.99},"
+			"{\"category\":\"fiction\",\"author\":\"Herman Melville\",\"title\":\"Moby Dick\",\"isbn\":\"0-553-21311-3\",\"price\":8.99},"
+			"{\"category\":\"fiction\",\"author\":\"J. R. R. Tolkien\",\"title\":\"The Lord of the Rings\",\"isbn\":\"0-395-19395-8\",\"price\":22}],"
+			"\"bicycle\":{\"color\":\"red\",\"price\":19.95}}}";
+		v.read(s, strlen(s));
+		vector<const JSON::Value*> r;
+
+		ASSERT_TRUE(JSON::Path("$").first(v) == &v);
+		ASSERT_TRUE(JSON::Path("$.store.book[*].author").select(v, r) == 4);
+		ASSERT_TRUE(*r[0] == string("Nigel Rees") && *r[3] == string("J. R. R. Tolkien"));
+		ASSERT_TRUE(r[1] == &v["store"]["book"][1]["author"]);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..author").select(v, r) == 4);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$.store.*").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$.store..price").select(v, r) == 5);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[2].title").select(v, r) == 1 && *r[0] == string("Moby Dick"));
+		ASSERT_TRUE(*JSON::Path("$..book[-1].price").first(v) == 22);
+		ASSERT_TRUE(*JSON::Path("$['store'][\"bicycle\"]['color']").first(v) == string("red"));
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$.store.bicycle['color','price']").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[0,1].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[:2].title").select(v, r) == 2 && *r[1] == string("Sword of Honour"));
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[1:].title").select(v, r) == 3);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[-2:].title").select(v, r) == 2 && *r[0] == string("Moby Dick"));
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[::-2].title").select(v, r) == 2 && *r[0] == string("The Lord of the Rings"));
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[?(@.isbn)].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[?(@.price < 10)].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[?(@.price >= 12.99)]").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[?(@.category == 'fiction')].author").select(v, r) == 3);
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[?(@.category != \"fiction\")].author").select(v, r) == 1 && *r[0] == string("Nigel Rees"));
+		r.clear();
+		ASSERT_TRUE(JSON::Path("$..book[*].price[?(@ == 22)]").select(v, r) == 0);
+		ASSERT_TRUE(JSON::Path("$..*").select(v, r) == 27);
+		r.clear();
+
+		// limit & short-circuit
+		ASSERT_TRUE(JSON::Path("$..price").select(v, r, 2) == 2 && r.size() == 2);
+		ASSERT_TRUE(JSON::Path("$.store.book[9]").first(v) == NULL);
+		ASSERT_TRUE(JSON::Path("$.nothing.here").first(v) == NULL);
+
+		// invalid expressions
+		ASSERT_THROW(JSON::Path("store"), std::logic_error);
+		ASSERT_THROW(JSON::Path("$.store["), std::logic_error);
+		ASSERT_THROW(JSON::Path("$.a[::0]"), std::logic_error);
+		ASSERT_THROW(JSON::Path("$.a[?(@.b = 1)]"), std::logic_error);
+		ASSERT_THROW(JSON::Path("$.a[?(@.b == x)]"), std::logic_error);
+		ASSERT_THROW(JSON::Path("$.a['b]"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, read_mask)
+{
+	try {
+		const char* s = "{\"id\":7,\"name\":\"a long name of the document\",\"skip\":{\"x\":[1,{\"y\":\"}]\\\"\"}],\"z\":-1.5e3},"
+			"\"user\":{\"name\":\"u\",\"age\":30,\"tags\":[\"a\",\"b\"]},\"items\":[{\"price\":1,\"n\":\"x\"},{\"price\":2.5,\"n\":\"y\"},{\"n\":\"z\"}],"
+			"\"list\":[10,20,30,40],\"k\\u0065y\":true,\"nil\":null}";
+		JSON::Mask mask;
+		mask.add("/id").add("/user/name").add("/items/*/price").add("/list/2").add("/key").add("/nil").add("/missing/x");
+		JSON::Value v;
+		ASSERT_TRUE(v.read(s, strlen(s), mask) == strlen(s));
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == "{\"id\":7,\"items\":[{\"price\":1},{\"price\":2.5},{}],\"key\":true,\"list\":[null,null,30],\"nil\":null,\"user\":{\"name\":\"u\"}}");
+
+		// name matches before wildcard, whole subtree
+		JSON::Mask mask1;
+		mask1.add("/items/1").add("/items/*/n").add("/user").add("/user/name").add("/skip/x/1/y");
+		v.read(s, strlen(s), mask1);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == "{\"items\":[{\"n\":\"x\"},{\"n\":\"y\",\"price\":2.5},{\"n\":\"z\"}],\"skip\":{\"x\":[null,{\"y\":\"}]\\\"\"}]},\"user\":{\"age\":30,\"name\":\"u\",\"tags\":[\"a\",\"b\"]}}");
+
+		// empty pointer includes the whole document
+		JSON::Mask all;
+		all.add("");
+		JSON::Value v1, v2;
+		JSON::Reader::read(v1, s, strlen(s), all);
+		v2.read(s, strlen(s));
+		ASSERT_TRUE(v1 == v2);
+
+		// empty mask
+		JSON::Mask none;
+		ASSERT_TRUE(v.read(" [1,[2,{\"a\":\"]\"}],3] ", 21, none) == 20);
+		ASSERT_TRUE(v.type() == JSON::ARRAY && v.a().empty());
+
+		ASSERT_THROW(v.read("{\"id\":[1,2}", 11, none), std::logic_error);
+		ASSERT_THROW(v.read("{\"id\":\"1}", 9, none), std::logic_error);
+		ASSERT_THROW(v.read("{\"id\" 1}", 8, mask), std::logic_error);
+		ASSERT_THROW(v.read("{\"id\":1 \"a\":2}", 14, mask), std::logic_error);
+		ASSERT_THROW(v.read("1", 1, mask), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, skip_raw)
+{
+	try {
+		// quotes, escapes and brackets inside strings, long enough for simd
+		const char* s = "  {\"a\":[1,2,{\"b\":\"x]}\\\\\\\"{[\"}],\"long string without any structural character\":\"\\\"\\\\\",\"c\":[[[[]]]]} ,1";
+		const size_t end = strlen(s) - 3; // " ,1" follows
+		ASSERT_TRUE(JSON::skip(s, strlen(s)) == end);
+		ASSERT_TRUE(JSON::skip("\"abc\\\"\" ", 8) == 7);
+		ASSERT_TRUE(JSON::skip(" -12.5e3,", 9) == 8);
+		ASSERT_TRUE(JSON::skip("true]", 5) == 4);
+		ASSERT_TRUE(JSON::skip("[]", 2) == 2);
+		ASSERT_THROW(JSON::skip("{\"a\":[1,2}", 10), std::logic_error);
+		ASSERT_THROW(JSON::skip("[\"a\\\"]", 6), std::logic_error);
+		ASSERT_THROW(JSON::skip("\"a\\", 3), std::logic_error);
+
+		// raw value is written verbatim
+		JSON::Value v;
+		v["a"] = 1;
+		v["b"].raw(s + 2, end - 2);
+		ASSERT_TRUE(v["b"].type() == JSON::RAW);
+		ASSERT_TRUE(v["b"].length() == end - 2 && v["b"].c_str() == s + 2);
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == "{\"a\":1,\"b\":" + string(s + 2, end - 2) + "}");
+		JSON::Value v1(v);
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1["b"].get<string>(string()) == string(s + 2, end - 2));
+		JSON::Value parsed;
+		parsed.read(v["b"].c_str(), v["b"].length());
+		ASSERT_TRUE(parsed["c"][0][0][0].a().empty());
+
+		// proxy: rewrite one field, forward the rest as is
+		const char* doc = "{\"id\":1,\"user\":{\"name\":\"n\",\"tags\":[\"x\", \"y\"]},\"list\":[1, {\"k\":null}, \"s\"],\"flag\":true}";
+		JSON::Mask mask(true);
+		mask.add("/user/name").add("/list/1/k");
+		v.read(doc, strlen(doc), mask);
+		ASSERT_TRUE(v["id"].type() == JSON::RAW && v["flag"].type() == JSON::RAW);
+		ASSERT_TRUE(v["user"]["tags"].type() == JSON::RAW);
+		ASSERT_TRUE(v["list"][0].type() == JSON::RAW && v["list"][2].type() == JSON::RAW);
+		ASSERT_TRUE(v["list"][1]["k"].type() == JSON::NIL);
+		v["user"]["name"] = "m";
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == "{\"flag\":true,\"id\":1,\"list\":[1,{\"k\":null},\"s\"],\"user\":{\"name\":\"m\",\"tags\":[\"x\", \"y\"]}}");
+
+		JSON::MemoryUsage mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::RAW] == 5);
+		ASSERT_TRUE(mu.dma_bytes == strlen("1true1\"s\"[\"x\", \"y\"]"));
+
+		// without dma, values out of mask are parsed instead of referencing the text
+		{
+			const string text(doc);
+			v.read(text.data(), text.size(), mask, false);
+		}
+		ASSERT_TRUE(v["id"] == 1 && v["user"]["tags"].type() == JSON::ARRAY && v["list"][2] == string("s"));
+		ASSERT_TRUE(v.memory_usage().dma_bytes == 0);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == "{\"flag\":true,\"id\":1,\"list\":[1,{\"k\":null},\"s\"],\"user\":{\"name\":\"n\",\"tags\":[\"x\",\"y\"]}}");
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, read_lazy)
+{
+	try {
+		const char* s = " {\"id\":12,\"name\":\"a long name of the document\",\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]},\"bad\":[1,2 x]} ";
+		JSON::Value v;
+		ASSERT_TRUE(v.read_lazy(s, strlen(s)) == strlen(s) - 1);
+		ASSERT_TRUE(v._type == JSON::RAW && v._e);
+
+		// touched level by level
+		ASSERT_TRUE(v.type() == JSON::OBJECT);
+		ASSERT_TRUE(v._o->size() == 4);
+		ASSERT_TRUE(v._o->find("user")->second._type == JSON::RAW);
+		ASSERT_TRUE(v["id"].i() == 12);
+		ASSERT_TRUE(v.get("name", string()) == "a long name of the document");
+		const JSON::Value& user = v.o().find("user")->second;
+		ASSERT_TRUE(user.o().find("name")->second == string("u\n"));
+		ASSERT_TRUE(user._o->find("tags")->second._type == JSON::RAW);
+		ASSERT_TRUE(v["user"]["tags"][1].f() == 1.5);
+		ASSERT_TRUE(v["user"]["tags"]._a->at(2)._type == JSON::RAW);
+		ASSERT_TRUE(v["user"]["tags"][2] == true);
+		ASSERT_TRUE(v["user"]["tags"][3].type() == JSON::NIL);
+		ASSERT_TRUE(*JSON::Pointer("/user/tags/0").get(v) == string("a"));
+
+		// untouched values are written verbatim, invalid ones throw when touched
+		JSON::Value v1;
+		v1.read_lazy(s, strlen(s));
+		v1["id"] = 13;
+		string out;
+		v1.write(out);
+		ASSERT_TRUE(out == "{\"bad\":[1,2 x],\"id\":13,\"name\":\"a long name of the document\",\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]}}");
+		ASSERT_THROW(v1["bad"].a(), std::logic_error);
+
+		// errors leave values lazy, every touch throws again
+		ASSERT_THROW(v1["bad"].a(), std::logic_error);
+		ASSERT_TRUE(v1["bad"]._type == JSON::RAW && v1["bad"]._e);
+		JSON::Value broken;
+		broken.read_lazy("{\"a\":1,\"b\": }", 13);
+		ASSERT_THROW(broken.type(), std::logic_error);
+		ASSERT_THROW(broken.type(), std::logic_error);
+		ASSERT_THROW(broken.o().size(), std::logic_error);
+
+		// copies are lazy too, share touches all
+		const char* s2 = "{\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]}}";
+		JSON::Value v2;
+		v2.read_lazy(s2, strlen(s2));
+		JSON::Value v3(v2);
+		ASSERT_TRUE(v3._type == JSON::RAW && v3._e);
+		ASSERT_TRUE(v3 == v2);
+		v2.share();
+		ASSERT_TRUE(v2._o->find("user")->second._o->find("tags")->second._a->at(0)._type == JSON::STRING);
+		JSON::Value full;
+		full.read(s2, strlen(s2));
+		ASSERT_TRUE(full == v2);
+
+		ASSERT_THROW(v.read_lazy(" 1", 2), std::logic_error);
+		ASSERT_THROW(v.read_lazy("{\"a\":[}", 7), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, document)
+{
+	try {
+		const char* s = " {\"id\":-12, \"pi\" : 3.5e1, \"name\":\"a\\tb\\u00e9\", \"ok\":true,\"no\":false,\"nil\":null,"
+			"\"list\":[[1, 2], {}, [], {\"k\":\"v\"}, \"x\"],\"user\":{\"tags\":[\"a\",\"b\"],\"age\":20}} ";
+		JSON::Document doc;
+		ASSERT_TRUE(doc.read(s) == strlen(s) - 1);
+
+		// tape: opener jumps past its closer, closer counts members
+		const JSON::Document::tape_type& tape = doc.tape();
+		ASSERT_TRUE((tape[0] >> 56) == '{' && (tape[0] & 0xFFFFFFFFFFFFFFULL) == tape.size());
+		ASSERT_TRUE((tape.back() >> 56) == '}' && (tape.back() & 0xFFFFFFFFFFFFFFULL) == 8);
+		ASSERT_TRUE((tape[1] >> 56) == '\"' && tape[2] == 2 && (tape[3] >> 56) == 'l' && int64_t(tape[4]) == -12);
+
+		JSON::Cursor root = doc.root();
+		ASSERT_TRUE(root.type() == JSON::OBJECT && root.size() == 8);
+		ASSERT_TRUE(root["id"].i() == -12);
+		ASSERT_TRUE(root["pi"].f() == 35.0);
+		ASSERT_TRUE(root["name"].s() == "a\tb\xc3\xa9" && root["name"].length() == 5 && root["name"].c_str()[5] == 0);
+		ASSERT_TRUE(root["ok"].b() && !root["no"].b() && root["nil"].type() == JSON::NIL);
+		ASSERT_TRUE(root["user"]["tags"][1].s() == "b");
+		ASSERT_TRUE(root["user"]["age"].i() == 20);
+		ASSERT_TRUE(root["list"].size() == 5 && root["list"][3]["k"].s() == "v" && root["list"][4].s() == "x");
+		ASSERT_TRUE(root["list"][1].size() == 0 && root["list"][1].begin() == root["list"][1].end());
+		ASSERT_TRUE(!root["none"].valid() && !root["list"][5].valid());
+		ASSERT_THROW(root["id"].s(), std::logic_error);
+		ASSERT_THROW(root["none"].type(), std::logic_error);
+
+		// iteration in document order, containers are jumped over
+		string keys;
+		for(JSON::Cursor it = root.begin(); it != root.end(); ++it) keys += it.key().s() + ",";
+		ASSERT_TRUE(keys == "id,pi,name,ok,no,nil,list,user,");
+		size_t n = 0;
+		for(JSON::Cursor it = root["list"].begin(); it != root["list"].end(); ++it) ++n;
+		ASSERT_TRUE(n == 5);
+
+		// same result as value tree
+		JSON::Value v, v1;
+		root.to_value(v);
+		v1.read(s);
+		ASSERT_TRUE(v == v1);
+		ASSERT_TRUE(v["name"] == string("a\tb\xc3\xa9"));
+
+		JSON::Document doc1("[]", 2);
+		ASSERT_TRUE(doc1.root().size() == 0 && doc1.tape().size() == 2);
+		ASSERT_TRUE(!JSON::Document().root().valid());
+
+		ASSERT_THROW(doc.read("1"), std::logic_error);
+		ASSERT_THROW(doc.read("{\"a\":1,}"), std::logic_error);
+		ASSERT_THROW(doc.read("{\"a\" 1}"), std::logic_error);
+		ASSERT_THROW(doc.read("[1 2]"), std::logic_error);
+		ASSERT_THROW(doc.read("[1,2}"), std::logic_error);
+		ASSERT_THROW(doc.read("[01]"), std::logic_error);
+		ASSERT_THROW(doc.read("[tru]"), std::logic_error);
+		ASSERT_THROW(doc.read("[\"a]"), std::logic_error);
+		ASSERT_THROW(doc.read("[[1]"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, read_file)
+{
+	const char* path = "ut_xpjson_read_file.json";
+	try {
+		const char* s = "{\"name\":\"a long string beyond sso\",\"list\":[1, 2.5, \"x\\ny\"]}\n";
+		FILE* fp = fopen(path, "wb");
+		ASSERT_TRUE(fp != NULL);
+		fwrite(s, 1, strlen(s), fp);
+		fclose(fp);
+
+		// strings point into the mapping owned by value
+		JSON::FileValue v;
+		ASSERT_TRUE(JSON::Reader::read_file(v, path) == strlen(s) - 1);
+		ASSERT_TRUE(v.mapped() == (__XPJSON_SUPPORT_MMAP__ != 0));
+		ASSERT_TRUE(v["name"]._dma && v["name"] == string("a long string beyond sso"));
+		ASSERT_TRUE(v["list"][2] == string("x\ny"));
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == "{\"list\":[1,2.5,\"x\\ny\"],\"name\":\"a long string beyond sso\"}");
+
+		JSON::Value v1;
+		v1.read(s);
+		JSON::FileValue v2(path, false);
+		ASSERT_TRUE(!v2["name"]._dma && v2 == v1 && v == v1);
+
+		JSON::Document doc;
+		ASSERT_TRUE(JSON::Reader::read_file(doc, path) == strlen(s) - 1);
+		ASSERT_TRUE(doc.root()["list"][1].f() == 2.5);
+
+		// empty file is read by buffer
+		fp = fopen(path, "wb");
+		fclose(fp);
+		ASSERT_THROW(v.read_file(path), std::logic_error);
+		ASSERT_TRUE(!v.mapped() && v.type() == JSON::NIL);
+		remove(path);
+		ASSERT_THROW(v.read_file(path), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		remove(path);
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, snapshot)
+{
+	const char* path = "ut_xpjson_snapshot.bin";
+	try {
+		const char* s = "{\"list\":[{\"id\":1,\"name\":\"x\"},{\"id\":2,\"name\":\"x\"},{\"id\":3,\"name\":\"y\\n\"}],\"pi\":3.25,\"ok\":true,\"nil\":null,\"raw\":0}";
+		JSON::Value v;
+		v.read(s);
+		v["raw"].raw("[1, {\"a\":\"b\"}]", 14);
+		JSON::Document doc;
+		doc.assign(v);
+		// distinct strings are stored once
+		ASSERT_TRUE(doc.strings().size() == strlen("list_id_name_x_y\n_pi_ok_nil_raw_a_b_"));
+		ASSERT_TRUE(doc.root()["raw"][1]["a"].s() == "b");
+
+		string bin;
+		doc.save(bin);
+		FILE* fp = fopen(path, "wb");
+		ASSERT_TRUE(fp != NULL);
+		fwrite(bin.data(), 1, bin.size(), fp);
+		fclose(fp);
+
+		// mapped & used in place
+		JSON::Snapshot snap(path);
+		JSON::Cursor root = snap.root();
+		ASSERT_TRUE(root["list"].size() == 3 && root["list"][2]["name"].s() == "y\n");
+		ASSERT_TRUE(root["pi"].f() == 3.25 && root["ok"].b() && root["nil"].type() == JSON::NIL);
+		JSON::Value v1, v2;
+		snap.to_value(v1);
+		v2.read(s);
+		v2["raw"].read("[1, {\"a\":\"b\"}]");
+		ASSERT_TRUE(v1 == v2);
+
+		// in memory, by copy & in place
+		vector<uint64_t> buf(bin.size() / 8 + 1);
+		memcpy(&buf[0], bin.data(), bin.size());
+		JSON::Document doc1;
+		doc1.load(&buf[0], bin.size());
+		ASSERT_TRUE(doc1.tape() == doc.tape() && doc1.strings() == doc.strings());
+		JSON::Snapshot snap1;
+		ASSERT_TRUE(!snap1.root().valid());
+		snap1.attach(&buf[0], bin.size());
+		ASSERT_TRUE(snap1.root()["list"][1]["id"].i() == 2);
+
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size() - 1), std::logic_error);
+		ASSERT_THROW(snap1.attach(reinterpret_cast<char*>(&buf[0]) + 1, bin.size()), std::logic_error);
+		ASSERT_THROW(JSON::SnapshotW().attach(&buf[0], bin.size()), std::logic_error);
+		// corrupted tape is rejected before use, tape follows 32 bytes header: {"list":[...
+		const size_t words = static_cast<size_t>(buf[2]), last = 4 + words - 1;
+		const uint64_t key = buf[5], len = buf[6], jump = buf[7], count = buf[last];
+		buf[5] = (key >> 56 << 56) | doc.strings().size();
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[5] = key;
+		buf[6] = len + 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[6] = uint64_t(-1);
+		ASSERT_THROW(doc1.load(&buf[0], bin.size()), std::logic_error);
+		buf[6] = len;
+		buf[7] = jump + 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[7] = jump;
+		buf[last] = count + 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[last] = count;
+		buf[2] = words - 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[2] = words;
+		buf[4 + words / 2] = uint64_t('x') << 56;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		memcpy(&buf[0], bin.data(), bin.size());
+		snap1.attach(&buf[0], bin.size());
+		buf[0] ^= 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		ASSERT_THROW(JSON::Document().save(bin), std::logic_error);
+		remove(path);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		remove(path);
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, msgpack)
+{
+	try {
+		JSON::Value v;
+		v["a"] = 1;
+		string out;
+		JSON::MsgPack::write(v, out);
+		ASSERT_TRUE(out == string("\x81\xa1" "a\x01", 4));
+		v.read("{\"k\\n\":[1]}");
+		out.clear();
+		JSON::MsgPack::write(v, out);
+		ASSERT_TRUE(out == string("\x81\xa2k\n\x91\x01", 6));
+
+		// smallest encodings, exact size up front
+		const char* s = "[0,127,128,255,256,65535,65536,4294967295,4294967296,-1,-32,-33,-128,-129,-32768,-32769,-2147483648,-2147483649,"
+			"1.5,0.1,true,false,null,\"\",\"a string longer than thirty one chars\",{},[]]";
+		v.read(s);
+		out.clear();
+		JSON::MsgPack::write(v, out);
+		const char expected[] = "\xdc\x00\x1b" "\x00\x7f\xcc\x80\xcc\xff\xcd\x01\x00\xcd\xff\xff\xce\x00\x01\x00\x00\xce\xff\xff\xff\xff"
+			"\xcf\x00\x00\x00\x01\x00\x00\x00\x00\xff\xe0\xd0\xdf\xd0\x80\xd1\xff\x7f\xd1\x80\x00\xd2\xff\xff\x7f\xff"
+			"\xd2\x80\x00\x00\x00\xd3\xff\xff\xff\xff\x7f\xff\xff\xff"
+			"\xca\x3f\xc0\x00\x00\xcb\x3f\xb9\x99\x99\x99\x99\x99\x9a\xc3\xc2\xc0\xa0\xd9\x25" "a string longer than thirty one chars\x80\x90";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+		ASSERT_TRUE(JSON::MsgPack::size(v) == out.size());
+
+		// strings reference input with dma
+		JSON::Value v1;
+		ASSERT_TRUE(JSON::MsgPack::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1[24]._dma && v1[24].c_str() == out.data() + out.size() - 39);
+		JSON::MsgPack::read(v1, out.data(), out.size(), false);
+		ASSERT_TRUE(!v1[24]._dma && v1 == v);
+
+		// raw values are parsed, fixed buffer
+		v.clear();
+		v["k"].raw("[1, \"x\"]", 8);
+		char buf[8];
+		ASSERT_TRUE(JSON::MsgPack::write(v, buf, sizeof(buf)) == 7);
+		ASSERT_TRUE(string(buf, 7) == string("\x81\xa1k\x92\x01\xa1x", 7));
+		ASSERT_THROW(JSON::MsgPack::write(v, buf, 6), std::length_error);
+
+		// bin as string, uint64 beyond int64 as float
+		ASSERT_TRUE(JSON::MsgPack::read(v1, "\xc4\x02" "ab", 4) == 4 && v1 == string("ab"));
+		JSON::MsgPack::read(v1, "\xcf\xff\xff\xff\xff\xff\xff\xff\xff", 9);
+		ASSERT_TRUE(v1.type() == JSON::FLOAT && v1.f() == 18446744073709551615.0);
+
+		ASSERT_THROW(JSON::MsgPack::read(v1, "\x92\x01", 2), std::logic_error);
+		ASSERT_THROW(JSON::MsgPack::read(v1, "\xdd\xff\xff\xff\xff", 5), std::logic_error);
+		ASSERT_THROW(JSON::MsgPack::read(v1, "\x81\x01\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::MsgPack::read(v1, "\xd4\x01\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::MsgPack::read(v1, "\xc1", 1), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, cbor)
+{
+	try {
+		// shortest heads, narrowest exact floats, exact size up front
+		JSON::Value v;
+		v.read("[0,23,24,-1,-25,1.5,0.1,65504.0,100000.0,-0.0,true,null,\"abcdefghijklmnopqrstuvwxyz\",{\"k\":[]}]");
+		string out;
+		JSON::Cbor::write(v, out);
+		const char expected[] = "\x8e\x00\x17\x18\x18\x20\x38\x18\xf9\x3e\x00\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a"
+			"\xf9\x7b\xff\xfa\x47\xc3\x50\x00\xf9\x80\x00\xf5\xf6\x78\x1a" "abcdefghijklmnopqrstuvwxyz\xa1\x61" "k\x80";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+		ASSERT_TRUE(JSON::Cbor::size(v) == out.size());
+
+		// indefinite length containers
+		string out1;
+		JSON::Cbor::write(v, out1, true);
+		ASSERT_TRUE(out1.size() == JSON::Cbor::size(v, true) && out1.size() == out.size() + 3);
+		ASSERT_TRUE(out1.compare(out1.size() - 7, 7, string("\xbf\x61" "k\x9f\xff\xff\xff", 7)) == 0);
+
+		// text strings reference input with dma
+		JSON::Value v1;
+		ASSERT_TRUE(JSON::Cbor::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1[12]._dma && v1[12].c_str() == out.data() + out.size() - 30);
+		JSON::Cbor::read(v1, out1.data(), out1.size(), false);
+		ASSERT_TRUE(!v1[12]._dma && v1 == v);
+
+		// raw values are parsed, fixed buffer
+		v.clear();
+		v["k"].raw("[1, \"x\"]", 8);
+		char buf[8];
+		ASSERT_TRUE(JSON::Cbor::write(v, buf, sizeof(buf)) == 7);
+		ASSERT_TRUE(string(buf, 7) == string("\xa1\x61k\x82\x01\x61x", 7));
+		ASSERT_THROW(JSON::Cbor::write(v, buf, 6), std::length_error);
+
+		// indefinite strings, byte strings, tags, integer keys, float 16 subnormal, undefined
+		ASSERT_TRUE(JSON::Cbor::read(v1, "\x7f\x62" "ab\x61" "c\xff", 7) == 7 && v1 == string("abc"));
+		ASSERT_TRUE(JSON::Cbor::read(v1, "\x42" "ab", 3) == 3 && v1 == string("ab"));
+		ASSERT_TRUE(JSON::Cbor::read(v1, "\xc1\x1a\x51\x4b\x67\xb0", 6) == 6 && v1 == 1363896240);
+		ASSERT_TRUE(JSON::Cbor::read(v1, "\xa2\x01\x02\x20\xf7", 5) == 5 && v1["1"] == 2 && v1["-1"].type() == JSON::NIL);
+		JSON::Cbor::read(v1, "\xf9\x00\x01", 3);
+		ASSERT_TRUE(v1.type() == JSON::FLOAT && v1.f() == ldexp(1.0, -24));
+		JSON::Cbor::read(v1, "\x3b\xff\xff\xff\xff\xff\xff\xff\xff", 9);
+		ASSERT_TRUE(v1.type() == JSON::FLOAT && v1.f() == -18446744073709551616.0);
+
+		ASSERT_THROW(JSON::Cbor::read(v1, "\x82\x01", 2), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\x9f\x01", 2), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\x9b\xff\xff\xff\xff\xff\xff\xff\xff", 9), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\xa1\xf5\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\x7f\x41" "a\xff", 4), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\x1c", 1), std::logic_error);
+		ASSERT_THROW(JSON::Cbor::read(v1, "\xff", 1), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, bson_ubjson)
+{
+	try {
+		// BSON, lengths of documents are back-patched
+		JSON::Value v;
+		v["hello"] = "world";
+		string out;
+		JSON::Bson::write(v, out);
+		ASSERT_TRUE(out == string("\x16\x00\x00\x00\x02hello\x00\x06\x00\x00\x00world\x00\x00", 22));
+
+		v.read("{\"a\":[0,-1,5000000000,1.5,true,null,\"a string longer than sso\"],\"o\":{\"x\":{}}}");
+		out.clear();
+		JSON::Bson::write(v, out);
+		const char expected[] = "\x68\x00\x00\x00\x04" "a\x00\x50\x00\x00\x00\x10" "0\x00\x00\x00\x00\x00\x10" "1\x00\xff\xff\xff\xff"
+			"\x12" "2\x00\x00\xf2\x05\x2a\x01\x00\x00\x00\x01" "3\x00\x00\x00\x00\x00\x00\x00\xf8\x3f\x08" "4\x00\x01\x0a" "5\x00"
+			"\x02" "6\x00\x19\x00\x00\x00" "a string longer than sso\x00\x00\x03o\x00\x0d\x00\x00\x00\x03x\x00\x05\x00\x00\x00\x00\x00\x00";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+
+		// strings reference input with dma
+		JSON::Value v1;
+		ASSERT_TRUE(JSON::Bson::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1["a"][6]._dma && v1["a"][6].c_str() == out.data() + 61);
+		JSON::Bson::read(v1, out.data(), out.size(), false);
+		ASSERT_TRUE(!v1["a"][6]._dma && v1 == v);
+
+		// raw values are parsed, fixed buffer
+		v.clear();
+		v["k"].raw("[1]", 3);
+		char buf[20];
+		ASSERT_TRUE(JSON::Bson::write(v, buf, sizeof(buf)) == 20);
+		ASSERT_TRUE(string(buf, 20) == string("\x14\x00\x00\x00\x04k\x00\x0c\x00\x00\x00\x10" "0\x00\x01\x00\x00\x00\x00\x00", 20));
+		ASSERT_THROW(JSON::Bson::write(v, buf, 19), std::length_error);
+		ASSERT_THROW(JSON::Bson::write(JSON::Value(1), out), std::logic_error);
+
+		// ObjectId as hex, binary as string
+		ASSERT_TRUE(JSON::Bson::read(v1, "\x14\x00\x00\x00\x07i\x00\x50\x7f\x1f\x77\xbc\xf8\x6c\xd7\x99\x43\x90\x11\x00", 20) == 20);
+		ASSERT_TRUE(v1["i"] == string("507f1f77bcf86cd799439011"));
+		ASSERT_TRUE(JSON::Bson::read(v1, "\x0f\x00\x00\x00\x05" "b\x00\x02\x00\x00\x00\x00" "ab\x00", 15) == 15 && v1["b"] == string("ab"));
+
+		ASSERT_THROW(JSON::Bson::read(v1, "\x06\x00\x00\x00\x0a\x00", 6), std::logic_error);
+		ASSERT_THROW(JSON::Bson::read(v1, "\x08\x00\x00\x00\x0a" "a\x00\x00", 7), std::logic_error);
+		ASSERT_THROW(JSON::Bson::read(v1, "\x0c\x00\x00\x00\x02" "a\x00\x01\x00\x00\x00x\x00", 13), std::logic_error);
+		ASSERT_THROW(JSON::Bson::read(v1, "\x08\x00\x00\x00\x13" "a\x00\x00", 8), std::logic_error);
+
+		// UBJSON, smallest integers & exact size up front
+		v.read("{\"a\":[0,-1,200,-200,5000000000,1.5,0.1,true,null,\"a string longer than sso\"]}");
+		out.clear();
+		JSON::Ubjson::write(v, out);
+		const char expected1[] = "{\x69\x01" "a[\x69\x00\x69\xff\x55\xc8\x49\xff\x38\x4c\x00\x00\x00\x01\x2a\x05\xf2\x00"
+			"\x64\x3f\xc0\x00\x00\x44\x3f\xb9\x99\x99\x99\x99\x99\x9a\x54\x5a\x53\x69\x18" "a string longer than sso]}";
+		ASSERT_TRUE(out == string(expected1, sizeof(expected1) - 1));
+		ASSERT_TRUE(JSON::Ubjson::size(v) == out.size());
+		ASSERT_TRUE(JSON::Ubjson::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1["a"][9]._dma && v1["a"][9].c_str() == out.data() + out.size() - 26);
+
+		// sized & typed containers, no-ops, chars, high-precision numbers
+		ASSERT_TRUE(JSON::Ubjson::read(v1, "[$U#i\x03\x01\x02\x03", 9) == 9 && v1.a().size() == 3 && v1[2] == 3);
+		ASSERT_TRUE(JSON::Ubjson::read(v1, "{#i\x01i\x01kNCx", 10) == 10 && v1["k"] == string("x"));
+		ASSERT_TRUE(JSON::Ubjson::read(v1, "HU\x1e" "123456789012345678901234567890", 33) == 33);
+		out.clear();
+		v1.write(out);
+		ASSERT_TRUE(v1.type() == JSON::RAW && out == "123456789012345678901234567890");
+		JSON::Ubjson::read(v1, "Hi\x03" "1.5", 6, false);
+		ASSERT_TRUE(v1.type() == JSON::FLOAT && v1.f() == 1.5);
+
+		ASSERT_THROW(JSON::Ubjson::read(v1, "[i\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::Ubjson::read(v1, "[#i\x7f", 4), std::logic_error);
+		ASSERT_THROW(JSON::Ubjson::read(v1, "Si\xff", 3), std::logic_error);
+		ASSERT_THROW(JSON::Ubjson::read(v1, "Hi\x01x", 4), std::logic_error);
+		ASSERT_THROW(JSON::Ubjson::read(v1, "X", 1), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, hash)
+{
+	try {
+		const char* s = "{\"a\":[1,2.5,true,null,\"text longer than small string\"],\"b\":{\"c\":\"\\u00e9\"},\"d\":-0.0}";
+		JSON::Value v, v1;
+		v.read(s);
+		v1.read(s);
+		ASSERT_TRUE(v.hash() == v1.hash() && v.o().hash() == v.hash() && v["a"].a().hash() == v["a"].hash());
+
+		// any change of content changes the hash
+		const uint64_t h = v.hash();
+		v1["a"][0] = 2;
+		ASSERT_TRUE(v1.hash() != h);
+		v1["a"][0] = 1.0;
+		ASSERT_TRUE(v1.hash() != h);
+		v1["a"][0] = 1;
+		v1["e"];
+		ASSERT_TRUE(v1.hash() != h);
+		v1.o().erase("e");
+		ASSERT_TRUE(v1.hash() == h);
+		ASSERT_TRUE(JSON::Value("ab").hash() != JSON::Value("ba").hash());
+		ASSERT_TRUE(JSON::Value(JSON::ARRAY).hash() != JSON::Value(JSON::OBJECT).hash());
+
+		// order of members doesn't matter, -0.0 is 0.0, raw as parsed
+		JSON::Value v2;
+		v2["d"] = 0.0;
+		v2["b"]["c"] = "\xc3\xa9";
+		const char* raw = "[1, 2.5, true, null, \"text longer than small string\"]";
+		v2["a"].raw(raw, strlen(raw));
+		ASSERT_TRUE(v2.hash() == h);
+
+		// the same as wchar_t
+		JSON::ValueW w;
+		w.read(L"{\"a\":[1,2.5,true,null,\"text longer than small string\"],\"b\":{\"c\":\"\\u00e9\"},\"d\":-0.0}");
+		ASSERT_TRUE(w.hash() == h);
+
+		// memoized on shared trees, dropped on write
+		v.share();
+		const JSON::Value& cv = v;
+		ASSERT_TRUE(cv.hash() == h && cv.o()._hash == h && cv.o().find("b")->second.o()._hash);
+		JSON::Value v3(v);
+		v3["a"][0] = 2;
+		ASSERT_TRUE(v3.hash() != h && cv.hash() == h);
+		ASSERT_TRUE(!v3.shared() && !v3.o()._hash);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, equal)
+{
+	try {
+		JSON::Value v, v1;
+		v.read("{\"a\":[1,2,3,0.1,\"text longer than small string\"],\"b\":{\"c\":1.0e-9}}");
+		v1.read("{\"a\":[1,2,3,0.1,\"text longer than small string\"],\"b\":{\"c\":1.0e-9}}");
+		ASSERT_TRUE(v == v1 && JSON::equal(v, v1, 0.0));
+		v1["a"][2] = 4;
+		ASSERT_TRUE(v != v1);
+		v1["a"][2] = 3.0;
+		ASSERT_TRUE(v != v1);
+		v1["a"][2] = 3;
+		v1["a"][4] = "text longer than small strinG";
+		ASSERT_TRUE(v != v1);
+		v1["a"][4] = "text longer than small string";
+
+		// floats are exact by default, tolerance relative to the larger magnitude
+		v1["a"][3] = 0.1 + 1e-12;
+		ASSERT_TRUE(v != v1 && JSON::equal(v, v1, 1e-9) && !JSON::equal(v, v1, 1e-15));
+		v1["a"][3] = 0.1;
+		v1["b"]["c"] = 2e-9;
+		ASSERT_TRUE(v != v1 && JSON::equal(v, v1, 1e-8) && !JSON::equal(v, v1, 1e-10));
+		v1["b"]["c"] = 1e-9;
+		ASSERT_TRUE(JSON::Value(-0.0) == JSON::Value(0.0) && JSON::Value(1e300) != JSON::Value(1.0000001e300));
+		ASSERT_TRUE(JSON::equal(JSON::Value(1e300), JSON::Value(1.0000001e300), 1e-6));
+		ASSERT_TRUE(JSON::Value(1.0) != 1.0000001 && JSON::Value(1.0) == 1.0 && 0.5f == JSON::Value(0.5));
+
+		// shared copies are the same container, memoized hashes tell unequal trees apart
+		v.share();
+		JSON::Value v2(v);
+		const JSON::Value& cv = v;
+		const JSON::Value& cv2 = v2;
+		ASSERT_TRUE(&cv.o() == &cv2.o() && cv == cv2);
+		v1.share();
+		const JSON::Value& cv1 = v1;
+		ASSERT_TRUE(cv1.hash() == cv.hash() && cv1 == cv);
+		JSON::Value v3;
+		v3.read("{\"a\":[1,2,3,0.1,\"text longer than small string\"],\"b\":{\"c\":2.0e-9}}");
+		v3.share();
+		const JSON::Value& cv3 = v3;
+		ASSERT_TRUE(cv3.hash() != cv.hash() && cv3 != cv && JSON::equal(cv3, cv, 1e-8));
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, json_patch)
+{
+	try {
+		// diff: members, LCS of arrays, escaped keys
+		JSON::Value a, b, p;
+		a.read("{\"a\":[1,2,3,4,5],\"b\":{\"c\":1,\"d\":[\"x\"]},\"k/~\":true,\"gone\":0}");
+		b.read("{\"a\":[1,9,3,5,6],\"b\":{\"c\":2,\"d\":[\"x\",\"y\"]},\"k/~\":false,\"new\":{\"z\":null}}");
+		JSON::diff(a, b, p);
+		string out;
+		p.write(out);
+		ASSERT_TRUE(out == "[{\"op\":\"replace\",\"path\":\"/a/1\",\"value\":9},{\"op\":\"remove\",\"path\":\"/a/3\"},"
+			"{\"op\":\"add\",\"path\":\"/a/4\",\"value\":6},{\"op\":\"replace\",\"path\":\"/b/c\",\"value\":2},"
+			"{\"op\":\"add\",\"path\":\"/b/d/1\",\"value\":\"y\"},{\"op\":\"remove\",\"path\":\"/gone\"},"
+			"{\"op\":\"replace\",\"path\":\"/k~1~0\",\"value\":false},{\"op\":\"add\",\"path\":\"/new\",\"value\":{\"z\":null}}]");
+		JSON::apply_patch(a, p);
+		ASSERT_TRUE(a == b);
+
+		// equal & shared trees give empty patch, type change replaces
+		p.clear();
+		JSON::diff(a, b, p);
+		ASSERT_TRUE(p.type() == JSON::ARRAY && p.a().empty());
+		b.share();
+		JSON::Value c(b);
+		JSON::diff(b, c, p);
+		ASSERT_TRUE(p.a().empty());
+		JSON::diff(JSON::Value(1), JSON::Value(1.0), p);
+		ASSERT_TRUE(p.a().size() == 1 && p[0]["path"] == string("") && p[0]["value"].type() == JSON::FLOAT);
+
+		// apply: examples of RFC 6902
+		JSON::Value v;
+		v.read("{\"foo\":[\"bar\",\"baz\"],\"q\":{\"r\":1}}");
+		p.read("[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"},{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\"]},"
+			"{\"op\":\"test\",\"path\":\"/foo/0\",\"value\":\"bar\"},{\"op\":\"move\",\"from\":\"/q/r\",\"path\":\"/s\"},"
+			"{\"op\":\"copy\",\"from\":\"/foo/3\",\"path\":\"/q/t\"},{\"op\":\"remove\",\"path\":\"/foo/0\"},"
+			"{\"op\":\"replace\",\"path\":\"/foo/2/0\",\"value\":true}]");
+		JSON::apply_patch(v, p);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == "{\"foo\":[\"qux\",\"baz\",[true]],\"q\":{\"t\":[\"abc\"]},\"s\":1}");
+
+		// test op compares numbers by value, also inside containers
+		JSON::Value doc;
+		doc.read("{\"foo\":1.0,\"bar\":[2,{\"x\":3.0}]}");
+		p.read("[{\"op\":\"test\",\"path\":\"/foo\",\"value\":1},{\"op\":\"test\",\"path\":\"/bar\",\"value\":[2.0,{\"x\":3}]}]");
+		JSON::apply_patch(doc, p);
+		p.read("[{\"op\":\"test\",\"path\":\"/foo\",\"value\":1.5}]");
+		ASSERT_THROW(JSON::apply_patch(doc, p), std::logic_error);
+		p.read("[{\"op\":\"test\",\"path\":\"/foo\",\"value\":\"1\"}]");
+		ASSERT_THROW(JSON::apply_patch(doc, p), std::logic_error);
+
+		// errors, ops before the failed one stay applied
+		p.read("[{\"op\":\"add\",\"path\":\"/x\",\"value\":1},{\"op\":\"test\",\"path\":\"/x\",\"value\":2}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		ASSERT_TRUE(v["x"] == 1);
+		p.read("[{\"op\":\"remove\",\"path\":\"/nope\"}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		p.read("[{\"op\":\"add\",\"path\":\"/foo/4\",\"value\":1}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		p.read("[{\"op\":\"add\",\"path\":\"/foo/01\",\"value\":1}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		p.read("[{\"op\":\"move\",\"from\":\"/q\",\"path\":\"/q/t/0\"}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		p.read("[{\"op\":\"jump\",\"path\":\"/q\"}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+		p.read("[{\"op\":\"add\",\"path\":\"q\",\"value\":1}]");
+		ASSERT_THROW(JSON::apply_patch(v, p), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, merge_patch)
+{
+	try {
+		// examples of RFC 7396, by value & while parsing
+		const char* cases[][3] = {
+			{"{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+			{"{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"},
+			{"{\"a\":\"b\"}", "{\"a\":null}", "{}"},
+			{"{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"},
+			{"{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"},
+			{"{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":[\"b\"]}"},
+			{"{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"},
+			{"{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}", "{\"a\":[1]}"},
+			{"[\"a\",\"b\"]", "[\"c\",\"d\"]", "[\"c\",\"d\"]"},
+			{"{\"a\":\"b\"}", "[\"c\"]", "[\"c\"]"},
+			{"{\"a\":\"foo\"}", "null", "null"},
+			{"{\"a\":\"foo\"}", "\"bar\"", "\"bar\""},
+			{"{\"e\":null}", "{\"a\":1}", "{\"a\":1,\"e\":null}"},
+			{"[1,2]", "{\"a\":\"b\",\"c\":null}", "{\"a\":\"b\"}"},
+			{"{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"},
+		};
+		for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+			JSON::Value v, p;
+			v.read(cases[i][0], strlen(cases[i][0]));
+			if(cases[i][1][0] == '{' || cases[i][1][0] == '[')
+				p.read(cases[i][1], strlen(cases[i][1]));
+			else
+				p.read_merge(cases[i][1], strlen(cases[i][1]));
+			JSON::merge_patch(v, p);
+			string out;
+			v.write(out);
+			ASSERT_TRUE(out == cases[i][2]);
+
+			JSON::Value v1;
+			v1.read(cases[i][0], strlen(cases[i][0]));
+			ASSERT_TRUE(v1.read_merge(cases[i][1], strlen(cases[i][1]), false) == strlen(cases[i][1]));
+			ASSERT_TRUE(v1 == v);
+		}
+
+		// untouched subtrees stay in place, inserted ones are moved
+		JSON::Value v, p;
+		v.read("{\"keep\":{\"x\":[1,2,3]},\"set\":{\"y\":1}}");
+		const JSON::Object* keep = &v["keep"].o();
+		p.read("{\"set\":{\"y\":null,\"z\":2},\"add\":{\"w\":[true],\"n\":null}}");
+#ifdef __XPJSON_SUPPORT_MOVE__
+		const JSON::Array* w = &p["add"]["w"].a();
+		JSON::merge_patch(v, std::move(p));
+		ASSERT_TRUE(&v["add"]["w"].a() == w);
+#else
+		JSON::merge_patch(v, p);
+#endif
+		ASSERT_TRUE(&v["keep"].o() == keep);
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == "{\"add\":{\"w\":[true]},\"keep\":{\"x\":[1,2,3]},\"set\":{\"z\":2}}");
+
+		// while parsing, escaped keys & dangling text
+		const char* s = " {\"set\" : {\"z\" : null}, \"k\\n\":\"v\"} tail";
+		ASSERT_TRUE(v.read_merge(s, strlen(s)) == strlen(s) - 5);
+		ASSERT_TRUE(&v["keep"].o() == keep && v["set"].o().empty() && v["k\n"] == string("v"));
+		ASSERT_THROW(v.read_merge("{\"a\":nul}", 9), std::logic_error);
+		ASSERT_THROW(v.read_merge("{\"a\" 1}", 7), std::logic_error);
+		ASSERT_THROW(v.read_merge("{\"a\":1", 6), std::logic_error);
+
+		// strings are copied from short-lived patches, errors leave the value partly patched
+		{
+			const string patch = "{\"name\":\"" + string(40, 'n') + "\"}";
+			v.read_merge(patch.data(), patch.size());
+			ASSERT_TRUE(v["name"].c_str() < patch.data() || v["name"].c_str() >= patch.data() + patch.size());
+		}
+		ASSERT_TRUE(v["name"] == string(40, 'n'));
+		ASSERT_THROW(v.read_merge("{\"p\":1,\"a\" 1}", 13), std::logic_error);
+		ASSERT_TRUE(v["p"] == 1);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+namespace ut_bind
+{
+	struct Address
+	{
+		string city;
+		vector<int> zip;
+		JSON_BIND(Address, JSON_FIELD(city) JSON_FIELD(zip))
+	};
+
+	struct Person
+	{
+		Person() : id(0), score(0.0), admin(false) {}
+		int64_t id;
+		string name;
+		double score;
+		bool admin;
+		Address home;
+		deque<Address> others;
+		map<string, int> counts;
+		JSON::Value extra;
+		JSON_BIND(Person, JSON_FIELD(id) JSON_FIELD_AS(name, "full name") JSON_FIELD(score) JSON_FIELD(admin)
+			JSON_FIELD(home) JSON_FIELD(others) JSON_FIELD(counts) JSON_FIELD(extra))
+	};
+
+	struct Counter
+	{
+		Counter() : big(0), small(0), neg(0) {}
+		uint64_t big;
+		unsigned short small;
+		signed char neg;
+		JSON_BIND(Counter, JSON_FIELD(big) JSON_FIELD(small) JSON_FIELD(neg))
+	};
+
+	struct Duplicate
+	{
+		Duplicate() : a(0), x(0) {}
+		int a;
+		int x;
+		JSON_BIND(Duplicate, JSON_FIELD_AS(a, "x") JSON_FIELD(x))
+	};
+}
+
+TEST(ut_xpjson, binder)
+{
+	try {
+		const char* in = "{ \"id\" : 12345678901, \"full name\":\"A \\\"B\\\"\", \"unknown\":{\"x\":[1,{\"y\":\"}\"}]},"
+			"\"score\":2, \"admin\":true, \"home\":{\"city\":\"Paris\",\"zip\":[7,5]}, \"others\":[{\"city\":\"Rome\"},{}],"
+			"\"counts\":{\"a\":1,\"b\":2}, \"extra\":[null,{\"k\":1.5}], \"\\u0073core\":3.25} tail";
+		ut_bind::Person p;
+		p.home.city = "none";
+		ASSERT_TRUE(JSON::Binder::read(p, in, strlen(in)) == strlen(in) - 5);
+		ASSERT_TRUE(p.id == 12345678901LL && p.name == "A \"B\"" && p.score == 3.25 && p.admin);
+		ASSERT_TRUE(p.home.city == "Paris" && p.home.zip.size() == 2 && p.home.zip[1] == 5);
+		ASSERT_TRUE(p.others.size() == 2 && p.others[0].city == "Rome" && p.others[1].city.empty());
+		ASSERT_TRUE(p.counts.size() == 2 && p.counts["b"] == 2 && p.extra[1]["k"] == 1.5);
+
+		// written without values, the same as the dom
+		string out;
+		JSON::Binder::write(p, out);
+		ASSERT_TRUE(out == "{\"id\":12345678901,\"full name\":\"A \\\"B\\\"\",\"score\":3.25,\"admin\":true,"
+			"\"home\":{\"city\":\"Paris\",\"zip\":[7,5]},\"others\":[{\"city\":\"Rome\",\"zip\":[]},{\"city\":\"\",\"zip\":[]}],"
+			"\"counts\":{\"a\":1,\"b\":2},\"extra\":[null,{\"k\":1.5}]}");
+		ut_bind::Person q;
+		ASSERT_TRUE(JSON::Binder::read(q, out) == out.size());
+		string out1;
+		JSON::Binder::write(q, out1);
+		ASSERT_TRUE(out1 == out);
+
+		// absent or null members keep their values, containers of structs
+		const char* in1 = "{\"full name\":null,\"admin\":false}";
+		JSON::Binder::read(q, in1, strlen(in1));
+		ASSERT_TRUE(q.name == "A \"B\"" && !q.admin && q.id == 12345678901LL);
+		vector<ut_bind::Address> as;
+		JSON::Binder::read(as, string("[{\"city\":\"x\"},{\"zip\":[1]}]"));
+		ASSERT_TRUE(as.size() == 2 && as[0].city == "x" && as[1].zip[0] == 1);
+
+		// typed errors
+		ASSERT_THROW(JSON::Binder::read(q, string("{\"id\":\"1\"}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(q, string("{\"id\":1.5}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(q, string("{\"full name\":1}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(q, string("{\"home\":[]}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(q, string("{\"id\":1")), std::logic_error);
+
+		// integers in range of members, or rejected
+		ut_bind::Counter c;
+		c.big = ~static_cast<uint64_t>(0);
+		c.small = 65535;
+		c.neg = -128;
+		string counter;
+		JSON::Binder::write(c, counter);
+		ASSERT_TRUE(counter == "{\"big\":18446744073709551615,\"small\":65535,\"neg\":-128}");
+		ut_bind::Counter c1;
+		ASSERT_TRUE(JSON::Binder::read(c1, counter) == counter.size() && c1.big == c.big && c1.small == 65535 && c1.neg == -128);
+		JSON::Binder::read(c1, string("{\"big\":-0,\"neg\":127}"));
+		ASSERT_TRUE(c1.big == 0 && c1.neg == 127);
+		ASSERT_THROW(JSON::Binder::read(c1, string("{\"small\":70000}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(c1, string("{\"small\":-1}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(c1, string("{\"neg\":-129}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(c1, string("{\"big\":18446744073709551616}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::read(c1, string("{\"big\":1e3}")), std::logic_error);
+
+		// keys of fields must be unique, checked on every use
+		ut_bind::Duplicate d;
+		ASSERT_THROW(JSON::Binder::read(d, string("{}")), std::logic_error);
+		ASSERT_THROW(JSON::Binder::write(d, counter), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, schema)
+{
+	try {
+		JSON::Value s;
+		s.read("{\"type\":\"object\",\"required\":[\"id\",\"tags\"],\"additionalProperties\":false,\"properties\":{"
+			"\"id\":{\"type\":\"integer\",\"minimum\":1,\"exclusiveMaximum\":100},"
+			"\"name\":{\"type\":\"string\",\"minLength\":2,\"maxLength\":3,\"pattern\":\"^[a-z\\u00e9]+$\"},"
+			"\"ratio\":{\"type\":[\"number\",\"null\"],\"multipleOf\":0.25},"
+			"\"kind\":{\"enum\":[\"a\",2,{\"b\":[1]}]},"
+			"\"tags\":{\"type\":\"array\",\"minItems\":1,\"maxItems\":3,\"items\":{\"type\":\"string\"}},"
+			"\"pair\":{\"items\":[{\"type\":\"boolean\"},{\"const\":1}],\"additionalItems\":false},"
+			"\"any\":true}}");
+		JSON::Schema schema(s);
+
+		const char* cases[][2] = {
+			{"{\"id\":1,\"tags\":[\"x\"]}", ""},
+			{"{\"id\":2.0,\"name\":\"\xc3\xa9t\xc3\xa9\",\"ratio\":1.75,\"kind\":{\"b\":[1]},\"tags\":[\"x\",\"y\"],\"pair\":[true,1.0],\"any\":{\"x\":[]}}", ""},
+			{"{\"id\":1,\"tags\":[\"x\"],\"ratio\":null,\"kind\":2.0}", ""},
+			{"{\"id\":0,\"tags\":[\"x\"]}", "minimum at #/id"},
+			{"{\"id\":100,\"tags\":[\"x\"]}", "exclusiveMaximum at #/id"},
+			{"{\"id\":1.5,\"tags\":[\"x\"]}", "type at #/id"},
+			{"{\"id\":1}", "required at #"},
+			{"{\"id\":1,\"tags\":[]}", "minItems at #/tags"},
+			{"{\"id\":1,\"tags\":[\"a\",\"b\",\"c\",\"d\"]}", "maxItems at #/tags"},
+			{"{\"id\":1,\"tags\":[\"a\",2]}", "type at #/tags/1"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"name\":\"\xc3\xa9\"}", "minLength at #/name"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"name\":\"abcd\"}", "maxLength at #/name"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"name\":\"aB\"}", "pattern at #/name"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"ratio\":0.3}", "multipleOf at #/ratio"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"kind\":{\"b\":[2]}}", "enum at #/kind"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"pair\":[true,1,0]}", "false at #/pair/2"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"pair\":[true,2]}", "enum at #/pair/1"},
+			{"{\"id\":1,\"tags\":[\"x\"],\"a/~b\":1}", "false at #/a~1~0b"},
+			{"[1]", "type at #"},
+		};
+		for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+			const char* in = cases[i][0];
+			const size_t len = strlen(in);
+			const string expected = cases[i][1];
+			JSON::Value v;
+			v.read(in, len);
+			string error;
+			ASSERT_TRUE(schema.validate(v, &error) == expected.empty());
+			ASSERT_TRUE(error == expected);
+
+			// fused into parsing, with or without values
+			JSON::Value v1;
+			if(expected.empty()) {
+				ASSERT_TRUE(schema.read(v1, in, len) == len && v1 == v);
+				ASSERT_TRUE(schema.check(in, len) == len);
+				continue;
+			}
+			try {
+				schema.check(in, len);
+				ASSERT_TRUE(false);
+			}
+			catch(std::logic_error& e) {
+				ASSERT_TRUE(strstr(e.what(), ("Schema error: " + expected + ".").c_str()) == e.what());
+			}
+			ASSERT_THROW(schema.read(v1, in, len), std::logic_error);
+		}
+
+		// unconstrained members aren't parsed by check, invalid text is still rejected by read
+		ASSERT_TRUE(schema.check("{\"id\":1,\"tags\":[\"x\"],\"any\":[tru]}", 33) == 33);
+		JSON::Value v;
+		ASSERT_THROW(schema.read(v, "{\"id\":1,\"tags\":[\"x\"],\"any\":[tru]}", 33), std::logic_error);
+		ASSERT_THROW(schema.check("{\"id\":1,\"tags\":[\"x\"]", 20), std::logic_error);
+		ASSERT_TRUE(JSON::Schema().validate(v) && !JSON::Schema(JSON::Value(false)).validate(v));
+
+		// repeated keys are one property in every path
+		const string twice = "{\"a\":\"x\",\"a\":\"x\"}";
+		s.read("{\"maxProperties\":1}");
+		const JSON::Schema max_one(s);
+		v.read(twice);
+		ASSERT_TRUE(max_one.validate(v) && max_one.check(twice.data(), twice.size()) == twice.size());
+		ASSERT_TRUE(max_one.read(v, twice.data(), twice.size()) == twice.size());
+		s.read("{\"minProperties\":2}");
+		const JSON::Schema min_two(s);
+		v.read(twice);
+		ASSERT_FALSE(min_two.validate(v));
+		ASSERT_THROW(min_two.check(twice.data(), twice.size()), std::logic_error);
+		ASSERT_THROW(min_two.read(v, twice.data(), twice.size()), std::logic_error);
+		ASSERT_THROW(JSON::Schema(JSON::Value(1)), std::logic_error);
+		s.read("{\"type\":\"float\"}");
+		ASSERT_THROW(schema.compile(s), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, formatter)
+{
+	try {
+		const string in = " {\"b\" : [1, 2.5,\"x, y\"], \"a\":{\"e\":{}, \"d\":[ ], \"c\":[true,{\"f\":null}]}} ";
+		JSON::Value v;
+		v.read(in);
+
+		// values in key order, text in source order
+		string out;
+		JSON::Formatter().write(v, out);
+		ASSERT_TRUE(out == "{\n    \"a\": {\n        \"c\": [\n            true,\n            {\n                \"f\": null\n            }\n        ],\n"
+			"        \"d\": [],\n        \"e\": {}\n    },\n    \"b\": [\n        1,\n        2.5,\n        \"x, y\"\n    ]\n}");
+		out.clear();
+		ASSERT_TRUE(JSON::Formatter(1, '\t', true).format(in, out) == in.size() - 1);
+		ASSERT_TRUE(out == "{\r\n\t\"b\": [\r\n\t\t1,\r\n\t\t2.5,\r\n\t\t\"x, y\"\r\n\t],\r\n\t\"a\": {\r\n\t\t\"e\": {},\r\n\t\t\"d\": [],\r\n"
+			"\t\t\"c\": [\r\n\t\t\ttrue,\r\n\t\t\t{\r\n\t\t\t\t\"f\": null\r\n\t\t\t}\r\n\t\t]\r\n\t}\r\n}");
+		JSON::Value v1;
+		v1.read(out);
+		ASSERT_TRUE(v1 == v);
+
+		// arrays of scalars inline up to the width
+		const JSON::Formatter inlined(2, ' ', false, 18);
+		out.clear();
+		inlined.write(v, out);
+		ASSERT_TRUE(out == "{\n  \"a\": {\n    \"c\": [\n      true,\n      {\n        \"f\": null\n      }\n    ],\n    \"d\": [],\n    \"e\": {}\n  },\n"
+			"  \"b\": [1, 2.5, \"x, y\"]\n}");
+		string out1;
+		inlined.format(string("{\"a\":{\"c\":[true,{\"f\":null}],\"d\":[],\"e\":{}},\"b\":[1, 2.5,\"x, y\"]}"), out1);
+		ASSERT_TRUE(out1 == out);
+		out.clear();
+		JSON::Formatter(2, ' ', false, 17).format(string("[[1,2],[1, 2, 3, \"\\\"]\", 5]]"), out);
+		ASSERT_TRUE(out == "[\n  [1, 2],\n  [\n    1,\n    2,\n    3,\n    \"\\\"]\",\n    5\n  ]\n]");
+
+		// minified text without values
+		out.clear();
+		ASSERT_TRUE(JSON::Formatter::minify(in, out) == in.size() - 1);
+		ASSERT_TRUE(out == "{\"b\":[1,2.5,\"x, y\"],\"a\":{\"e\":{},\"d\":[],\"c\":[true,{\"f\":null}]}}");
+		out.clear();
+		ASSERT_TRUE(JSON::Formatter::minify(" -1.5e3 ,", 9, out) == 7 && out == "-1.5e3");
+		ASSERT_THROW(JSON::Formatter::minify("]", 1, out), std::logic_error);
+		ASSERT_THROW(JSON::Formatter::minify("{\"a\":\"1}", 8, out), std::logic_error);
+		ASSERT_THROW(JSON::Formatter::minify("[1,2", 4, out), std::logic_error);
+
+		// structure is checked, tokens are never joined
+		const char* bad[] = {"[1 2, true false]", "{\"a\":[1}]", "[1,]", "{\"a\" 1}", "{1:2}", "{\"a\":1:2}", "[,1]", "{\"a\"}"};
+		for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+			ASSERT_THROW(JSON::Formatter::minify(bad[i], strlen(bad[i]), out), std::logic_error);
+			ASSERT_THROW(JSON::Formatter(2, ' ', false, 40).format(bad[i], strlen(bad[i]), out), std::logic_error);
+		}
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjson, fragments)
+{
+	try {
+		JSON::Value v;
+		v.read(string("{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}"));
+		string expect;
+		v.write(expect);
+
+		// shared containers keep their text once written
+		v.share(true);
+		const JSON::Value& cv = v;
+		const JSON::Value& e = cv.o().find("e")->second;
+		ASSERT_TRUE(v._o->fragment() == NULL);
+		string out;
+		v.write(out);
+		ASSERT_TRUE(out == expect);
+		ASSERT_TRUE(*v._o->fragment() == expect);
+		ASSERT_TRUE(*e._a->fragment() == "[{\"f\":true}]");
+		const string* fragment = e._a->fragment();
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == expect);
+
+		// modified path is copied without text, the rest is spliced in
+		JSON::Value v1(v);
+		v1["a"]["b"][0] = 100;
+		ASSERT_TRUE(v1._o->fragment() == NULL);
+		ASSERT_TRUE(v1["a"]._o->fragment() == NULL);
+		ASSERT_TRUE(v1.o().find("e")->second._a == e._a);
+		out.clear();
+		v1.write(out);
+		ASSERT_TRUE(out == "{\"a\":{\"b\":[100,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}");
+		ASSERT_TRUE(e._a->fragment() == fragment);
+		ASSERT_TRUE(v1._o->fragment() == NULL);
+
+		// the last owner drops its text on modification
+		JSON::Object* o = v._o;
+		v1.clear();
+		v["g"] = 1;
+		ASSERT_TRUE(v._o == o && v._o->fragment() == NULL);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == "{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}],\"g\":1}");
+		ASSERT_TRUE(v._o->fragment() == NULL);
+
+		// not kept without fragments
+		JSON::Value v2(v);
+		v2.share();
+		out.clear();
+		v2.write(out);
+		ASSERT_TRUE(v2._o->fragment() == NULL);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+namespace ut_gather {
+	struct iovec {void* iov_base; size_t iov_len;};
+}
+
+TEST(ut_xpjson, gather_writer)
+{
+	try {
+		const string body(100, 'x');
+		const string in = "{\"a\":[1,true,null,\"ab\"],\"b\":\"" + body + "\",\"c\":\"" + body + "\\n\",\"d\":{\"e\":2.5}}";
+		JSON::Value v;
+		v.read(in);
+		string expect;
+		v.write(expect);
+
+		// long strings are referenced, the rest is copied into scratch
+		JSON::GatherWriter writer(16);
+		writer.write(v);
+		ASSERT_TRUE(writer.count() == 3 && writer.length() == expect.length());
+		vector<JSON::GatherWriter::segment> segments;
+		writer.segments(segments);
+		ASSERT_TRUE(segments.size() == 3);
+		ASSERT_TRUE(segments[1].first == v["b"].c_str() && segments[1].second == body.length());
+		string out;
+		for(size_t i = 0; i < segments.size(); ++i) out.append(segments[i].first, segments[i].second);
+		ASSERT_TRUE(out == expect);
+
+		// iovec alike for writev
+		vector<ut_gather::iovec> iov;
+		writer.iovecs(iov);
+		ASSERT_TRUE(iov.size() == 3 && iov[1].iov_base == segments[1].first && iov[2].iov_len == segments[2].second);
+
+		// cached text of shared containers is written once and referenced
+		const string in1 = "[{\"f\":\"" + body + "\"},[1,2]]";
+		JSON::Value t;
+		t.read(in1);
+		t.share(true);
+		writer.clear();
+		writer.write(t);
+		ASSERT_TRUE(writer.count() == 1 && t._a->fragment() != NULL);
+		segments.clear();
+		writer.segments(segments);
+		ASSERT_TRUE(segments[0].first == t._a->fragment()->data());
+		JSON::Value t1(t);
+		t1[1][0] = 3;
+		writer.clear();
+		writer.write(t1);
+		segments.clear();
+		writer.segments(segments);
+		ASSERT_TRUE(segments.size() == 3 && segments[1].first == t._a->at(0)._o->fragment()->data());
+		out.clear();
+		for(size_t i = 0; i < segments.size(); ++i) out.append(segments[i].first, segments[i].second);
+		ASSERT_TRUE(out == "[{\"f\":\"" + body + "\"},[3,2]]");
+
+		// all copied below min length
+		writer = JSON::GatherWriter();
+		writer.write(JSON::Value("ab"));
+		ASSERT_TRUE(writer.count() == 1 && writer.length() == 4);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
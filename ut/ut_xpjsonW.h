@@ -1419,3 +1419,1176 @@ TEST(ut_xpjsonW, zh_cn)
 		ASSERT_TRUE(false);
 	}
 }
+
+TEST(ut_xpjsonW, sso)
+{
+	try {
+		ASSERT_TRUE(sizeof(JSON::ValueW) == JSON::detail::json_sso<wchar_t>::size);
+		ASSERT_TRUE(JSON::detail::json_sso<wchar_t>::capacity >= 7);
+
+		for(size_t l = 0; l < 20; ++l) {
+			wstring str(l, L'a');
+			JSON::ValueW v(str, AUTO_DETECT, false);
+			ASSERT_TRUE(v._sso == (l <= JSON::detail::json_sso<wchar_t>::capacity));
+			ASSERT_TRUE(v.length() == l);
+			ASSERT_TRUE(v == str);
+
+			JSON::ValueW v1(v);
+			ASSERT_TRUE(v1._sso == v._sso);
+			ASSERT_TRUE(v1 == str);
+
+			wstring out;
+			v1.write(out);
+			ASSERT_TRUE(out == L"\"" + str + L"\"");
+		}
+
+		// sso -> string -> sso
+		JSON::ValueW v(L"ab", AUTO_DETECT, false);
+		ASSERT_TRUE(v._sso);
+		v.s() += L" but not short any more";
+		ASSERT_FALSE(v._sso);
+		v.assign(L"ab", AUTO_DETECT, false);
+		ASSERT_TRUE(v._sso);
+		ASSERT_TRUE(v == wstring(L"ab"));
+
+		// sso is preferred to dma
+		const wchar_t* sz = L"abc";
+		v.assign(sz, AUTO_DETECT, true);
+		ASSERT_TRUE(v._sso && !v._dma);
+		wstring long_str(JSON::detail::json_sso<wchar_t>::capacity + 1, L'a');
+		v.assign(long_str, AUTO_DETECT, true);
+		ASSERT_TRUE(!v._sso && v._dma);
+		ASSERT_TRUE(v.c_str() == long_str.c_str());
+		v.clear(JSON::STRING);
+		ASSERT_TRUE(v._sso && v.length() == 0);
+
+		// escaped string read into sso, encoded again on write
+		wstring in(L"[\"a\\nb\",\"\\u0041\"]");
+		v.read(in);
+		ASSERT_TRUE(v[0]._sso && v[0]._e);
+		ASSERT_TRUE(v[0] == wstring(L"a\nb"));
+		ASSERT_TRUE(v[1] == wstring(L"A"));
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == L"[\"a\\nb\",\"A\"]");
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, share)
+{
+	try {
+		JSON::ValueW v;
+		wstring in(L"{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}");
+		v.read(in);
+		ASSERT_FALSE(v.shared());
+
+		// deep copy if not shared
+		JSON::ValueW copy(v);
+		ASSERT_TRUE(copy._o != v._o);
+
+		v.share();
+		ASSERT_TRUE(v.shared());
+		ASSERT_TRUE(v._o->_refs == 1);
+		const JSON::ValueW& cv = v;
+		ASSERT_TRUE(cv.o().find(L"a")->second.shared());
+
+		// O(1) copy
+		JSON::ValueW v1(v);
+		ASSERT_TRUE(v1._o == v._o);
+		ASSERT_TRUE(v._o->_refs == 2);
+		JSON::ValueW v2;
+		v2 = v;
+		ASSERT_TRUE(v2._o == v._o);
+		ASSERT_TRUE(v._o->_refs == 3);
+		ASSERT_TRUE(v2 == v);
+
+		// copy on write, only the path is copied
+		const JSON::ValueW* e = &cv.o().find(L"e")->second;
+		v1[L"a"][L"b"][0] = 100;
+		ASSERT_TRUE(v1._o != v._o);
+		ASSERT_TRUE(v._o->_refs == 2);
+		ASSERT_FALSE(v1.shared());
+		ASSERT_TRUE(v1.o().find(L"e")->second._a == e->_a);
+		ASSERT_TRUE(e->_a->_refs == 2);
+		ASSERT_TRUE(cv.o().find(L"a")->second.o().find(L"b")->second.a()[0] == 1);
+		ASSERT_TRUE(v1[L"a"][L"b"][0] == 100);
+		ASSERT_TRUE(v != v1);
+
+		// mutable access of the last owner does not copy
+		v2.clear();
+		ASSERT_TRUE(v._o->_refs == 1);
+		JSON::ObjectW* o = v._o;
+		v[L"g"] = 1;
+		ASSERT_TRUE(v._o == o);
+		ASSERT_FALSE(v.shared());
+
+		// share again, copy and assign containers
+		v.share();
+		JSON::ValueW v3(JSON::ARRAY);
+		v3.a().push_back(v);
+		v3.a().push_back(v);
+		ASSERT_TRUE(v._o->_refs == 3);
+		v3.clear(JSON::ARRAY);
+		ASSERT_TRUE(v._o->_refs == 1);
+		v3 = v;
+		v3.clear(JSON::OBJECT);
+		ASSERT_TRUE(v3.o().empty());
+		ASSERT_TRUE(v._o->_refs == 1);
+		ASSERT_TRUE(v[L"g"] == 1);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, allocator)
+{
+	try {
+		typedef JSON::ValueT<wchar_t, ut_counting_allocator<wchar_t> > CValueW;
+		ASSERT_TRUE(sizeof(CValueW) == sizeof(JSON::ValueW));
+		{
+			CValueW v;
+			const wchar_t* s = L"{\"a\":[1,2.5,\"a long string which exceeds sso\"],\"b\":{\"c\":\"\\u4e2d\"},\"d\":null}";
+			v.read(s, wcslen(s), false);
+			ASSERT_TRUE(ut_alloc_live() > 0);
+			ASSERT_TRUE(v[L"a"][2] == wstring(L"a long string which exceeds sso"));
+			ASSERT_TRUE(v[L"a"][1].get<wstring>(wstring()) == L"2.5");
+			CValueW::tstring out;
+			v.write(out);
+			ASSERT_TRUE(out == L"{\"a\":[1,2.5,\"a long string which exceeds sso\"],\"b\":{\"c\":\"\\u4e2d\"},\"d\":null}");
+
+			CValueW v1(v);
+			v1[L"a"].a().push_back(CValueW(JSON::OBJECT));
+			v1.share();
+			CValueW v2(v1);
+			ASSERT_TRUE(v1 == v2);
+			v2[L"e"].s() = out;
+		}
+		ASSERT_TRUE(ut_alloc_live() == 0);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, memory_usage)
+{
+	try {
+		JSON::ValueW v;
+		const wchar_t* s = L"{\"a\":\"short\",\"b\":\"a long string which exceeds sso\",\"c\":[1,2,null],\"d\":{\"e\":true}}";
+		v.read(s, wcslen(s));
+		JSON::MemoryUsage mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::NIL] == 1);
+		ASSERT_TRUE(mu.count[JSON::BOOLEAN] == 1);
+		ASSERT_TRUE(mu.count[JSON::INTEGER] == 2);
+		ASSERT_TRUE(mu.count[JSON::STRING] == 2);
+		ASSERT_TRUE(mu.count[JSON::OBJECT] == 2);
+		ASSERT_TRUE(mu.count[JSON::ARRAY] == 1);
+		ASSERT_TRUE(mu.sso_count == 1);
+		ASSERT_TRUE(mu.dma_bytes == wcslen(L"a long string which exceeds sso") * sizeof(wchar_t));
+		ASSERT_TRUE(mu.string_bytes == 0);
+		ASSERT_TRUE(mu.key_bytes == 0);
+		ASSERT_TRUE(mu.shared_bytes == 0);
+		ASSERT_TRUE(mu.container_bytes == 2 * sizeof(JSON::ObjectW) + 5 * (sizeof(JSON::ObjectW::value_type) + JSON::detail::json_map_node_overhead())
+			+ sizeof(JSON::ArrayW) + JSON::detail::json_deque_heap<JSON::ValueW>(3));
+		ASSERT_TRUE(mu.heap_bytes() == mu.container_bytes);
+
+		// owned string and long key
+		v[L"f"].s() = wstring(40, L'x');
+		v[wstring(40, L'k')] = 1;
+		mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::STRING] == 3);
+		ASSERT_TRUE(mu.string_bytes >= sizeof(wstring) + 41 * sizeof(wchar_t));
+		ASSERT_TRUE(mu.key_bytes >= 41 * sizeof(wchar_t));
+
+		// shared subtree, accumulated
+		JSON::MemoryUsage sum;
+		v[L"d"].share();
+		v.memory_usage(sum);
+		v.memory_usage(sum);
+		ASSERT_TRUE(sum.count[JSON::OBJECT] == 4);
+		ASSERT_TRUE(sum.heap_bytes() == 2 * mu.heap_bytes());
+		ASSERT_TRUE(sum.shared_bytes == 2 * (sizeof(JSON::ObjectW) + sizeof(JSON::ObjectW::value_type) + JSON::detail::json_map_node_overhead()));
+		v.share();
+		mu = v.memory_usage();
+		ASSERT_TRUE(mu.shared_bytes == mu.heap_bytes());
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, pointer)
+{
+	try {
+		JSON::ValueW v;
+		// example of RFC 6901
+		const wchar_t* s = L"{\"foo\":[\"bar\",\"baz\"],\"\":0,\"a/b\":1,\"c%d\":2,\"e^f\":3,\"g|h\":4,\"i\\\\j\":5,\"k\\\"l\":6,\" \":7,\"m~n\":8,\"01\":9}";
+		v.read(s, wcslen(s));
+		ASSERT_TRUE(JSON::PointerW(L"").get(v) == &v);
+		ASSERT_TRUE(*JSON::PointerW(L"/foo").get(v) == v[L"foo"]);
+		ASSERT_TRUE(*JSON::PointerW(L"/foo/0").get(v) == wstring(L"bar"));
+		ASSERT_TRUE(*JSON::PointerW(L"/").get(v) == 0);
+		ASSERT_TRUE(*JSON::PointerW(L"/a~1b").get(v) == 1);
+		ASSERT_TRUE(*JSON::PointerW(L"/c%d").get(v) == 2);
+		ASSERT_TRUE(*JSON::PointerW(L"/e^f").get(v) == 3);
+		ASSERT_TRUE(*JSON::PointerW(L"/g|h").get(v) == 4);
+		ASSERT_TRUE(*JSON::PointerW(L"/i\\j").get(v) == 5);
+		ASSERT_TRUE(*JSON::PointerW(L"/k\"l").get(v) == 6);
+		ASSERT_TRUE(*JSON::PointerW(L"/ ").get(v) == 7);
+		ASSERT_TRUE(*JSON::PointerW(L"/m~0n").get(v) == 8);
+		ASSERT_TRUE(*JSON::PointerW(L"/01").get(v) == 9);
+
+		// not found, nothing inserted
+		const size_t size = v.o().size();
+		JSON::PointerW p(L"/foo/2");
+		ASSERT_TRUE(p.size() == 2 && p[0] == L"foo" && p[1] == L"2");
+		ASSERT_TRUE(p.get(v) == NULL);
+		ASSERT_TRUE(JSON::PointerW(L"/foo/01").get(v) == NULL);
+		ASSERT_TRUE(JSON::PointerW(L"/foo/-").get(v) == NULL);
+		ASSERT_TRUE(JSON::PointerW(L"/x/y").get(v) == NULL);
+		ASSERT_TRUE(JSON::PointerW(L"/a~1b/c").get(v) == NULL);
+		ASSERT_TRUE(v.o().size() == size);
+
+		// compile once, resolve many, copy on write by mutable access
+		v.share();
+		JSON::ValueW v1(v);
+		JSON::PointerW p1(L"/foo/1");
+		const JSON::ValueW& cv = v1;
+		ASSERT_TRUE(p1.get(cv) == p1.get(static_cast<const JSON::ValueW&>(v)));
+		*p1.get(v1) = L"qux";
+		ASSERT_TRUE(*p1.get(cv) == wstring(L"qux"));
+		ASSERT_TRUE(v[L"foo"][1] == wstring(L"baz"));
+
+		// invalid pointers
+		ASSERT_THROW(JSON::PointerW(L"foo"), std::logic_error);
+		ASSERT_THROW(JSON::PointerW(L"/foo~"), std::logic_error);
+		ASSERT_THROW(JSON::PointerW(L"/foo~2"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, path)
+{
+	try {
+		JSON::ValueW v;
+		const wchar_t* s = L"{\"store\":{\"book\":["
+			L"{\"category\":\"reference\",\"author\":\"Nigel Rees\",\"title\":\"Sayings of the Century\",\"price\":8.95},"
+			L"{\"category\":\"fiction\",\"author\":\"Evelyn Waugh\",\"title\":\"Sword of Honour\",\"price\":12.99},"
+			L"{\"category\":\"fiction\",\"author\":\"Herman Melville\",\"title\":\"Moby Dick\",\"isbn\":\"0-553-21311-3\",\"price\":8.99},"
+			L"{\"category\":\"fiction\",\"author\":\"J. R. R. Tolkien\",\"title\":\"The Lord of the Rings\",\"isbn\":\"0-395-19395-8\",\"price\":22}],"
+			L"\"bicycle\":{\"color\":\"red\",\"price\":19.95}}}";
+		v.read(s, wcslen(s));
+		vector<const JSON::ValueW*> r;
+
+		ASSERT_TRUE(JSON::PathW(L"$").first(v) == &v);
+		ASSERT_TRUE(JSON::PathW(L"$.store.book[*].author").select(v, r) == 4);
+		ASSERT_TRUE(*r[0] == wstring(L"Nigel Rees") && *r[3] == wstring(L"J. R. R. Tolkien"));
+		ASSERT_TRUE(r[1] == &v[L"store"][L"book"][1][L"author"]);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..author").select(v, r) == 4);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$.store.*").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$.store..price").select(v, r) == 5);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[2].title").select(v, r) == 1 && *r[0] == wstring(L"Moby Dick"));
+		ASSERT_TRUE(*JSON::PathW(L"$..book[-1].price").first(v) == 22);
+		ASSERT_TRUE(*JSON::PathW(L"$['store'][\"bicycle\"]['color']").first(v) == wstring(L"red"));
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$.store.bicycle['color','price']").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[0,1].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[:2].title").select(v, r) == 2 && *r[1] == wstring(L"Sword of Honour"));
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[1:].title").select(v, r) == 3);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[-2:].title").select(v, r) == 2 && *r[0] == wstring(L"Moby Dick"));
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[::-2].title").select(v, r) == 2 && *r[0] == wstring(L"The Lord of the Rings"));
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[?(@.isbn)].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[?(@.price < 10)].title").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[?(@.price >= 12.99)]").select(v, r) == 2);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[?(@.category == 'fiction')].author").select(v, r) == 3);
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[?(@.category != \"fiction\")].author").select(v, r) == 1 && *r[0] == wstring(L"Nigel Rees"));
+		r.clear();
+		ASSERT_TRUE(JSON::PathW(L"$..book[*].price[?(@ == 22)]").select(v, r) == 0);
+		ASSERT_TRUE(JSON::PathW(L"$..*").select(v, r) == 27);
+		r.clear();
+
+		// limit & short-circuit
+		ASSERT_TRUE(JSON::PathW(L"$..price").select(v, r, 2) == 2 && r.size() == 2);
+		ASSERT_TRUE(JSON::PathW(L"$.store.book[9]").first(v) == NULL);
+		ASSERT_TRUE(JSON::PathW(L"$.nothing.here").first(v) == NULL);
+
+		// invalid expressions
+		ASSERT_THROW(JSON::PathW(L"store"), std::logic_error);
+		ASSERT_THROW(JSON::PathW(L"$.store["), std::logic_error);
+		ASSERT_THROW(JSON::PathW(L"$.a[::0]"), std::logic_error);
+		ASSERT_THROW(JSON::PathW(L"$.a[?(@.b = 1)]"), std::logic_error);
+		ASSERT_THROW(JSON::PathW(L"$.a[?(@.b == x)]"), std::logic_error);
+		ASSERT_THROW(JSON::PathW(L"$.a['b]"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, read_mask)
+{
+	try {
+		const wchar_t* s = L"{\"id\":7,\"name\":\"a long name of the document\",\"skip\":{\"x\":[1,{\"y\":\"}]\\\"\"}],\"z\":-1.5e3},"
+			L"\"user\":{\"name\":\"u\",\"age\":30,\"tags\":[\"a\",\"b\"]},\"items\":[{\"price\":1,\"n\":\"x\"},{\"price\":2.5,\"n\":\"y\"},{\"n\":\"z\"}],"
+			L"\"list\":[10,20,30,40],\"k\\u0065y\":true,\"nil\":null}";
+		JSON::MaskW mask;
+		mask.add(L"/id").add(L"/user/name").add(L"/items/*/price").add(L"/list/2").add(L"/key").add(L"/nil").add(L"/missing/x");
+		JSON::ValueW v;
+		ASSERT_TRUE(v.read(s, wcslen(s), mask) == wcslen(s));
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"id\":7,\"items\":[{\"price\":1},{\"price\":2.5},{}],\"key\":true,\"list\":[null,null,30],\"nil\":null,\"user\":{\"name\":\"u\"}}");
+
+		// name matches before wildcard, whole subtree
+		JSON::MaskW mask1;
+		mask1.add(L"/items/1").add(L"/items/*/n").add(L"/user").add(L"/user/name").add(L"/skip/x/1/y");
+		v.read(s, wcslen(s), mask1);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"items\":[{\"n\":\"x\"},{\"n\":\"y\",\"price\":2.5},{\"n\":\"z\"}],\"skip\":{\"x\":[null,{\"y\":\"}]\\\"\"}]},\"user\":{\"age\":30,\"name\":\"u\",\"tags\":[\"a\",\"b\"]}}");
+
+		// empty pointer includes the whole document
+		JSON::MaskW all;
+		all.add(L"");
+		JSON::ValueW v1, v2;
+		JSON::ReaderW::read(v1, s, wcslen(s), all);
+		v2.read(s, wcslen(s));
+		ASSERT_TRUE(v1 == v2);
+
+		// empty mask
+		JSON::MaskW none;
+		ASSERT_TRUE(v.read(L" [1,[2,{\"a\":\"]\"}],3] ", 21, none) == 20);
+		ASSERT_TRUE(v.type() == JSON::ARRAY && v.a().empty());
+
+		ASSERT_THROW(v.read(L"{\"id\":[1,2}", 11, none), std::logic_error);
+		ASSERT_THROW(v.read(L"{\"id\":\"1}", 9, none), std::logic_error);
+		ASSERT_THROW(v.read(L"{\"id\" 1}", 8, mask), std::logic_error);
+		ASSERT_THROW(v.read(L"{\"id\":1 \"a\":2}", 14, mask), std::logic_error);
+		ASSERT_THROW(v.read(L"1", 1, mask), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, skip_raw)
+{
+	try {
+		// quotes, escapes and brackets inside strings, long enough for simd
+		const wchar_t* s = L"  {\"a\":[1,2,{\"b\":\"x]}\\\\\\\"{[\"}],\"long string without any structural character\":\"\\\"\\\\\",\"c\":[[[[]]]]} ,1";
+		const size_t end = wcslen(s) - 3; // " ,1" follows
+		ASSERT_TRUE(JSON::skip(s, wcslen(s)) == end);
+		ASSERT_TRUE(JSON::skip(L"\"abc\\\"\" ", 8) == 7);
+		ASSERT_TRUE(JSON::skip(L" -12.5e3,", 9) == 8);
+		ASSERT_TRUE(JSON::skip(L"true]", 5) == 4);
+		ASSERT_TRUE(JSON::skip(L"[]", 2) == 2);
+		ASSERT_THROW(JSON::skip(L"{\"a\":[1,2}", 10), std::logic_error);
+		ASSERT_THROW(JSON::skip(L"[\"a\\\"]", 6), std::logic_error);
+		ASSERT_THROW(JSON::skip(L"\"a\\", 3), std::logic_error);
+
+		// raw value is written verbatim
+		JSON::ValueW v;
+		v[L"a"] = 1;
+		v[L"b"].raw(s + 2, end - 2);
+		ASSERT_TRUE(v[L"b"].type() == JSON::RAW);
+		ASSERT_TRUE(v[L"b"].length() == end - 2 && v[L"b"].c_str() == s + 2);
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"a\":1,\"b\":" + wstring(s + 2, end - 2) + L"}");
+		JSON::ValueW v1(v);
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1[L"b"].get<wstring>(wstring()) == wstring(s + 2, end - 2));
+		JSON::ValueW parsed;
+		parsed.read(v[L"b"].c_str(), v[L"b"].length());
+		ASSERT_TRUE(parsed[L"c"][0][0][0].a().empty());
+
+		// proxy: rewrite one field, forward the rest as is
+		const wchar_t* doc = L"{\"id\":1,\"user\":{\"name\":\"n\",\"tags\":[\"x\", \"y\"]},\"list\":[1, {\"k\":null}, \"s\"],\"flag\":true}";
+		JSON::MaskW mask(true);
+		mask.add(L"/user/name").add(L"/list/1/k");
+		v.read(doc, wcslen(doc), mask);
+		ASSERT_TRUE(v[L"id"].type() == JSON::RAW && v[L"flag"].type() == JSON::RAW);
+		ASSERT_TRUE(v[L"user"][L"tags"].type() == JSON::RAW);
+		ASSERT_TRUE(v[L"list"][0].type() == JSON::RAW && v[L"list"][2].type() == JSON::RAW);
+		ASSERT_TRUE(v[L"list"][1][L"k"].type() == JSON::NIL);
+		v[L"user"][L"name"] = L"m";
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"flag\":true,\"id\":1,\"list\":[1,{\"k\":null},\"s\"],\"user\":{\"name\":\"m\",\"tags\":[\"x\", \"y\"]}}");
+
+		JSON::MemoryUsage mu = v.memory_usage();
+		ASSERT_TRUE(mu.count[JSON::RAW] == 5);
+		ASSERT_TRUE(mu.dma_bytes == wcslen(L"1true1\"s\"[\"x\", \"y\"]") * sizeof(wchar_t));
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, read_lazy)
+{
+	try {
+		const wchar_t* s = L" {\"id\":12,\"name\":\"a long name of the document\",\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]},\"bad\":[1,2 x]} ";
+		JSON::ValueW v;
+		ASSERT_TRUE(v.read_lazy(s, wcslen(s)) == wcslen(s) - 1);
+		ASSERT_TRUE(v._type == JSON::RAW && v._e);
+
+		// touched level by level
+		ASSERT_TRUE(v.type() == JSON::OBJECT);
+		ASSERT_TRUE(v._o->size() == 4);
+		ASSERT_TRUE(v._o->find(L"user")->second._type == JSON::RAW);
+		ASSERT_TRUE(v[L"id"].i() == 12);
+		ASSERT_TRUE(v.get(L"name", wstring()) == L"a long name of the document");
+		const JSON::ValueW& user = v.o().find(L"user")->second;
+		ASSERT_TRUE(user.o().find(L"name")->second == wstring(L"u\n"));
+		ASSERT_TRUE(user._o->find(L"tags")->second._type == JSON::RAW);
+		ASSERT_TRUE(v[L"user"][L"tags"][1].f() == 1.5);
+		ASSERT_TRUE(v[L"user"][L"tags"]._a->at(2)._type == JSON::RAW);
+		ASSERT_TRUE(v[L"user"][L"tags"][2] == true);
+		ASSERT_TRUE(v[L"user"][L"tags"][3].type() == JSON::NIL);
+		ASSERT_TRUE(*JSON::PointerW(L"/user/tags/0").get(v) == wstring(L"a"));
+
+		// untouched values are written verbatim, invalid ones throw when touched
+		JSON::ValueW v1;
+		v1.read_lazy(s, wcslen(s));
+		v1[L"id"] = 13;
+		wstring out;
+		v1.write(out);
+		ASSERT_TRUE(out == L"{\"bad\":[1,2 x],\"id\":13,\"name\":\"a long name of the document\",\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]}}");
+		ASSERT_THROW(v1[L"bad"].a(), std::logic_error);
+
+		// errors leave values lazy, every touch throws again
+		ASSERT_THROW(v1[L"bad"].a(), std::logic_error);
+		ASSERT_TRUE(v1[L"bad"]._type == JSON::RAW && v1[L"bad"]._e);
+		JSON::ValueW broken;
+		broken.read_lazy(L"{\"a\":1,\"b\": }", 13);
+		ASSERT_THROW(broken.type(), std::logic_error);
+		ASSERT_THROW(broken.type(), std::logic_error);
+		ASSERT_THROW(broken.o().size(), std::logic_error);
+
+		// copies are lazy too, share touches all
+		const wchar_t* s2 = L"{\"user\":{\"name\":\"u\\n\",\"tags\":[\"a\", 1.5, true, null]}}";
+		JSON::ValueW v2;
+		v2.read_lazy(s2, wcslen(s2));
+		JSON::ValueW v3(v2);
+		ASSERT_TRUE(v3._type == JSON::RAW && v3._e);
+		ASSERT_TRUE(v3 == v2);
+		v2.share();
+		ASSERT_TRUE(v2._o->find(L"user")->second._o->find(L"tags")->second._a->at(0)._type == JSON::STRING);
+		JSON::ValueW full;
+		full.read(s2, wcslen(s2));
+		ASSERT_TRUE(full == v2);
+
+		ASSERT_THROW(v.read_lazy(L" 1", 2), std::logic_error);
+		ASSERT_THROW(v.read_lazy(L"{\"a\":[}", 7), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, document)
+{
+	try {
+		const wchar_t* s = L" {\"id\":-12, \"pi\" : 3.5e1, \"name\":\"a\\tb\\u00e9\", \"ok\":true,\"no\":false,\"nil\":null,"
+			L"\"list\":[[1, 2], {}, [], {\"k\":\"v\"}, \"x\"],\"user\":{\"tags\":[\"a\",\"b\"],\"age\":20}} ";
+		JSON::DocumentW doc;
+		ASSERT_TRUE(doc.read(s) == wcslen(s) - 1);
+
+		// tape: opener jumps past its closer, closer counts members
+		const JSON::DocumentW::tape_type& tape = doc.tape();
+		ASSERT_TRUE((tape[0] >> 56) == '{' && (tape[0] & 0xFFFFFFFFFFFFFFULL) == tape.size());
+		ASSERT_TRUE((tape.back() >> 56) == '}' && (tape.back() & 0xFFFFFFFFFFFFFFULL) == 8);
+		ASSERT_TRUE((tape[1] >> 56) == '\"' && tape[2] == 2 && (tape[3] >> 56) == 'l' && int64_t(tape[4]) == -12);
+
+		JSON::CursorW root = doc.root();
+		ASSERT_TRUE(root.type() == JSON::OBJECT && root.size() == 8);
+		ASSERT_TRUE(root[L"id"].i() == -12);
+		ASSERT_TRUE(root[L"pi"].f() == 35.0);
+		ASSERT_TRUE(root[L"name"].s() == L"a\tb\x00e9" && root[L"name"].length() == 4 && root[L"name"].c_str()[4] == 0);
+		ASSERT_TRUE(root[L"ok"].b() && !root[L"no"].b() && root[L"nil"].type() == JSON::NIL);
+		ASSERT_TRUE(root[L"user"][L"tags"][1].s() == L"b");
+		ASSERT_TRUE(root[L"user"][L"age"].i() == 20);
+		ASSERT_TRUE(root[L"list"].size() == 5 && root[L"list"][3][L"k"].s() == L"v" && root[L"list"][4].s() == L"x");
+		ASSERT_TRUE(root[L"list"][1].size() == 0 && root[L"list"][1].begin() == root[L"list"][1].end());
+		ASSERT_TRUE(!root[L"none"].valid() && !root[L"list"][5].valid());
+		ASSERT_THROW(root[L"id"].s(), std::logic_error);
+		ASSERT_THROW(root[L"none"].type(), std::logic_error);
+
+		// iteration in document order, containers are jumped over
+		wstring keys;
+		for(JSON::CursorW it = root.begin(); it != root.end(); ++it) keys += it.key().s() + L",";
+		ASSERT_TRUE(keys == L"id,pi,name,ok,no,nil,list,user,");
+		size_t n = 0;
+		for(JSON::CursorW it = root[L"list"].begin(); it != root[L"list"].end(); ++it) ++n;
+		ASSERT_TRUE(n == 5);
+
+		// same result as value tree
+		JSON::ValueW v, v1;
+		root.to_value(v);
+		v1.read(s);
+		ASSERT_TRUE(v == v1);
+		ASSERT_TRUE(v[L"name"] == wstring(L"a\tb\x00e9"));
+
+		JSON::DocumentW doc1(L"[]", 2);
+		ASSERT_TRUE(doc1.root().size() == 0 && doc1.tape().size() == 2);
+		ASSERT_TRUE(!JSON::DocumentW().root().valid());
+
+		ASSERT_THROW(doc.read(L"1"), std::logic_error);
+		ASSERT_THROW(doc.read(L"{\"a\":1,}"), std::logic_error);
+		ASSERT_THROW(doc.read(L"{\"a\" 1}"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[1 2]"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[1,2}"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[01]"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[tru]"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[\"a]"), std::logic_error);
+		ASSERT_THROW(doc.read(L"[[1]"), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, read_file)
+{
+	const char* path = "ut_xpjsonW_read_file.json";
+	try {
+		const wchar_t* s = L"{\"name\":\"a long string beyond sso\",\"list\":[1, 2.5, \"x\\ny\"]}\n";
+		FILE* fp = fopen(path, "wb");
+		ASSERT_TRUE(fp != NULL);
+		fwrite(s, sizeof(wchar_t), wcslen(s), fp);
+		fclose(fp);
+
+		// strings point into the mapping owned by value
+		JSON::FileValueW v;
+		ASSERT_TRUE(JSON::ReaderW::read_file(v, path) == wcslen(s) - 1);
+		ASSERT_TRUE(v.mapped() == (__XPJSON_SUPPORT_MMAP__ != 0));
+		ASSERT_TRUE(v[L"name"]._dma && v[L"name"] == wstring(L"a long string beyond sso"));
+		ASSERT_TRUE(v[L"list"][2] == wstring(L"x\ny"));
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"list\":[1,2.5,\"x\\ny\"],\"name\":\"a long string beyond sso\"}");
+
+		JSON::ValueW v1;
+		v1.read(s);
+		JSON::FileValueW v2(path, false);
+		ASSERT_TRUE(!v2[L"name"]._dma && v2 == v1 && v == v1);
+
+		JSON::DocumentW doc;
+		ASSERT_TRUE(JSON::ReaderW::read_file(doc, path) == wcslen(s) - 1);
+		ASSERT_TRUE(doc.root()[L"list"][1].f() == 2.5);
+
+		// empty file is read by buffer
+		fp = fopen(path, "wb");
+		fclose(fp);
+		ASSERT_THROW(v.read_file(path), std::logic_error);
+		ASSERT_TRUE(!v.mapped() && v.type() == JSON::NIL);
+		remove(path);
+		ASSERT_THROW(v.read_file(path), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		remove(path);
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, snapshot)
+{
+	const char* path = "ut_xpjsonW_snapshot.bin";
+	try {
+		const wchar_t* s = L"{\"list\":[{\"id\":1,\"name\":\"x\"},{\"id\":2,\"name\":\"x\"},{\"id\":3,\"name\":\"y\\n\"}],\"pi\":3.25,\"ok\":true,\"nil\":null,\"raw\":0}";
+		JSON::ValueW v;
+		v.read(s);
+		v[L"raw"].raw(L"[1, {\"a\":\"b\"}]", 14);
+		JSON::DocumentW doc;
+		doc.assign(v);
+		// distinct strings are stored once
+		ASSERT_TRUE(doc.strings().size() == wcslen(L"list_id_name_x_y\n_pi_ok_nil_raw_a_b_"));
+		ASSERT_TRUE(doc.root()[L"raw"][1][L"a"].s() == L"b");
+
+		string bin;
+		doc.save(bin);
+		FILE* fp = fopen(path, "wb");
+		ASSERT_TRUE(fp != NULL);
+		fwrite(bin.data(), 1, bin.size(), fp);
+		fclose(fp);
+
+		// mapped & used in place
+		JSON::SnapshotW snap(path);
+		JSON::CursorW root = snap.root();
+		ASSERT_TRUE(root[L"list"].size() == 3 && root[L"list"][2][L"name"].s() == L"y\n");
+		ASSERT_TRUE(root[L"pi"].f() == 3.25 && root[L"ok"].b() && root[L"nil"].type() == JSON::NIL);
+		JSON::ValueW v1, v2;
+		snap.to_value(v1);
+		v2.read(s);
+		v2[L"raw"].read(L"[1, {\"a\":\"b\"}]");
+		ASSERT_TRUE(v1 == v2);
+
+		// in memory, by copy & in place
+		vector<uint64_t> buf(bin.size() / 8 + 1);
+		memcpy(&buf[0], bin.data(), bin.size());
+		JSON::DocumentW doc1;
+		doc1.load(&buf[0], bin.size());
+		ASSERT_TRUE(doc1.tape() == doc.tape() && doc1.strings() == doc.strings());
+		JSON::SnapshotW snap1;
+		ASSERT_TRUE(!snap1.root().valid());
+		snap1.attach(&buf[0], bin.size());
+		ASSERT_TRUE(snap1.root()[L"list"][1][L"id"].i() == 2);
+
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size() - 1), std::logic_error);
+		ASSERT_THROW(snap1.attach(reinterpret_cast<char*>(&buf[0]) + 1, bin.size()), std::logic_error);
+		ASSERT_THROW(JSON::Snapshot().attach(&buf[0], bin.size()), std::logic_error);
+		// corrupted tape is rejected before use, tape follows 32 bytes header: {"list":[...
+		const uint64_t key = buf[5], jump = buf[7];
+		buf[5] = (key >> 56 << 56) | doc.strings().size();
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[5] = key;
+		buf[7] = jump - 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		buf[7] = jump;
+		snap1.attach(&buf[0], bin.size());
+		buf[0] ^= 1;
+		ASSERT_THROW(snap1.attach(&buf[0], bin.size()), std::logic_error);
+		ASSERT_THROW(JSON::DocumentW().save(bin), std::logic_error);
+		remove(path);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		remove(path);
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, msgpack)
+{
+	try {
+		JSON::ValueW v;
+		v[L"a"] = 1;
+		string out;
+		JSON::MsgPackW::write(v, out);
+		ASSERT_TRUE(out == string("\x81\xa1" "a\x01", 4));
+
+		// text is UTF-8 on the wire
+		const wchar_t* s = L"[-33,65536,1.5,0.1,true,null,\"\\u00e9\\u4e2d\\ud83d\\ude00\",{\"k\\u00e9\":[]}]";
+		v.read(s);
+		out.clear();
+		JSON::MsgPackW::write(v, out);
+		const char expected[] = "\x98\xd0\xdf\xce\x00\x01\x00\x00\xca\x3f\xc0\x00\x00\xcb\x3f\xb9\x99\x99\x99\x99\x99\x9a\xc3\xc0"
+			"\xa9\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80\x81\xa3k\xc3\xa9\x90";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+		ASSERT_TRUE(JSON::MsgPackW::size(v) == out.size());
+
+		JSON::ValueW v1;
+		ASSERT_TRUE(JSON::MsgPackW::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		JSON::Value v2;
+		JSON::MsgPack::read(v2, out.data(), out.size());
+		ASSERT_TRUE(v2[6] == string("\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80"));
+
+		// raw values are parsed, fixed buffer
+		v.clear();
+		v[L"k"].raw(L"[1, \"x\"]", 8);
+		char buf[8];
+		ASSERT_TRUE(JSON::MsgPackW::write(v, buf, sizeof(buf)) == 7);
+		ASSERT_TRUE(string(buf, 7) == string("\x81\xa1k\x92\x01\xa1x", 7));
+		ASSERT_THROW(JSON::MsgPackW::write(v, buf, 6), std::length_error);
+
+		ASSERT_THROW(JSON::MsgPackW::read(v1, "\xa2\xc3\x28", 3), std::logic_error);
+		ASSERT_THROW(JSON::MsgPackW::read(v1, "\xa1\xff", 2), std::logic_error);
+		ASSERT_THROW(JSON::MsgPackW::read(v1, "\x81\x01\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::MsgPackW::read(v1, "\xd4\x01\x01", 3), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, cbor)
+{
+	try {
+		JSON::ValueW v;
+		v[L"a"] = 1;
+		string out;
+		JSON::CborW::write(v, out);
+		ASSERT_TRUE(out == string("\xa1\x61" "a\x01", 4));
+
+		// text is UTF-8 on the wire
+		const wchar_t* s = L"[-33,65504.0,1.5,0.1,true,null,\"\\u00e9\\u4e2d\\ud83d\\ude00\",{\"k\\u00e9\":[]}]";
+		v.read(s);
+		out.clear();
+		JSON::CborW::write(v, out);
+		const char expected[] = "\x88\x38\x20\xf9\x7b\xff\xf9\x3e\x00\xfb\x3f\xb9\x99\x99\x99\x99\x99\x9a\xf5\xf6"
+			"\x69\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80\xa1\x63k\xc3\xa9\x80";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+		ASSERT_TRUE(JSON::CborW::size(v) == out.size());
+
+		JSON::ValueW v1;
+		ASSERT_TRUE(JSON::CborW::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		JSON::Value v2;
+		JSON::Cbor::read(v2, out.data(), out.size());
+		ASSERT_TRUE(v2[6] == string("\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80"));
+
+		// indefinite length containers & strings
+		out.clear();
+		JSON::CborW::write(v, out, true);
+		ASSERT_TRUE(out.size() == JSON::CborW::size(v, true));
+		ASSERT_TRUE(JSON::CborW::read(v1, out.data(), out.size()) == out.size() && v1 == v);
+		ASSERT_TRUE(JSON::CborW::read(v1, "\x7f\x62\xc3\xa9\x61" "c\xff", 7) == 7 && v1 == wstring(L"\x00e9" L"c"));
+
+		// raw values are parsed, fixed buffer
+		v.clear();
+		v[L"k"].raw(L"[1, \"x\"]", 8);
+		char buf[8];
+		ASSERT_TRUE(JSON::CborW::write(v, buf, sizeof(buf)) == 7);
+		ASSERT_TRUE(string(buf, 7) == string("\xa1\x61k\x82\x01\x61x", 7));
+		ASSERT_THROW(JSON::CborW::write(v, buf, 6), std::length_error);
+
+		ASSERT_THROW(JSON::CborW::read(v1, "\x62\xc3\x28", 3), std::logic_error);
+		ASSERT_THROW(JSON::CborW::read(v1, "\xa1\xf5\x01", 3), std::logic_error);
+		ASSERT_THROW(JSON::CborW::read(v1, "\x9f\x01", 2), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, bson_ubjson)
+{
+	try {
+		// BSON, text is UTF-8 on the wire
+		JSON::ValueW v;
+		v[L"hello"] = L"world";
+		string out;
+		JSON::BsonW::write(v, out);
+		ASSERT_TRUE(out == string("\x16\x00\x00\x00\x02hello\x00\x06\x00\x00\x00world\x00\x00", 22));
+
+		v.read(L"{\"k\\u00e9\":[-1,5000000000,1.5,true,null,\"\\u4e2d\\ud83d\\ude00\"]}");
+		out.clear();
+		JSON::BsonW::write(v, out);
+		const char expected[] = "\x42\x00\x00\x00\x04k\xc3\xa9\x00\x38\x00\x00\x00\x10" "0\x00\xff\xff\xff\xff"
+			"\x12" "1\x00\x00\xf2\x05\x2a\x01\x00\x00\x00\x01" "2\x00\x00\x00\x00\x00\x00\x00\xf8\x3f\x08" "3\x00\x01\x0a" "4\x00"
+			"\x02" "5\x00\x08\x00\x00\x00\xe4\xb8\xad\xf0\x9f\x98\x80\x00\x00\x00";
+		ASSERT_TRUE(out == string(expected, sizeof(expected) - 1));
+		JSON::ValueW v1;
+		ASSERT_TRUE(JSON::BsonW::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		ASSERT_THROW(JSON::BsonW::read(v1, "\x09\x00\x00\x00\x0a\xc3\x28\x00\x00", 9), std::logic_error);
+
+		// UBJSON
+		out.clear();
+		JSON::UbjsonW::write(v, out);
+		ASSERT_TRUE(out.size() == JSON::UbjsonW::size(v));
+		ASSERT_TRUE(JSON::UbjsonW::read(v1, out.data(), out.size()) == out.size());
+		ASSERT_TRUE(v1 == v);
+		JSON::Value v2;
+		JSON::Ubjson::read(v2, out.data(), out.size());
+		ASSERT_TRUE(v2["k\xc3\xa9"][5] == string("\xe4\xb8\xad\xf0\x9f\x98\x80"));
+
+		// high-precision numbers are parsed
+		JSON::UbjsonW::read(v1, "Hi\x02" "-7", 5);
+		ASSERT_TRUE(v1.type() == JSON::INTEGER && v1.i() == -7);
+		JSON::UbjsonW::read(v1, "HU\x1e" "123456789012345678901234567890", 33);
+		ASSERT_TRUE(v1.type() == JSON::FLOAT && v1.f() == 123456789012345678901234567890.0);
+		ASSERT_THROW(JSON::UbjsonW::read(v1, "Si\x02\xc3\x28", 5), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, hash)
+{
+	try {
+		const wchar_t* s = L"{\"a\":[1,2.5,true,null,\"text longer than small string\"],\"b\":{\"c\":\"\\u4e2d\\ud83d\\ude00\"},\"d\":-0.0}";
+		JSON::ValueW v, v1;
+		v.read(s);
+		v1.read(s);
+		ASSERT_TRUE(v.hash() == v1.hash() && v.o().hash() == v.hash() && v[L"a"].a().hash() == v[L"a"].hash());
+		const uint64_t h = v.hash();
+		v1[L"b"][L"c"] = L"\x4e2d";
+		ASSERT_TRUE(v1.hash() != h);
+
+		// the same as char, strings are hashed as UTF-8
+		JSON::Value n;
+		n.read("{\"a\":[1,2.5,true,null,\"text longer than small string\"],\"b\":{\"c\":\"\xe4\xb8\xad\xf0\x9f\x98\x80\"},\"d\":0.0}");
+		ASSERT_TRUE(n.hash() == h);
+
+		// raw as parsed, memoized on shared trees
+		JSON::ValueW v2;
+		v2.raw(s, wcslen(s));
+		ASSERT_TRUE(v2.hash() == h);
+		v.share();
+		const JSON::ValueW& cv = v;
+		ASSERT_TRUE(cv.hash() == h && cv.o()._hash == h);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, equal)
+{
+	try {
+		// wide strings are compared in full
+		ASSERT_TRUE(JSON::ValueW(L"ab") != JSON::ValueW(L"ac"));
+		ASSERT_TRUE(JSON::ValueW(L"text longer than small string") != JSON::ValueW(L"text longer than small strinG"));
+		JSON::ValueW v, v1;
+		v.raw(L"[1,2]", 5);
+		v1.raw(L"[1,3]", 5);
+		ASSERT_TRUE(v != v1);
+
+		v.read(L"{\"a\":[1,2,3,0.1,\"\\u4e2d\"],\"b\":{\"c\":1.0e-9}}");
+		v1.read(L"{\"a\":[1,2,3,0.1,\"\\u4e2d\"],\"b\":{\"c\":1.0e-9}}");
+		ASSERT_TRUE(v == v1);
+		v1[L"a"][4] = L"\x4e2e";
+		ASSERT_TRUE(v != v1);
+		v1[L"a"][4] = L"\x4e2d";
+		v1[L"b"][L"c"] = 2e-9;
+		ASSERT_TRUE(v != v1 && JSON::equal(v, v1, 1e-8));
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, json_patch)
+{
+	try {
+		JSON::ValueW a, b, p;
+		a.read(L"{\"a\":[1,2,3,4,5],\"\\u4e2d/~\":{\"c\":1}}");
+		b.read(L"{\"a\":[1,9,3,5,6],\"\\u4e2d/~\":{\"c\":\"\\u00e9\"}}");
+		JSON::diff(a, b, p);
+		wstring out;
+		p.write(out);
+		ASSERT_TRUE(out == L"[{\"op\":\"replace\",\"path\":\"/a/1\",\"value\":9},{\"op\":\"remove\",\"path\":\"/a/3\"},"
+			L"{\"op\":\"add\",\"path\":\"/a/4\",\"value\":6},{\"op\":\"replace\",\"path\":\"\\/\\u4e2d~1~0\\/c\",\"value\":\"\\u00e9\"}]");
+		JSON::apply_patch(a, p);
+		ASSERT_TRUE(a == b);
+
+		p.read(L"[{\"op\":\"move\",\"from\":\"/\\u4e2d~1~0\",\"path\":\"/m\"},{\"op\":\"test\",\"path\":\"/m/c\",\"value\":\"\\u00e9\"}]");
+		JSON::apply_patch(a, p);
+		out.clear();
+		a.write(out);
+		ASSERT_TRUE(out == L"{\"a\":[1,9,3,5,6],\"m\":{\"c\":\"\\u00e9\"}}");
+		p.read(L"[{\"op\":\"test\",\"path\":\"/m/c\",\"value\":\"e\"}]");
+		ASSERT_THROW(JSON::apply_patch(a, p), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, merge_patch)
+{
+	try {
+		JSON::ValueW v, p;
+		v.read(L"{\"a\":{\"b\":\"c\",\"\\u4e2d\":[1]},\"e\":null,\"k\":{\"x\":1}}");
+		const JSON::ObjectW* k = &v[L"k"].o();
+		p.read(L"{\"a\":{\"b\":null,\"\\u4e2d\":{\"d\":null,\"f\":\"\\u00e9\"}},\"g\":[null]}");
+		JSON::merge_patch(v, p);
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"a\":{\"\\u4e2d\":{\"f\":\"\\u00e9\"}},\"e\":null,\"g\":[null],\"k\":{\"x\":1}}");
+		ASSERT_TRUE(&v[L"k"].o() == k);
+
+		// same patch while parsing
+		JSON::ValueW v1;
+		v1.read(L"{\"a\":{\"b\":\"c\",\"\\u4e2d\":[1]},\"e\":null,\"k\":{\"x\":1}}");
+		const wchar_t* s = L"{\"a\":{\"b\":null,\"\\u4e2d\":{\"d\":null,\"f\":\"\\u00e9\"}},\"g\":[null]}";
+		ASSERT_TRUE(v1.read_merge(s, wcslen(s), false) == wcslen(s));
+		ASSERT_TRUE(v1 == v);
+		ASSERT_TRUE(v1.read_merge(L" \"\\u4e2d\"", 9) == 9 && v1.type() == JSON::STRING && v1.s() == L"\u4e2d");
+		ASSERT_THROW(v1.read_merge(L"{\"a\":1", 6), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+namespace ut_bindW
+{
+	struct Item
+	{
+		Item() : n(0), f(0.0f) {}
+		wstring name;
+		unsigned short n;
+		float f;
+		vector<wstring> tags;
+		JSON_BIND(Item, JSON_FIELD(name) JSON_FIELD(n) JSON_FIELD(f) JSON_FIELD_AS(tags, "t/a\"g"))
+	};
+
+	struct Counter
+	{
+		Counter() : big(0), small(0), neg(0) {}
+		uint64_t big;
+		unsigned short small;
+		signed char neg;
+		JSON_BIND(Counter, JSON_FIELD(big) JSON_FIELD(small) JSON_FIELD(neg))
+	};
+
+	struct Duplicate
+	{
+		Duplicate() : a(0), x(0) {}
+		int a;
+		int x;
+		JSON_BIND(Duplicate, JSON_FIELD_AS(a, "x") JSON_FIELD(x))
+	};
+}
+
+TEST(ut_xpjsonW, binder)
+{
+	try {
+		const wchar_t* in = L"[{\"name\":\"\\u4e2d\u6587\",\"n\":7,\"f\":0.5,\"t\\/a\\\"g\":[\"a\",\"\\n\"]},null,{\"n\":1,\"x\":[]}]";
+		vector<ut_bindW::Item> items;
+		ASSERT_TRUE(JSON::BinderW::read(items, in, wcslen(in)) == wcslen(in));
+		ASSERT_TRUE(items.size() == 3 && items[0].name == L"\u4e2d\u6587" && items[0].n == 7 && items[0].f == 0.5f);
+		ASSERT_TRUE(items[0].tags.size() == 2 && items[0].tags[1] == L"\n" && items[1].name.empty() && items[2].n == 1);
+
+		wstring out;
+		JSON::BinderW::write(items[0], out);
+		ASSERT_TRUE(out == L"{\"name\":\"\\u4e2d\\u6587\",\"n\":7,\"f\":0.5,\"t\\/a\\\"g\":[\"a\",\"\\n\"]}");
+		JSON::ValueW v;
+		v.read(out);
+		ASSERT_TRUE(v[L"t/a\"g"][1] == wstring(L"\n") && v[L"name"] == wstring(L"\u4e2d\u6587"));
+		ASSERT_THROW(JSON::BinderW::read(items, wstring(L"[{\"n\":true}]")), std::logic_error);
+
+		// integers in range of members, or rejected
+		ut_bindW::Counter c;
+		c.big = ~static_cast<uint64_t>(0);
+		c.small = 65535;
+		c.neg = -128;
+		wstring counter;
+		JSON::BinderW::write(c, counter);
+		ASSERT_TRUE(counter == L"{\"big\":18446744073709551615,\"small\":65535,\"neg\":-128}");
+		ut_bindW::Counter c1;
+		ASSERT_TRUE(JSON::BinderW::read(c1, counter) == counter.size() && c1.big == c.big && c1.small == 65535 && c1.neg == -128);
+		JSON::BinderW::read(c1, wstring(L"{\"big\":-0,\"neg\":127}"));
+		ASSERT_TRUE(c1.big == 0 && c1.neg == 127);
+		ASSERT_THROW(JSON::BinderW::read(c1, wstring(L"{\"small\":70000}")), std::logic_error);
+		ASSERT_THROW(JSON::BinderW::read(c1, wstring(L"{\"small\":-1}")), std::logic_error);
+		ASSERT_THROW(JSON::BinderW::read(c1, wstring(L"{\"neg\":-129}")), std::logic_error);
+		ASSERT_THROW(JSON::BinderW::read(c1, wstring(L"{\"big\":18446744073709551616}")), std::logic_error);
+		ASSERT_THROW(JSON::BinderW::read(c1, wstring(L"{\"big\":1e3}")), std::logic_error);
+
+		// keys of fields must be unique, checked on every use
+		ut_bindW::Duplicate d;
+		ASSERT_THROW(JSON::BinderW::read(d, wstring(L"{}")), std::logic_error);
+		ASSERT_THROW(JSON::BinderW::write(d, counter), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, schema)
+{
+	try {
+		JSON::ValueW s;
+		s.read(L"{\"properties\":{\"k\":{\"type\":\"string\",\"maxLength\":2,\"pattern\":\"^\\u4e2d\"},"
+			L"\"n\":{\"maximum\":5}},\"additionalProperties\":{\"type\":\"boolean\"},\"minProperties\":1}");
+		JSON::SchemaW schema(s);
+		JSON::ValueW v;
+		const wchar_t* in = L"{\"k\":\"\u4e2d\\ud83d\\ude00\",\"n\":5,\"x\":true}";
+		ASSERT_TRUE(schema.read(v, in, wcslen(in)) == wcslen(in) && schema.validate(v));
+		ASSERT_TRUE(v[L"k"].s().size() == (sizeof(wchar_t) == 2 ? 3 : 2));
+
+		string error;
+		v[L"k"] = JSON::ValueW(wstring(L"\u6587"));
+		ASSERT_TRUE(!schema.validate(v, &error) && error == "pattern at #/k");
+		v.read(L"{\"n\":5.5}");
+		ASSERT_TRUE(!schema.validate(v, &error) && error == "maximum at #/n");
+		v.read(L"{\"n\":1,\"y\":null}");
+		ASSERT_TRUE(!schema.validate(v, &error) && error == "type at #/y");
+		ASSERT_THROW(schema.check(L"{}", 2), std::logic_error);
+		ASSERT_TRUE(schema.check(L" {\"n\":-1} ", 10) == 9);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, formatter)
+{
+	try {
+		JSON::ValueW v;
+		v.read(L"{\"\\u4e2d\":[\"\u6587\",1],\"a\":{}}");
+		wstring out;
+		JSON::FormatterW(2, ' ', false, 16).write(v, out);
+		ASSERT_TRUE(out == L"{\n  \"a\": {},\n  \"\\u4e2d\": [\"\\u6587\", 1]\n}");
+		out.clear();
+		JSON::FormatterW(1, '\t').format(wstring(L"{\"\\u4e2d\":[\"\u6587\",1],\"a\":{}}"), out);
+		ASSERT_TRUE(out == L"{\n\t\"\\u4e2d\": [\n\t\t\"\u6587\",\n\t\t1\n\t],\n\t\"a\": {}\n}");
+		wstring out1;
+		ASSERT_TRUE(JSON::FormatterW::minify(out, out1) == out.size());
+		ASSERT_TRUE(out1 == L"{\"\\u4e2d\":[\"\u6587\",1],\"a\":{}}");
+		ASSERT_THROW(JSON::FormatterW::minify(wstring(L"[1 2, true false]"), out1), std::logic_error);
+		ASSERT_THROW(JSON::FormatterW::minify(wstring(L"{\"a\":[1}]"), out1), std::logic_error);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+TEST(ut_xpjsonW, fragments)
+{
+	try {
+		JSON::ValueW v;
+		v.read(wstring(L"{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}"));
+		wstring expect;
+		v.write(expect);
+
+		// shared containers keep their text once written
+		v.share(true);
+		const JSON::ValueW& cv = v;
+		const JSON::ValueW& e = cv.o().find(L"e")->second;
+		ASSERT_TRUE(v._o->fragment() == NULL);
+		wstring out;
+		v.write(out);
+		ASSERT_TRUE(out == expect);
+		ASSERT_TRUE(*v._o->fragment() == expect);
+		ASSERT_TRUE(*e._a->fragment() == L"[{\"f\":true}]");
+		const wstring* fragment = e._a->fragment();
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == expect);
+
+		// modified path is copied without text, the rest is spliced in
+		JSON::ValueW v1(v);
+		v1[L"a"][L"b"][0] = 100;
+		ASSERT_TRUE(v1._o->fragment() == NULL);
+		ASSERT_TRUE(v1[L"a"]._o->fragment() == NULL);
+		ASSERT_TRUE(v1.o().find(L"e")->second._a == e._a);
+		out.clear();
+		v1.write(out);
+		ASSERT_TRUE(out == L"{\"a\":{\"b\":[100,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}]}");
+		ASSERT_TRUE(e._a->fragment() == fragment);
+		ASSERT_TRUE(v1._o->fragment() == NULL);
+
+		// the last owner drops its text on modification
+		JSON::ObjectW* o = v._o;
+		v1.clear();
+		v[L"g"] = 1;
+		ASSERT_TRUE(v._o == o && v._o->fragment() == NULL);
+		out.clear();
+		v.write(out);
+		ASSERT_TRUE(out == L"{\"a\":{\"b\":[1,2,3],\"c\":\"d\"},\"e\":[{\"f\":true}],\"g\":1}");
+		ASSERT_TRUE(v._o->fragment() == NULL);
+
+		// not kept without fragments
+		JSON::ValueW v2(v);
+		v2.share();
+		out.clear();
+		v2.write(out);
+		ASSERT_TRUE(v2._o->fragment() == NULL);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
+
+namespace ut_gatherW {
+	struct iovec {void* iov_base; size_t iov_len;};
+}
+
+TEST(ut_xpjsonW, gather_writer)
+{
+	try {
+		const wstring body(100, L'x');
+		const wstring in = L"{\"a\":[1,true,null,\"ab\"],\"b\":\"" + body + L"\",\"c\":\"" + body + L"\\n\",\"d\":{\"e\":2.5}}";
+		JSON::ValueW v;
+		v.read(in);
+		wstring expect;
+		v.write(expect);
+
+		// long strings are referenced, the rest is copied into scratch
+		JSON::GatherWriterW writer(16);
+		writer.write(v);
+		ASSERT_TRUE(writer.count() == 3 && writer.length() == expect.length());
+		vector<JSON::GatherWriterW::segment> segments;
+		writer.segments(segments);
+		ASSERT_TRUE(segments.size() == 3);
+		ASSERT_TRUE(segments[1].first == v[L"b"].c_str() && segments[1].second == body.length());
+		wstring out;
+		for(size_t i = 0; i < segments.size(); ++i) out.append(segments[i].first, segments[i].second);
+		ASSERT_TRUE(out == expect);
+
+		// iovec alike for writev
+		vector<ut_gatherW::iovec> iov;
+		writer.iovecs(iov);
+		ASSERT_TRUE(iov.size() == 3 && iov[1].iov_base == segments[1].first && iov[2].iov_len == segments[2].second * sizeof(wchar_t));
+
+		// cached text of shared containers is written once and referenced
+		const wstring in1 = L"[{\"f\":\"" + body + L"\"},[1,2]]";
+		JSON::ValueW t;
+		t.read(in1);
+		t.share(true);
+		writer.clear();
+		writer.write(t);
+		ASSERT_TRUE(writer.count() == 1 && t._a->fragment() != NULL);
+		segments.clear();
+		writer.segments(segments);
+		ASSERT_TRUE(segments[0].first == t._a->fragment()->data());
+		JSON::ValueW t1(t);
+		t1[1][0] = 3;
+		writer.clear();
+		writer.write(t1);
+		segments.clear();
+		writer.segments(segments);
+		ASSERT_TRUE(segments.size() == 3 && segments[1].first == t._a->at(0)._o->fragment()->data());
+		out.clear();
+		for(size_t i = 0; i < segments.size(); ++i) out.append(segments[i].first, segments[i].second);
+		ASSERT_TRUE(out == L"[{\"f\":\"" + body + L"\"},[3,2]]");
+
+		// all copied below min length
+		writer = JSON::GatherWriterW();
+		writer.write(JSON::ValueW(L"ab"));
+		ASSERT_TRUE(writer.count() == 1 && writer.length() == 4);
+	}
+	catch(std::exception &e) {
+		printf("Error : %s.", e.what());
+		ASSERT_TRUE(false);
+	}
+}
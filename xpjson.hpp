@@ -15,8 +15,12 @@
 #include <cstdlib>
 #include <string>
 #include <cstring>
+#include <cstddef>
 #include <deque>
 #include <map>
+#include <vector>
+#include <memory>
+#include <new>
 #include <cmath>
 #include <cfloat>
 #include <stdexcept>
@@ -28,6 +32,56 @@ using namespace std;
 #	define __XPJSON_SUPPORT_DANGLING_COMMA__ 0
 #endif
 
+// bytes occupied by Value / ValueW, multiple of 8 and at least 16.
+// the bytes after the 2 header bytes are used as inline storage for small strings, e.g.:
+//   16 -> 14 chars, 32 -> 30 chars, 48 -> 46 chars
+#ifndef __XPJSON_VALUE_SIZE__
+#	define __XPJSON_VALUE_SIZE__ 16
+#endif
+// 7 wide chars inline by default, i.e. 16 bytes for UTF16 and 32 bytes for UTF32 wchar_t
+#ifndef __XPJSON_VALUE_SIZE_W__
+#	define __XPJSON_VALUE_SIZE_W__ (8 * sizeof(wchar_t))
+#endif
+
+// use sse2 to find quotes and brackets while skipping unparsed values, see JSON::skip
+#ifndef __XPJSON_SUPPORT_SSE2__
+#	if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define __XPJSON_SUPPORT_SSE2__ 1
+#	else
+#		define __XPJSON_SUPPORT_SSE2__ 0
+#	endif
+#endif
+#if __XPJSON_SUPPORT_SSE2__
+#	include <emmintrin.h>
+#endif
+
+// map files by mmap in ReaderT::read_file, otherwise they are read by stdio
+#ifndef __XPJSON_SUPPORT_MMAP__
+#	if defined(__unix__) || defined(__APPLE__)
+#		define __XPJSON_SUPPORT_MMAP__ 1
+#	else
+#		define __XPJSON_SUPPORT_MMAP__ 0
+#	endif
+#endif
+#if __XPJSON_SUPPORT_MMAP__
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+// match "pattern" of SchemaT by std::regex, otherwise schemas with patterns are rejected
+#ifndef __XPJSON_SUPPORT_REGEX__
+#	if __cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+#		define __XPJSON_SUPPORT_REGEX__ 1
+#	else
+#		define __XPJSON_SUPPORT_REGEX__ 0
+#	endif
+#endif
+#if __XPJSON_SUPPORT_REGEX__
+#	include <regex>
+#endif
+
 #if defined(__clang__)
 #	ifndef __has_extension
 #		define __has_extension __has_feature
@@ -60,12 +114,16 @@ using namespace std;
 
 #	define PRId64       "I64d"
 #	define LPRId64 		L"I64d"
+#	define PRIu64       "I64u"
+#	define LPRIu64 		L"I64u"
 #else
 #	include <inttypes.h>
 #	define LPRId64 		L"lld"
+#	define LPRIu64 		L"llu"
 #endif
 
 #ifdef _MSC_VER
+#	include <intrin.h>
 // disable performance degradation warnings on casting from arithmetic type to bool
 #	pragma warning(disable:4800)
 // disable deprecated interface warnings
@@ -96,6 +154,8 @@ using namespace std;
 
 #define JSON_EPSILON				FLT_EPSILON
 
+#define JSON_STATIC_ASSERT(expression, name)	typedef char name[(expression) ? 1 : -1]
+
 typedef enum ESCAPE_TYPE {
 	AUTO_DETECT = -1,
 	DONT_ESCAPE = 0,
@@ -149,6 +209,10 @@ namespace JSON
 		template<class T> struct json_is_integral       {typedef typename json_remove_cv<T>::type type; enum {value = json_is_integral_<type>::value};};
 		template<class T> struct json_is_floating_point {typedef typename json_remove_cv<T>::type type; enum {value = json_is_floating_point_<type>::value};};
 		template<class T> struct json_is_arithmetic     {typedef typename json_remove_cv<T>::type type; enum {value = json_is_integral_<type>::value || json_is_same<type, bool>::value || json_is_floating_point_<type>::value};};
+
+		template<class T, class char_t> struct json_is_string_ :                                             json_false_type {};
+		template<class char_t, class traits_t, class alloc_t> struct json_is_string_<basic_string<char_t, traits_t, alloc_t>, char_t> : json_true_type {};
+		template<class T, class char_t> struct json_is_string {enum {value = json_is_string_<typename json_remove_cv<T>::type, char_t>::value};};
 		// end of type traits
 
 		template<class char_t> JSON_TSTRING(char) get_cstr(const char_t* str, size_t len);
@@ -167,8 +231,8 @@ namespace JSON
 		template<> size_t tcslen<char>(const char* str) {return strlen(str);}
 		template<> size_t tcslen<wchar_t>(const wchar_t* str) {return wcslen(str);}
 
-		template<class T, class char_t>
-		inline void internal_to_string(const T& v, JSON_TSTRING(char_t)& out, int(*fmter)(char_t*,size_t,const char_t*,...), const char_t* fmt)
+		template<class T, class char_t, class string_t>
+		inline void internal_to_string(const T& v, string_t& out, int(*fmter)(char_t*,size_t,const char_t*,...), const char_t* fmt)
 		{
 			// double 24 bytes, int64_t 20 bytes
 			static const size_t bufSize = 25;
@@ -180,61 +244,76 @@ namespace JSON
 		}
 
 #define JSON_TO_STRING(type, char_t, fmter, fmt) \
-template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_t)& out) {internal_to_string<type, char_t>(v, out, fmter, fmt);}
-
-		template<class T, class char_t>
-		void to_string(const T& v, JSON_TSTRING(char_t)& out);
+template<class traits_t, class alloc_t> inline void to_string(const type& v, basic_string<char_t, traits_t, alloc_t>& out) {internal_to_string<type, char_t>(v, out, fmter, fmt);}
 
 		JSON_TO_STRING(int64_t, char,    snprintf, "%" PRId64)
 		JSON_TO_STRING(int64_t, wchar_t, swprintf, L"%" LPRId64)
+		JSON_TO_STRING(uint64_t, char,    snprintf, "%" PRIu64)
+		JSON_TO_STRING(uint64_t, wchar_t, swprintf, L"%" LPRIu64)
 		JSON_TO_STRING(double,  char,    snprintf, "%.16g")
 		JSON_TO_STRING(double,  wchar_t, swprintf, L"%.16g")
 #undef JSON_TO_STRING
 
-		template<class T, class char_t>
-		inline JSON_TSTRING(char_t) to_string(const T& v)
+		template<class string_t, class T>
+		inline string_t to_string(const T& v)
 		{
-			JSON_TSTRING(char_t) out;
+			string_t out;
 			to_string(v, out);
-			return JSON_MOVE(JSON_TSTRING(char_t)(out));
+			return out;
 		}
 
 		char int_to_hex(int n) {return n["0123456789abcdef"];}
 
-		template<class char_t>
-		void to_hex(int ch, JSON_TSTRING(char_t)& out)
+		template<class string_t>
+		void to_hex(int ch, string_t& out)
 		{
 			out += int_to_hex((ch >> 4) & 0xF);
 			out += int_to_hex(ch & 0xF);
 		}
 
-		template<int size, class char_t> void encode_unicode(char_t ch, JSON_TSTRING(char_t)& out);
-		template<> void encode_unicode<1, char>(char ch, JSON_TSTRING(char)& out)
+		template<int size> struct json_unicode;
+		template<> struct json_unicode<1>
 		{
-			out += '\\'; out += 'u'; out += '0'; out += '0';
-			to_hex(ch, out);
-		}
+			template<class string_t>
+			static void encode(char ch, string_t& out)
+			{
+				out += '\\'; out += 'u'; out += '0'; out += '0';
+				to_hex(ch, out);
+			}
+		};
 
 		// For UTF16 Encoding
-		template<> void encode_unicode<2, wchar_t>(wchar_t ch, JSON_TSTRING(wchar_t)& out)
+		template<> struct json_unicode<2>
 		{
-			out += '\\'; out += 'u';
-			to_hex((ch >> 8) & 0xFF, out);
-			to_hex(ch & 0xFF, out);
-		}
+			template<class string_t>
+			static void encode(wchar_t ch, string_t& out)
+			{
+				out += '\\'; out += 'u';
+				to_hex((ch >> 8) & 0xFF, out);
+				to_hex(ch & 0xFF, out);
+			}
+		};
 
 		// For UTF32 Encoding
-		template<> void encode_unicode<4, wchar_t>(wchar_t ch, JSON_TSTRING(wchar_t)& out)
+		template<> struct json_unicode<4>
 		{
-			if(ch > 0xFFFF) {
-				ch = static_cast<int>(ch) - 0x10000;
-				encode_unicode<2, wchar_t>(static_cast<unsigned short>(0xD800 |(ch >> 10)), out);
-				encode_unicode<2, wchar_t>(static_cast<unsigned short>(0xDC00 |(ch & 0x03FF)), out);
+			template<class string_t>
+			static void encode(wchar_t ch, string_t& out)
+			{
+				if(ch > 0xFFFF) {
+					ch = static_cast<int>(ch) - 0x10000;
+					json_unicode<2>::encode(static_cast<unsigned short>(0xD800 |(ch >> 10)), out);
+					json_unicode<2>::encode(static_cast<unsigned short>(0xDC00 |(ch & 0x03FF)), out);
+				}
+				else json_unicode<2>::encode(static_cast<unsigned short>(ch), out);
 			}
-			else encode_unicode<2, wchar_t>(static_cast<unsigned short>(ch), out);
-		}
+		};
+
+		template<int size, class char_t, class string_t>
+		inline void encode_unicode(char_t ch, string_t& out) {json_unicode<size>::encode(ch, out);}
 
-		void encode(const char* in, size_t len, JSON_TSTRING(char)& out)
+		template<class traits_t, class alloc_t>
+		void encode(const char* in, size_t len, basic_string<char, traits_t, alloc_t>& out)
 		{
 			while(len--) {
 				switch(*in) {
@@ -255,7 +334,8 @@ template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_
 			}
 		}
 
-		void encode(const wchar_t* in, size_t len, JSON_TSTRING(wchar_t)& out)
+		template<class traits_t, class alloc_t>
+		void encode(const wchar_t* in, size_t len, basic_string<wchar_t, traits_t, alloc_t>& out)
 		{
 			while(len--) {
 				if(*in > 0x7F) encode_unicode<sizeof(wchar_t), wchar_t>(*in, out);
@@ -296,9 +376,10 @@ template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_
 			return (highByte << 8) | lowByte;
 		}
 
-		template<class char_t> void decode_unicode_append(unsigned int ui, JSON_TSTRING(char_t)& out);
-		template<> void decode_unicode_append<wchar_t>(unsigned int ui, JSON_TSTRING(wchar_t)& out) {out += ui;}
-		template<> void decode_unicode_append<char>(unsigned int ui, JSON_TSTRING(char)& out)
+		template<class traits_t, class alloc_t>
+		void decode_unicode_append(unsigned int ui, basic_string<wchar_t, traits_t, alloc_t>& out) {out += ui;}
+		template<class traits_t, class alloc_t>
+		void decode_unicode_append(unsigned int ui, basic_string<char, traits_t, alloc_t>& out)
 		{
 			const size_t len = out.length();
 			if(ui <= 0x0000007F) {
@@ -342,23 +423,23 @@ template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_
 			}
 		}
 
-		template<class char_t>
-		size_t decode_unicode(const char_t* in, size_t len, JSON_TSTRING(char_t)& out)
+		template<class char_t, class string_t>
+		size_t decode_unicode(const char_t* in, size_t len, string_t& out)
 		{
 			unsigned int ui = hex_to_ushort(in, len);
 			if(ui >= 0xD800 && ui < 0xDC00) {
 				JSON_DECODE_CHECK(len >= 6 && in[4] == '\\' && in[5] == 'u');
 				ui = (ui & 0x3FF) << 10;
 				ui += (hex_to_ushort(in + 6, len - 6) & 0x3FF) + 0x10000;
-				decode_unicode_append<char_t>(ui, out);
+				decode_unicode_append(ui, out);
 				return 10;
 			}
-			decode_unicode_append<char_t>(ui, out);
+			decode_unicode_append(ui, out);
 			return 4;
 		}
 
-		template<class char_t>
-		void decode(const char_t* in, size_t len, JSON_TSTRING(char_t)& out)
+		template<class char_t, class string_t>
+		void decode(const char_t* in, size_t len, string_t& out)
 		{
 			for(size_t pos = 0; pos < len; ++pos) {
 				switch(in[pos]) {
@@ -374,7 +455,7 @@ template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_
 							case 'n':  out += '\n'; break;
 							case 'r':  out += '\r'; break;
 							case 't':  out += '\t'; break;
-							case 'u':  pos += decode_unicode<char_t>(in + pos + 1, len - pos - 1, out); break;
+							case 'u':  pos += decode_unicode(in + pos + 1, len - pos - 1, out); break;
 							default: JSON_PARSE_CHECK(false);
 						}
 						break;
@@ -409,1203 +490,6452 @@ template<> inline void to_string<type, char_t>(const type& v, JSON_TSTRING(char_
 		template<class char_t> bool check_need_conv(char_t ch);
 		template<> inline bool check_need_conv<char>(char ch) {return ch == '\\' || ch < 0x20;}
 		template<> inline bool check_need_conv<wchar_t>(wchar_t ch) {return ch == '\\' || ch < 0x20 || ch > 0x7F;}
-	}
-
-	/** JSON type of a value. */
-	enum Type
-	{
-		NIL,        // Null
-		BOOLEAN,    // Boolean(true, false)
-		INTEGER,    // Integer
-		FLOAT,      // Float 3.14 12e-10
-		STRING,     // String " ... "
-		OBJECT,     // Object {...}
-		ARRAY       // Array  [ ... ]
-	};
-
-	inline const char* get_type_name(int type);
 
-	// Forward declaration
-	template<class char_t>
-	class ValueT;
-
-	/** A JSON object, i.e., a container whose keys are strings, this
-	is roughly equivalent to a Python dictionary, a PHP's associative
-	array, a Perl or a C++ map(depending on the implementation). */
-	template<class char_t>
-	class ObjectT : public std::map<JSON_TSTRING(char_t), ValueT<char_t> > {};
+		template<class char_t> struct json_value_size;
+		template<> struct json_value_size<char>    {enum {value = __XPJSON_VALUE_SIZE__};};
+		template<> struct json_value_size<wchar_t> {enum {value = __XPJSON_VALUE_SIZE_W__};};
 
-	typedef ObjectT<char>    Object;
-	typedef ObjectT<wchar_t> ObjectW;
+		// sso string is stored right after the 2 header bytes(aligned to char_t), overlaps _dma_len and the union
+		template<class char_t> struct json_sso
+		{
+			enum {
+				size     = json_value_size<char_t>::value,
+				offset   = sizeof(char_t) > 2 ? sizeof(char_t) : 2,
+				// _sso_len is 1 byte
+				capacity = (size - offset) / sizeof(char_t) > 0xFF ? 0xFF : (size - offset) / sizeof(char_t)
+			};
+		};
+		JSON_STATIC_ASSERT(json_sso<char>::size >= 16 && json_sso<char>::size % 8 == 0, json_value_size_invalid);
+		JSON_STATIC_ASSERT(json_sso<wchar_t>::size >= 16 && json_sso<wchar_t>::size % 8 == 0, json_valuew_size_invalid);
 
-	/** A JSON array, i.e., an indexed container of elements. It contains
-	JSON values, that can have any of the types in ValueType. */
-	template<class char_t>
-	class ArrayT : public std::deque<ValueT<char_t> > {};
+		// atomic operations, inc/dec return the new value
+		inline long json_atomic_load(const volatile long* p)
+		{
+#if defined(__ATOMIC_ACQUIRE)
+			return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+			return *p; // aligned volatile read
+#endif
+		}
+		inline long json_atomic_inc(volatile long* p)
+		{
+#ifdef _MSC_VER
+			return _InterlockedIncrement(p);
+#else
+			return __sync_add_and_fetch(p, 1);
+#endif
+		}
+		inline long json_atomic_dec(volatile long* p)
+		{
+#ifdef _MSC_VER
+			return _InterlockedDecrement(p);
+#else
+			return __sync_sub_and_fetch(p, 1);
+#endif
+		}
+		inline void* json_atomic_load(void* const volatile* p)
+		{
+#if defined(__ATOMIC_ACQUIRE)
+			return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+			return *p;
+#endif
+		}
+		// store p if *dst is null, false if another one was stored first
+		inline bool json_atomic_publish(void* volatile* dst, void* p)
+		{
+#ifdef _MSC_VER
+			return !_InterlockedCompareExchangePointer(dst, p, 0);
+#else
+			return __sync_bool_compare_and_swap(dst, static_cast<void*>(0), p);
+#endif
+		}
 
-	typedef ArrayT<char>    Array;
-	typedef ArrayT<wchar_t> ArrayW;
+		// reference count of shared container, 0 means not shared.
+		// copies of container are never shared.
+		// shared container is immutable, its hash is memoized, 0 means not yet.
+		struct json_shared
+		{
+			json_shared() : _refs(0), _hash(0) {}
+			json_shared(const json_shared&) : _refs(0), _hash(0) {}
+			json_shared& operator=(const json_shared&) {return *this;}
 
-	/** A JSON value. Can have either type in ValueTypes. */
-	template<class char_t>
-	class ValueT
-	{
-	public:
-		typedef JSON_TSTRING(char_t) tstring;
+			// memoized hash, only where 64-bit stores aren't torn
+			inline bool cached() const {return sizeof(void*) >= 8 && _hash && json_atomic_load(&_refs);}
+			inline uint64_t cache(uint64_t hash) const
+			{
+				hash |= !hash;
+				if(sizeof(void*) >= 8 && json_atomic_load(&_refs)) _hash = hash;
+				return hash;
+			}
 
-		/** Default constructor(type = NIL). */
-		ValueT() : _type(NIL) {}
-		/** Constructor with type. */
-		ValueT(Type type);
-		/** Copy constructor. */
-		ValueT(const ValueT<char_t>& v);
+			mutable volatile long _refs;
+			mutable volatile uint64_t _hash;
+		};
 
-		/** Constructor from bool. */
-		ValueT(bool b) : _type(BOOLEAN), _b(b) {}
-		/** Constructor from integer. */
-#define JSON_INTEGER_CTOR(type)		ValueT(type i) : _type(INTEGER), _i(i) {}
-		JSON_INTEGER_CTOR(unsigned char)
-		JSON_INTEGER_CTOR(signed char)
-#ifdef _NATIVE_WCHAR_T_DEFINED
-		JSON_INTEGER_CTOR(wchar_t)
-#endif /* _NATIVE_WCHAR_T_DEFINED */
-		JSON_INTEGER_CTOR(unsigned short)
-		JSON_INTEGER_CTOR(signed short)
-		JSON_INTEGER_CTOR(unsigned int)
-		JSON_INTEGER_CTOR(signed int)
-#if (defined (__GNUC__) && !defined(__x86_64__)) || (defined(_WIN32) && !defined(_WIN64))
-		JSON_INTEGER_CTOR(unsigned long)
-		JSON_INTEGER_CTOR(signed long)
+		// 64x64 bits multiply folded by xor, the mixing of wyhash
+		inline uint64_t json_mum(uint64_t a, uint64_t b)
+		{
+#ifdef __SIZEOF_INT128__
+			__extension__ typedef unsigned __int128 json_u128; // not pedantic
+			const json_u128 r = static_cast<json_u128>(a) * b;
+			return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+			const uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xFFFFFFFF, lb = b & 0xFFFFFFFF;
+			const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			const uint64_t t = rl + (rm0 << 32), lo = t + (rm1 << 32);
+			const uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+			return lo ^ hi;
 #endif
-		JSON_INTEGER_CTOR(uint64_t)
-		JSON_INTEGER_CTOR(int64_t)
-#undef JSON_INTEGER_CTOR
-		/** Constructor from float. */
-#define JSON_FLOAT_CTOR(type)		ValueT(type f) : _type(FLOAT), _f(f) {}
-		JSON_FLOAT_CTOR(float)
-		JSON_FLOAT_CTOR(double)
-		JSON_FLOAT_CTOR(long double)
-#undef JSON_FLOAT_CTOR
+		}
+		inline uint64_t json_hash_mix(uint64_t a, uint64_t b) {return json_mum(a ^ 0xa0761d6478bd642fULL, b ^ 0xe7037ed1a0b428dbULL);}
 
-		/** Constructor from pointer to char(C-string).  */
-		ValueT(const char_t* s, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s, detail::tcslen(s), escape, dma);}
-		/** Constructor from pointer to char(C-string).  */
-		ValueT(const char_t* s, size_t l, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s, l, escape, dma);}
-		/** Constructor from STD string  */
-		ValueT(const tstring& s, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s.data(), s.size(), escape, dma);}
-		/** Constructor from pointer to Object. */
-		ValueT(const ObjectT<char_t>& o) : _type(OBJECT), _o(0) {_o = new ObjectT<char_t>(o);}
-		/** Constructor from pointer to Array. */
-		ValueT(const ArrayT<char_t>& a) : _type(ARRAY), _a(0) {_a = new ArrayT<char_t>(a);}
-#ifdef __XPJSON_SUPPORT_MOVE__
-		/** Move constructor. */
-		ValueT(ValueT<char_t>&& v) : _type(NIL) {assign(JSON_MOVE(v));}
-		/** Move constructor from STD string  */
-		ValueT(tstring&& s, int escape = AUTO_DETECT) : _type(NIL) {assign(JSON_MOVE(s), escape);}
-		/** Move constructor from pointer to Object. */
-		ValueT(ObjectT<char_t>&& o) : _type(OBJECT), _o(0) {_o = new ObjectT<char_t>(JSON_MOVE(o));}
-		/** Move constructor from pointer to Array. */
-		ValueT(ArrayT<char_t>&& a) : _type(ARRAY), _a(0) {_a = new ArrayT<char_t>(JSON_MOVE(a));}
-#endif
+		// streaming wyhash style hash of bytes, also a sink so that text is hashed as UTF-8 for any char_t
+		class json_hasher
+		{
+		public:
+			explicit json_hasher(uint64_t seed) : _seed(seed ^ 0x8ebc6af09c88c6e3ULL), _len(0), _n(0) {}
 
-		~ValueT() {clear();}
+			inline void append(const char* p, size_t n)
+			{
+				_len += n;
+				if(_n) {
+					const size_t m = n < 16 - _n ? n : 16 - _n;
+					memcpy(_buf + _n, p, m);
+					_n += m;
+					p += m;
+					n -= m;
+					if(_n < 16) return;
+					block(_buf);
+					_n = 0;
+				}
+				for(; n >= 16; p += 16, n -= 16) block(p);
+				memcpy(_buf, p, n);
+				_n = n;
+			}
+			inline uint64_t final()
+			{
+				memset(_buf + _n, 0, 16 - _n);
+				return json_hash_mix(_len, json_mum(word(_buf) ^ 0xe7037ed1a0b428dbULL, word(_buf + 8) ^ _seed));
+			}
 
-		/** Assign function. */
-		void assign(const ValueT<char_t>& v);
-		/** Assign function from bool. */
-		inline void assign(bool b) {clear(BOOLEAN); _b = b;}
-		/** Assign function from integer. */
-		template<class T>
-		inline typename detail::json_enable_if<detail::json_is_integral<T>::value>::type
-		assign(T i) {clear(INTEGER); _i = i;}
-		/** Assign function from float. */
-		template<class T>
-		inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value>::type
-		assign(T f) {clear(FLOAT); _f = f;}
-		/** Assign function from pointer to char(C-string).  */
-		inline void assign(const char_t* s, int escape = AUTO_DETECT, bool dma = true) {assign(s, detail::tcslen(s), escape, dma);}
-		/** Assign function from pointer to char(C-string).  */
-		inline void assign(const char_t* s, size_t l, int escape = AUTO_DETECT, bool dma = true);
-		/** Assign function from STD string  */
-		inline void assign(const tstring& s, int escape = AUTO_DETECT, bool dma = true) {assign(s.data(), s.size(), escape, dma);}
-		/** Assign function from pointer to Object. */
-		inline void assign(const ObjectT<char_t>& o) {clear(OBJECT); *_o = o;}
-		/** Assign function from pointer to Array. */
-		inline void assign(const ArrayT<char_t>& a) {clear(ARRAY); *_a = a;}
-#ifdef __XPJSON_SUPPORT_MOVE__
-		/** Assign function. */
-		void assign(ValueT<char_t>&& v);
- 		// Fix: use swap rather than operator= to avoid bug under VS2010
-		/** Assign function from STD string  */
-		inline void assign(tstring&& s, int escape = AUTO_DETECT);
-		/** Assign function from pointer to Object. */
-		inline void assign(ObjectT<char_t>&& o) {clear(OBJECT); _o->clear(); _o->swap(o);}
-		/** Assign function from pointer to Array. */
-		inline void assign(ArrayT<char_t>&& a) {clear(ARRAY); _a->clear(); _a->swap(a);}
-#endif
+		private:
+			static inline uint64_t word(const char* p) {uint64_t w; memcpy(&w, p, sizeof(w)); return w;}
+			inline void block(const char* p) {_seed = json_mum(word(p) ^ 0xe7037ed1a0b428dbULL, word(p + 8) ^ _seed);}
 
-		/** Assignment operator. */
-		inline ValueT<char_t>& operator=(const ValueT<char_t>& v) {if(this != &v) {assign(v);} return *this;}
-#define JSON_ASSIGNMENT(arg)		{assign(arg);return *this;}
-		/** Assignment operator from int/float/bool. */
-		template<class T>
-		inline typename detail::json_enable_if<detail::json_is_arithmetic<T>::value, ValueT<char_t>&>::type
-		operator=(T a) JSON_ASSIGNMENT(a)
-		/** Assignment operator from pointer to char(C-string).  */
-		inline ValueT<char_t>& operator=(const char_t* s) JSON_ASSIGNMENT(s)
-		/** Assignment operator from STD string  */
-		inline ValueT<char_t>& operator=(const tstring& s) JSON_ASSIGNMENT(s)
-		/** Assignment operator from pointer to Object. */
-		inline ValueT<char_t>& operator=(const ObjectT<char_t>& o) JSON_ASSIGNMENT(o)
-		/** Assignment operator from pointer to Array. */
-		inline ValueT<char_t>& operator=(const ArrayT<char_t>& a) JSON_ASSIGNMENT(a)
-#ifdef __XPJSON_SUPPORT_MOVE__
-		/** Assignment operator. */
-		inline ValueT<char_t>& operator=(ValueT<char_t>&& v) {if(this != &v) {assign(JSON_MOVE(v));} return *this;}
-		/** Assignment operator from STD string  */
-		inline ValueT<char_t>& operator=(tstring&& s) JSON_ASSIGNMENT(JSON_MOVE(s))
-		/** Assignment operator from pointer to Object. */
-		inline ValueT<char_t>& operator=(ObjectT<char_t>&& o) JSON_ASSIGNMENT(JSON_MOVE(o))
-		/** Assignment operator from pointer to Array. */
-		inline ValueT<char_t>& operator=(ArrayT<char_t>&& a) JSON_ASSIGNMENT(JSON_MOVE(a))
+			uint64_t _seed;
+			uint64_t _len;
+			char _buf[16];
+			size_t _n;
+		};
+
+		// allocator of T rebound from alloc_t, allocators are expected to be stateless.
+		template<class alloc_t, class T> struct json_rebind
+		{
+#if __cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+			typedef typename std::allocator_traits<alloc_t>::template rebind_alloc<T> type;
+#else
+			typedef typename alloc_t::template rebind<T>::other type;
 #endif
-#undef JSON_ASSIGNMENT
+		};
 
-		/** Type query. */
-		inline Type type() const {return _type;}
+		template<class char_t, class alloc_t> struct json_string
+		{
+			typedef basic_string<char_t, char_traits<char_t>, typename json_rebind<alloc_t, char_t>::type> type;
+		};
 
-		/** Cast operator for bool */
-		inline operator bool() const
+		template<class T, class alloc_t> inline T* json_allocate()
 		{
-			JSON_CHECK_TYPE(_type, BOOLEAN);
-			return _b;
+			typename json_rebind<alloc_t, T>::type a;
+			return a.allocate(1);
 		}
-		/** Cast operator for integer */
-#define JSON_INTEGER_OPERATOR(type)		\
-	inline operator type() const {JSON_CHECK_TYPE(_type, INTEGER);return _i;}
-		JSON_INTEGER_OPERATOR(unsigned char)
-		JSON_INTEGER_OPERATOR(signed char)
-#ifdef _NATIVE_WCHAR_T_DEFINED
-		JSON_INTEGER_OPERATOR(wchar_t)
-#endif /* _NATIVE_WCHAR_T_DEFINED */
-		JSON_INTEGER_OPERATOR(unsigned short)
-		JSON_INTEGER_OPERATOR(signed short)
-		JSON_INTEGER_OPERATOR(unsigned int)
-		JSON_INTEGER_OPERATOR(signed int)
-#if (defined (__GNUC__) && !defined(__x86_64__)) || (defined(_WIN32) && !defined(_WIN64))
-		JSON_INTEGER_OPERATOR(unsigned long)
-		JSON_INTEGER_OPERATOR(signed long)
-#endif
-		JSON_INTEGER_OPERATOR(uint64_t)
-		JSON_INTEGER_OPERATOR(int64_t)
-#undef JSON_INTEGER_OPERATOR
-		/** Cast operator for float */
-#define JSON_FLOAT_OPERATOR(type)		\
-	inline operator type() const {JSON_CHECK_TYPE(_type, FLOAT);return _f;}
-		JSON_FLOAT_OPERATOR(float)
-		JSON_FLOAT_OPERATOR(double)
-		JSON_FLOAT_OPERATOR(long double)
-#undef JSON_FLOAT_OPERATOR
-		/** Cast operator for STD string */
-		inline operator tstring() const
+
+		template<class T, class alloc_t> inline void json_deallocate(T* p)
 		{
-			JSON_CHECK_TYPE(_type, STRING);
-			return *_s;
+			typename json_rebind<alloc_t, T>::type a;
+			a.deallocate(p, 1);
 		}
-		/** Cast operator for Object */
-		inline operator ObjectT<char_t>() const
+
+		// serialized text of shared container kept by write if enabled by share(true),
+		// published atomically since shared containers may be written by many threads.
+		// copies of container and detached ones have no text.
+		template<class string_t, class alloc_t> struct json_fragment
 		{
-			JSON_CHECK_TYPE(_type, OBJECT);
-			return *_o;
+			json_fragment() : _fragments(false), _fragment(0) {}
+			json_fragment(const json_fragment&) : _fragments(false), _fragment(0) {}
+			json_fragment& operator=(const json_fragment&) {drop(); return *this;}
+			~json_fragment() {drop();}
+
+			inline const string_t* fragment() const {return static_cast<const string_t*>(json_atomic_load(&_fragment));}
+			void keep(const typename string_t::value_type* text, size_t n) const
+			{
+				string_t* p = json_allocate<string_t, alloc_t>();
+				try {new(p) string_t(text, n);} catch(...) {json_deallocate<string_t, alloc_t>(p); throw;}
+				if(!json_atomic_publish(&_fragment, p)) {
+					p->~string_t();
+					json_deallocate<string_t, alloc_t>(p);
+				}
+			}
+			inline void drop() const
+			{
+				if(!_fragment) return;
+				string_t* p = static_cast<string_t*>(_fragment);
+				p->~string_t();
+				json_deallocate<string_t, alloc_t>(p);
+				_fragment = 0;
+			}
+
+			mutable bool _fragments;
+			mutable void* volatile _fragment;
+		};
+
+		// bytes of rb-tree node besides the value: color and 3 links, same for libstdc++, libc++ and msvc
+		inline size_t json_map_node_overhead() {return 4 * sizeof(void*);}
+
+		// elements per deque block of implementations
+		template<class T> inline size_t json_deque_block_size()
+		{
+#if defined(_MSC_VER) && !defined(_LIBCPP_VERSION)
+			return sizeof(T) <= 1 ? 16 : sizeof(T) <= 2 ? 8 : sizeof(T) <= 4 ? 4 : sizeof(T) <= 8 ? 2 : 1;
+#elif defined(_LIBCPP_VERSION)
+			return sizeof(T) < 256 ? 4096 / sizeof(T) : 16;
+#else
+			return sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+#endif
 		}
-		/** Cast operator for Array */
-		inline operator ArrayT<char_t>() const
+
+		// heap bytes of deque blocks and block map, estimated as filled by push_back
+		template<class T> inline size_t json_deque_heap(size_t size)
 		{
-			JSON_CHECK_TYPE(_type, ARRAY);
-			return *_a;
+			const size_t blocks = size / json_deque_block_size<T>() + 1;
+			return blocks * json_deque_block_size<T>() * sizeof(T) + std::max<size_t>(8, blocks + 2) * sizeof(T*);
 		}
 
-		/** Fetch boolean reference */
-		inline bool& b()
+		// offset of the first quote or backslash, or len
+		template<class char_t> inline size_t json_find_quote(const char_t* in, size_t len)
 		{
-			if(_type == NIL) {_type = BOOLEAN; _b = false;}
-			JSON_CHECK_TYPE(_type, BOOLEAN);
-			return _b;
-		}
-		/** Fetch boolean value */
-		inline bool b() const
-		{
-			JSON_CHECK_TYPE(_type, BOOLEAN);
-			return _b;
-		}
-		/** Fetch integer reference*/
-		inline int64_t& i()
-		{
-			if(_type == NIL) {_type = INTEGER; _i = 0;}
-			JSON_CHECK_TYPE(_type, INTEGER);
-			return _i;
-		}
-		/** Fetch integer value*/
-		inline int64_t i() const
-		{
-			JSON_CHECK_TYPE(_type, INTEGER);
-			return _i;
+			size_t pos = 0;
+			while(pos < len && in[pos] != '\"' && in[pos] != '\\') ++pos;
+			return pos;
 		}
-		/** Fetch float reference */
-		inline double& f()
+
+		// offset of the first quote or bracket, or len
+		template<class char_t> inline size_t json_find_structural(const char_t* in, size_t len)
 		{
-			if(_type == NIL) {_type = FLOAT; _f = 0;}
-			JSON_CHECK_TYPE(_type, FLOAT);
-			return _f;
+			size_t pos = 0;
+			while(pos < len && in[pos] != '\"' && in[pos] != '{' && in[pos] != '}' && in[pos] != '[' && in[pos] != ']') ++pos;
+			return pos;
 		}
-		/** Fetch float value */
-		inline long double f() const
+
+#if __XPJSON_SUPPORT_SSE2__
+		inline int json_ctz(unsigned int mask)
 		{
-			JSON_CHECK_TYPE(_type, FLOAT);
-			return _f;
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<int>(index);
+#else
+			return __builtin_ctz(mask);
+#endif
 		}
-		/** Fetch string reference */
-		inline tstring& s()
+
+		template<> inline size_t json_find_quote<char>(const char* in, size_t len)
 		{
-			if(_type == NIL) {_type = STRING; _sso = _dma = false; _s = new tstring;}
-			JSON_CHECK_TYPE(_type, STRING);
-			if(_sso || _dma){
-				_s = new tstring(c_str(), length());
-				_sso = _dma = false;
+			const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+			size_t pos = 0;
+			for(; pos + 16 <= len; pos += 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos));
+				const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+				if(mask) return pos + json_ctz(mask);
 			}
-			_e = true; // the string may be modified by caller
-			return *_s;
+			while(pos < len && in[pos] != '\"' && in[pos] != '\\') ++pos;
+			return pos;
 		}
-		/** Fetch string const-reference */
-		inline const tstring& s() const
+
+		template<> inline size_t json_find_structural<char>(const char* in, size_t len)
 		{
-			JSON_CHECK_TYPE(_type, STRING);
-			if(_sso || _dma){
-				_s = new tstring(c_str(), length());
-				_sso = _dma = false;
+			// '{' | 0x20 == '{', '[' | 0x20 == '{', '}' | 0x20 == '}', ']' | 0x20 == '}'
+			const __m128i quote = _mm_set1_epi8('\"'), lower = _mm_set1_epi8(0x20), lbrace = _mm_set1_epi8('{'), rbrace = _mm_set1_epi8('}');
+			size_t pos = 0;
+			for(; pos + 16 <= len; pos += 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos));
+				const __m128i folded = _mm_or_si128(chunk, lower);
+				const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+					_mm_or_si128(_mm_cmpeq_epi8(folded, lbrace), _mm_cmpeq_epi8(folded, rbrace))));
+				if(mask) return pos + json_ctz(mask);
 			}
-			return *_s;
+			while(pos < len && in[pos] != '\"' && in[pos] != '{' && in[pos] != '}' && in[pos] != '[' && in[pos] != ']') ++pos;
+			return pos;
 		}
-		/** Fetch object reference */
-		inline ObjectT<char_t>& o()
+#endif
+
+		// end offset of the value starts at in, brackets and quotes are matched but nothing else is validated
+		template<class char_t> size_t json_skip(const char_t* in, size_t len)
 		{
-			if(_type == NIL) {_type = OBJECT; _o = new ObjectT<char_t>;}
-			JSON_CHECK_TYPE(_type, OBJECT);
-			return *_o;
+			size_t pos = 0, depth = 0;
+			while(pos < len) {
+				switch(in[pos]) {
+					case '\"':
+						for(++pos; ; pos = std::min(pos + 2, len)) {
+							pos += json_find_quote(in + pos, len - pos);
+							JSON_PARSE_CHECK(pos < len);
+							if(in[pos] == '\"') break;
+						}
+						if(!depth) return pos + 1;
+						break;
+					case '{': case '[': ++depth; break;
+					case '}': case ']':
+						JSON_PARSE_CHECK(depth);
+						if(!--depth) return pos + 1;
+						break;
+					case ' ': case '\t': case '\r': case '\n': break;
+					default:
+						if(depth) {
+							pos += json_find_structural(in + pos, len - pos);
+							continue;
+						}
+						// scalar
+						while(pos < len && in[pos] != ',' && in[pos] != '}' && in[pos] != ']' && in[pos] != ' ' && in[pos] != '\t' && in[pos] != '\r' && in[pos] != '\n') ++pos;
+						return pos;
+				}
+				++pos;
+			}
+			JSON_PARSE_CHECK(false);
+			return pos;
 		}
-		/** Fetch object const-reference */
-		inline const ObjectT<char_t>& o() const
+
+		// unicode code points of UTF-8 / UTF-16 / UTF-32 text
+		inline size_t json_code_points(const char* s, size_t n)
 		{
-			JSON_CHECK_TYPE(_type, OBJECT);
-			return *_o;
+			size_t count = 0;
+			for(size_t i = 0; i < n; ++i) count += (static_cast<unsigned char>(s[i]) & 0xC0) != 0x80;
+			return count;
 		}
-		/** Fetch array reference */
-		inline ArrayT<char_t>& a()
+		inline size_t json_code_points(const wchar_t* s, size_t n)
 		{
-			if(_type == NIL) {_type = ARRAY; _a = new ArrayT<char_t>;}
-			JSON_CHECK_TYPE(_type, ARRAY);
-			return *_a;
+			if(sizeof(wchar_t) > 2) return n;
+			size_t count = 0;
+			for(size_t i = 0; i < n; ++i) count += (s[i] & 0xFC00) != 0xDC00;
+			return count;
 		}
-		/** Fetch array const-reference */
-		inline const ArrayT<char_t>& a() const
+
+		// heap bytes of string, 0 if it fits in the sso buffer of basic_string
+		template<class string_t> inline size_t json_string_heap(const string_t& s)
 		{
-			JSON_CHECK_TYPE(_type, ARRAY);
-			return *_a;
+			const char* p = reinterpret_cast<const char*>(s.data());
+			const char* b = reinterpret_cast<const char*>(&s);
+			if(p >= b && p < b + sizeof(string_t)) return 0;
+			return (s.capacity() + 1) * sizeof(typename string_t::value_type);
 		}
-		/** Support [] operator for object. */
-		inline ValueT<char_t>& operator[](const char_t* key)
+
+		// internals of ValueT used by codecs
+		struct json_value_access
 		{
-			if(_type == NIL) {_type = OBJECT; _o = new ObjectT<char_t>;}
-			JSON_CHECK_TYPE(_type, OBJECT);
-			return (*_o)[key];
-		}
-		/** Support [] operator for object. */
-		inline ValueT<char_t>& operator[](const tstring& key)
+			// parse raw value(unparsed json text) into out
+			template<class value_t> static void parse_raw(const value_t& raw, value_t& out)
+			{
+				out.raw(raw.c_str(), static_cast<size_t>(raw.length()));
+				out._e = true;
+				out.touch();
+			}
+			// parse a number of json text into out, return chars consumed
+			template<class value_t, class char_t> static size_t read_number(value_t& out, const char_t* in, size_t len) {return out.read_number(in, len);}
+			// parse a value of any type into out, return chars consumed
+			template<class value_t, class char_t> static size_t read_value(value_t& out, const char_t* in, size_t len, bool dma = false)
+			{
+				size_t pos = 0;
+				while(pos < len && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\r' || in[pos] == '\t')) ++pos;
+				JSON_PARSE_CHECK(pos < len);
+				switch(in[pos]) {
+					case '{': case '[':  return pos + out.read(in + pos, len - pos, dma);
+					case '\"':           return pos + out.read_string(in + pos, len - pos, dma);
+					case 't': case 'f':  return pos + out.read_boolean(in + pos, len - pos, dma);
+					case 'n':            return pos + out.read_nil(in + pos, len - pos, dma);
+					default:             return pos + out.read_number(in + pos, len - pos, dma);
+				}
+			}
+		};
+
+		// sink of binary encoders over memory of known size, any type with append(const char*, size_t) is a sink, e.g. std::string
+		class json_buffer_sink
 		{
-			if(_type == NIL) {_type = OBJECT; _o = new ObjectT<char_t>;}
-			JSON_CHECK_TYPE(_type, OBJECT);
-			return (*_o)[key];
-		}
-		/** Support [] operator for array. */
-		template<class T>
-		inline typename detail::json_enable_if<detail::json_is_integral<T>::value, ValueT<char_t>&>::type
-		operator[](T pos)
+		public:
+			json_buffer_sink(char* data, size_t size) : _data(data), _size(size), _pos(0) {}
+			inline void append(const char* p, size_t n)
+			{
+				JSON_ASSERT_CHECK(n <= _size - _pos, std::length_error, "Buffer overflow.");
+				memcpy(_data + _pos, p, n);
+				_pos += n;
+			}
+			inline size_t size() const {return _pos;}
+			inline char& operator[](size_t i) {return _data[i];}
+
+		private:
+			char* _data;
+			size_t _size;
+			size_t _pos;
+		};
+
+		// output core of binary encoders
+		template<class sink_t> class json_binary_writer
 		{
-			if(_type == NIL) {_type = ARRAY; _a = new ArrayT<char_t>;}
-			JSON_ASSERT_CHECK(pos >= 0, std::underflow_error, "Array index underflow");
-			JSON_CHECK_TYPE(_type, ARRAY);
-			if (pos >= _a->size()) _a->resize(pos + 1);
-			return (*_a)[pos];
-		}
+		public:
+			explicit json_binary_writer(sink_t& out) : _out(out) {}
 
-		/** Support get value with elegant cast. */
-		template<class T> T get(const T& default_value) const;
+			inline void byte(unsigned int b) {const char c = static_cast<char>(b); _out.append(&c, 1);}
+			inline void bytes(const void* p, size_t n) {_out.append(static_cast<const char*>(p), n);}
+			// n bytes of v, big endian
+			inline void be(uint64_t v, size_t n)
+			{
+				char buf[8];
+				for(size_t i = n; i-- > 0; v >>= 8) buf[i] = static_cast<char>(v & 0xFF);
+				_out.append(buf, n);
+			}
+			// n bytes of v, little endian
+			inline void le(uint64_t v, size_t n)
+			{
+				char buf[8];
+				for(size_t i = 0; i < n; ++i, v >>= 8) buf[i] = static_cast<char>(v & 0xFF);
+				_out.append(buf, n);
+			}
+			// back-patching of lengths, the sink needs size() & operator[] like std::string
+			inline size_t pos() const {return _out.size();}
+			inline void patch_le(size_t at, uint64_t v, size_t n) {for(size_t i = 0; i < n; ++i, v >>= 8) _out[at + i] = static_cast<char>(v & 0xFF);}
 
-		/** Support get value of key with elegant cast, return default_value if key not exist. */
-		template<class T> T get(const tstring& key, const T& default_value) const;
+		private:
+			sink_t& _out;
+		};
 
-		/** Clear current value. */
-		void clear(Type	type = NIL);
+		// input core of binary decoders, every read is bounds checked
+		class json_binary_reader
+		{
+		public:
+			json_binary_reader(const char* in, size_t len) : _in(reinterpret_cast<const unsigned char*>(in)), _len(len), _pos(0) {}
 
-		/** Write value to stream. */
-		void write(tstring& out) const;
+			inline void need(size_t n) const {JSON_ASSERT_CHECK1(n <= _len - _pos, "Decode error: truncated at pos=%zu.", _pos);}
+			inline unsigned int byte() {need(1); return _in[_pos++];}
+			inline unsigned int peek() const {need(1); return _in[_pos];}
+			inline const char* bytes(size_t n) {need(n); _pos += n; return reinterpret_cast<const char*>(_in + _pos - n);}
+			inline uint64_t be(size_t n)
+			{
+				need(n);
+				uint64_t v = 0;
+				for(size_t i = 0; i < n; ++i) v = (v << 8) | _in[_pos++];
+				return v;
+			}
+			inline uint64_t le(size_t n)
+			{
+				need(n);
+				uint64_t v = 0;
+				for(size_t i = n; i-- > 0; ) v = (v << 8) | _in[_pos + i];
+				_pos += n;
+				return v;
+			}
+			// nul terminated string, n is its length without the terminator
+			inline const char* cstring(size_t& n)
+			{
+				const void* end = memchr(_in + _pos, 0, _len - _pos);
+				JSON_ASSERT_CHECK1(end, "Decode error: truncated at pos=%zu.", _pos);
+				n = static_cast<size_t>(static_cast<const unsigned char*>(end) - _in) - _pos;
+				return bytes(n + 1);
+			}
+			inline size_t pos() const {return _pos;}
+			inline size_t size() const {return _len;}
 
-		void to_string(tstring& out) const;
+		private:
+			const unsigned char* _in;
+			size_t _len;
+			size_t _pos;
+		};
 
-		/**
-			Read object/array from stream.
-			Return char_t count(offset) parsed.
-			If error occurred, throws an exception.
-		*/
-		size_t read(const char_t* in, size_t len, bool dma = true);
-		size_t read(const char_t* in, bool dma = true)
+		inline float json_float(unsigned int bits) {float f; memcpy(&f, &bits, sizeof(f)); return f;}
+		inline double json_double(uint64_t bits) {double d; memcpy(&d, &bits, sizeof(d)); return d;}
+		inline unsigned int json_bits(float f) {unsigned int bits; memcpy(&bits, &f, sizeof(bits)); return bits;}
+		inline uint64_t json_bits(double d) {uint64_t bits; memcpy(&bits, &d, sizeof(bits)); return bits;}
+
+		// text on the wire of binary formats is UTF-8, char strings are passed through as they are
+		template<class char_t> struct json_utf8;
+		template<> struct json_utf8<char>
 		{
-			return read(in, detail::tcslen(in), dma);
-		}
-		size_t read(const tstring& in, bool dma = true)
+			static inline size_t size(const char*, size_t n) {return n;}
+			template<class sink_t> static inline void write(json_binary_writer<sink_t>& w, const char* s, size_t n) {w.bytes(s, n);}
+			template<class string_t> static inline void read(const char* in, size_t n, string_t& out) {out.assign(in, n);}
+			// reference the input if dma
+			template<class value_t> static inline void assign(value_t& v, const char* in, size_t n, bool dma) {v.assign(in, n, AUTO_DETECT, dma);}
+		};
+		template<> struct json_utf8<wchar_t>
 		{
-			return read(in.data(), in.size(), dma);
-		}
+			// next code point, surrogate pairs are joined if wchar_t is UTF16
+			static inline unsigned int next(const wchar_t* s, size_t n, size_t& i)
+			{
+				unsigned int cp = static_cast<unsigned int>(s[i]);
+				if(sizeof(wchar_t) == 2 && cp >= 0xD800 && cp < 0xDC00 && i + 1 < n && s[i + 1] >= 0xDC00 && s[i + 1] < 0xE000)
+					cp = 0x10000 + ((cp & 0x3FF) << 10) + (static_cast<unsigned int>(s[++i]) & 0x3FF);
+				return cp;
+			}
+			static inline size_t size(const wchar_t* s, size_t n)
+			{
+				size_t bytes = 0;
+				for(size_t i = 0; i < n; ++i) {
+					const unsigned int cp = next(s, n, i);
+					bytes += cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+				}
+				return bytes;
+			}
+			template<class sink_t> static void write(json_binary_writer<sink_t>& w, const wchar_t* s, size_t n)
+			{
+				char buf[256];
+				size_t len = 0;
+				for(size_t i = 0; i < n; ++i) {
+					if(len > sizeof(buf) - 4) {w.bytes(buf, len); len = 0;}
+					const unsigned int cp = next(s, n, i);
+					if(cp < 0x80) buf[len++] = static_cast<char>(cp);
+					else if(cp < 0x800) {
+						buf[len++] = static_cast<char>(0xC0 | (cp >> 6));
+						buf[len++] = static_cast<char>(0x80 | (cp & 0x3F));
+					}
+					else if(cp < 0x10000) {
+						buf[len++] = static_cast<char>(0xE0 | (cp >> 12));
+						buf[len++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+						buf[len++] = static_cast<char>(0x80 | (cp & 0x3F));
+					}
+					else {
+						buf[len++] = static_cast<char>(0xF0 | ((cp >> 18) & 0x07));
+						buf[len++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+						buf[len++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+						buf[len++] = static_cast<char>(0x80 | (cp & 0x3F));
+					}
+				}
+				w.bytes(buf, len);
+			}
+			template<class string_t> static void read(const char* in, size_t n, string_t& out)
+			{
+				const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+				out.clear();
+				out.reserve(n);
+				for(size_t i = 0; i < n; ) {
+					unsigned int cp = p[i++];
+					size_t follow = cp < 0x80 ? 0 : cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 4;
+					JSON_ASSERT_CHECK1(follow < 4 && follow <= n - i, "Decode error: invalid UTF-8 at pos=%zu.", i - 1);
+					if(follow) cp &= 0x3F >> follow;
+					for(; follow; --follow) {
+						JSON_ASSERT_CHECK1((p[i] & 0xC0) == 0x80, "Decode error: invalid UTF-8 at pos=%zu.", i);
+						cp = (cp << 6) | (p[i++] & 0x3F);
+					}
+					if(sizeof(wchar_t) == 2 && cp >= 0x10000) {
+						out += static_cast<wchar_t>(0xD800 | ((cp - 0x10000) >> 10));
+						out += static_cast<wchar_t>(0xDC00 | ((cp - 0x10000) & 0x3FF));
+					}
+					else out += static_cast<wchar_t>(cp);
+				}
+			}
+			template<class value_t> static inline void assign(value_t& v, const char* in, size_t n, bool)
+			{
+				typename value_t::tstring s;
+				read(in, n, s);
+				v.assign(s.data(), s.size(), AUTO_DETECT, false);
+			}
+		};
 
-		const char_t* c_str() const
+		// header of binary snapshot, followed by tape words & string chars, see DocumentT::save
+		struct json_snapshot
 		{
-			JSON_CHECK_TYPE(_type, STRING);
-			if(_sso)
-				return reinterpret_cast<const char_t*>(_sso_s);
-			else if (_dma)
-				return _d;
-			else
-				return _s->c_str();
-		}
+			char magic[4];           // "XPJS"
+			unsigned int order;      // 0x01020304 in byte order of writer
+			unsigned int version;
+			unsigned int char_size;  // sizeof(char_t)
+			uint64_t words;          // tape
+			uint64_t chars;          // strings, nul terminators included
 
-		uint64_t length() const
+			// check header, sizes & the whole tape in one pass, the tape follows header with 8 bytes alignment
+			static inline const json_snapshot* check(const void* data, size_t size, size_t char_size)
+			{
+				const json_snapshot* h = static_cast<const json_snapshot*>(data);
+				JSON_ASSERT_CHECK(data && !(reinterpret_cast<size_t>(data) & 7) && size >= sizeof(json_snapshot), std::logic_error, "Snapshot error: bad header.");
+				JSON_ASSERT_CHECK(!memcmp(h->magic, "XPJS", 4) && h->order == 0x01020304 && h->version == 1 && h->char_size == char_size, std::logic_error, "Snapshot error: bad header.");
+				const size_t room = size - sizeof(json_snapshot);
+				JSON_ASSERT_CHECK(h->words && h->words <= room / 8 && h->chars <= (room - h->words * 8) / char_size, std::logic_error, "Snapshot error: truncated.");
+				const uint64_t* tape = reinterpret_cast<const uint64_t*>(h + 1);
+				check_tape(tape, static_cast<size_t>(h->words), reinterpret_cast<const char*>(tape + h->words), static_cast<size_t>(h->chars), char_size);
+				return h;
+			}
+
+			// one value at root spanning the tape: payload words present, strings in bounds & nul terminated,
+			// jumps & counts of containers matching their closing words, keys of objects are strings
+			static inline void check_tape(const uint64_t* tape, size_t words, const char* strings, size_t chars, size_t char_size)
+			{
+				const uint64_t mask = (uint64_t(1) << 56) - 1;
+				std::vector<std::pair<size_t, uint64_t> > open; // position of '{' or '[' & count of items
+				bool key = false;
+				size_t i = 0;
+				for(;;) {
+					JSON_ASSERT_CHECK(i < words, std::logic_error, "Snapshot error: bad tape.");
+					const int tag = static_cast<int>(tape[i] >> 56);
+					const uint64_t payload = tape[i] & mask;
+					if(key && tag != '}') JSON_ASSERT_CHECK(tag == '\"', std::logic_error, "Snapshot error: bad tape.");
+					switch(tag) {
+						case 'n': case 't': case 'f': ++i; break;
+						case 'l': case 'd':
+							JSON_ASSERT_CHECK(i + 1 < words, std::logic_error, "Snapshot error: bad tape.");
+							i += 2;
+							break;
+						case '\"': {
+								JSON_ASSERT_CHECK(i + 1 < words && payload < chars && tape[i + 1] < chars - payload, std::logic_error, "Snapshot error: bad string.");
+								const char* nul = strings + static_cast<size_t>(payload + tape[i + 1]) * char_size;
+								for(size_t k = 0; k < char_size; ++k) JSON_ASSERT_CHECK(!nul[k], std::logic_error, "Snapshot error: bad string.");
+								i += 2;
+							}
+							if(key) {
+								key = false;
+								continue;
+							}
+							break;
+						case '{': case '[':
+							open.push_back(std::make_pair(i, uint64_t(0)));
+							key = (tag == '{');
+							++i;
+							continue;
+						case '}': case ']': {
+								JSON_ASSERT_CHECK(!open.empty() && (tag == ']' || key), std::logic_error, "Snapshot error: bad tape.");
+								const size_t pos = open.back().first;
+								JSON_ASSERT_CHECK(static_cast<int>(tape[pos] >> 56) == (tag == '}' ? '{' : '[') && (tape[pos] & mask) == i + 1 && payload == open.back().second, std::logic_error, "Snapshot error: bad tape.");
+								open.pop_back();
+								++i;
+							}
+							break;
+						default:
+							JSON_ASSERT_CHECK(false, std::logic_error, "Snapshot error: bad tape.");
+					}
+					// a value is complete
+					if(open.empty()) break;
+					++open.back().second;
+					key = (static_cast<int>(tape[open.back().first] >> 56) == '{');
+				}
+				JSON_ASSERT_CHECK(i == words, std::logic_error, "Snapshot error: bad tape.");
+			}
+		};
+
+		// read-only mapping of a file, or a buffered copy if it can't be mapped(pipes, empty or special files)
+		class json_file
 		{
-			JSON_CHECK_TYPE(_type, STRING);
-			if(_sso)
-				return _sso_len;
-			else if (_dma)
-				return _dma_len;
-			else
-				return _s->length();
-		}
+		public:
+			json_file() : _data(0), _size(0), _mapped(false) {}
+			~json_file() {close();}
 
-	protected:
+			inline void open(const char* path)
+			{
+				close();
+#if __XPJSON_SUPPORT_MMAP__
+				const int fd = ::open(path, O_RDONLY);
+				JSON_ASSERT_CHECK1(fd >= 0, "File error: path=%.200s.", path);
+				struct stat st;
+				if(!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+					void* p = mmap(0, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+					if(p != MAP_FAILED) {
+						madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+						_data = static_cast<char*>(p);
+						_size = static_cast<size_t>(st.st_size);
+						_mapped = true;
+					}
+				}
+				::close(fd);
+				if(_mapped) return;
+#endif
+				FILE* fp = fopen(path, "rb");
+				JSON_ASSERT_CHECK1(fp, "File error: path=%.200s.", path);
+				for(size_t capacity = 0; ; ) {
+					if(_size == capacity) {
+						capacity = capacity ? capacity * 2 : 0x10000;
+						char* p = static_cast<char*>(realloc(_data, capacity));
+						if(!p) {fclose(fp); throw std::bad_alloc();}
+						_data = p;
+					}
+					const size_t n = fread(_data + _size, 1, capacity - _size, fp);
+					if(!n) break;
+					_size += n;
+				}
+				const bool error = ferror(fp) != 0;
+				fclose(fp);
+				JSON_ASSERT_CHECK1(!error, "File error: path=%.200s.", path);
+			}
 
-		/**
-			Read types from stream.
-			Return char_t count(offset) parsed.
-			If error occurred, throws an exception.
-		*/
-		size_t read_nil(const char_t* in, size_t len, bool dma = true);
-		size_t read_boolean(const char_t* in, size_t len, bool dma = true);
-		size_t read_number(const char_t* in, size_t len, bool dma = true);
-		/* NOTE: MUST with quotes.*/
-		size_t read_string(const char_t* in, size_t len, bool dma = true);
+			inline void close()
+			{
+#if __XPJSON_SUPPORT_MMAP__
+				if(_mapped) munmap(_data, _size);
+				else
+#endif
+				free(_data);
+				_data = 0;
+				_size = 0;
+				_mapped = false;
+			}
 
-		Type _type        : 3;
-		mutable bool _sso : 1; // small string optimization
-		union {
-			struct {     // not sso
-				mutable bool _dma : 1; // used for direct memory access string
-				bool _e           : 1; // used for string, indicates needs to be escaped or encoded.
-				char              : 2; // reserved
-			};
-			int _sso_len : 4;
-		};
-		char _sso_s[3]; // sso string storage, 15 bytes can be used in fact
-		uint _dma_len;
-		union {
-			bool    _b;
-			int64_t _i;
-			double  _f;
-			mutable tstring* _s;
-			ObjectT<char_t>* _o;
-			ArrayT<char_t> * _a;
-			const char_t   * _d;
-		};
-	};
+			inline const char* data() const {return _data;}
+			inline size_t size() const {return _size;}
+			inline bool mapped() const {return _mapped;}
 
-	typedef ValueT<char>    Value;
-	typedef ValueT<wchar_t> ValueW;
+		private:
+			json_file(const json_file&);
+			json_file& operator=(const json_file&);
 
-	template<class char_t>
-	struct WriterT
+			char* _data;
+			size_t _size;
+			bool _mapped;
+		};
+	}
+
+	/** JSON type of a value. */
+	enum Type
 	{
-		static inline void write(const ValueT<char_t>& v, JSON_TSTRING(char_t)& out) {v.write(out);}
-		static void write(const ObjectT<char_t>& o, JSON_TSTRING(char_t)& out);
-		static void write(const ArrayT<char_t>& a, JSON_TSTRING(char_t)& out);
+		NIL,        // Null
+		BOOLEAN,    // Boolean(true, false)
+		INTEGER,    // Integer
+		FLOAT,      // Float 3.14 12e-10
+		STRING,     // String " ... "
+		OBJECT,     // Object {...}
+		ARRAY,      // Array  [ ... ]
+		RAW         // Unparsed json text, referenced like dma string and written verbatim
 	};
 
-	typedef WriterT<char>    Writer;
-	typedef WriterT<wchar_t> WriterW;
+	inline const char* get_type_name(int type);
 
-	template<class char_t>
-	struct ReaderT
+	/**
+		End offset of the value at in(leading white spaces skipped), without parsing it.
+		Brackets and quotes are matched, but nothing else is validated.
+		If the value is incomplete, throws an exception.
+	*/
+	template<class char_t> inline size_t skip(const char_t* in, size_t len) {return detail::json_skip(in, len);}
+
+	/** Memory footprint of a value tree, see ValueT::memory_usage(). */
+	struct MemoryUsage
 	{
-		static inline size_t read(ValueT<char_t>& v, const char_t* in, size_t len, bool dma = true) {return v.read(in, len, dma);}
-		static inline size_t read(ValueT<char_t>& v, const char_t* in, bool dma = true) {return v.read(in, detail::tcslen(in), dma);}
-		static inline size_t read(ValueT<char_t>& v, const JSON_TSTRING(char_t)& in, bool dma = true) {return v.read(in.data(), in.size(), dma);}
-	};
+		MemoryUsage() : container_bytes(0), key_bytes(0), string_bytes(0), sso_count(0), dma_bytes(0), shared_bytes(0)
+		{
+			memset(count, 0, sizeof(count));
+		}
 
-	typedef ReaderT<char>    Reader;
-	typedef ReaderT<wchar_t> ReaderW;
+		/** Heap bytes owned by the tree, the root value itself excluded. */
+		inline size_t heap_bytes() const {return container_bytes + key_bytes + string_bytes;}
 
-	/* Compare functions */
-	template<class char_t> bool operator==(const ObjectT<char_t>& lhs, const ObjectT<char_t>& rhs);
-	template<class char_t> bool operator==(const ArrayT<char_t>& lhs, const ArrayT<char_t>& rhs);
-	template<class char_t> bool operator==(const ValueT<char_t>& lhs, const ValueT<char_t>& rhs);
-
-	template<class char_t> inline bool operator!=(const ObjectT<char_t>& lhs, const ObjectT<char_t>& rhs) {return !operator==(lhs, rhs);}
-	template<class char_t> inline bool operator!=(const ArrayT<char_t>& lhs, const ArrayT<char_t>& rhs) {return !operator==(lhs, rhs);}
-	template<class char_t> inline bool operator!=(const ValueT<char_t>& lhs, const ValueT<char_t>& rhs) {return !operator==(lhs, rhs);}
-
-	template<class char_t> inline bool operator==(const ValueT<char_t>& v, bool b) {return v.type() == BOOLEAN && b == v.b();}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
-	operator==(const ValueT<char_t>& v, T i) {return v.type() == INTEGER && i == v.i();}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
-	operator==(const ValueT<char_t>& v, T f) {return v.type() == FLOAT && fabs(f - v.f()) < JSON_EPSILON;}
-	template<class char_t> inline bool operator==(const ValueT<char_t>& v, const JSON_TSTRING(char_t)& s) {return v.type() == STRING && !s.compare(0, s.length(), v.c_str(), v.length());}
-	template<class char_t> inline bool operator==(const ValueT<char_t>& v, const ObjectT<char_t>& o) {return v.type() == OBJECT && o == v.o();}
-	template<class char_t> inline bool operator==(const ValueT<char_t>& v, const ArrayT<char_t>& a) {return v.type() == ARRAY && a == v.a();}
-
-	template<class char_t> inline bool operator==(bool b, const ValueT<char_t>& v) {return operator==(v, b);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
-	operator==(T i, const ValueT<char_t>& v) {return operator==(v, i);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
-	operator==(T f, const ValueT<char_t>& v) {return operator==(v, f);}
-	template<class char_t> inline bool operator==(const JSON_TSTRING(char_t)& s, const ValueT<char_t>& v) {return operator==(v, s);}
-	template<class char_t> inline bool operator==(const ObjectT<char_t>& o, const ValueT<char_t>& v) {return operator==(v, o);}
-	template<class char_t> inline bool operator==(const ArrayT<char_t>& a, const ValueT<char_t>& v) {return operator==(v, a);}
-
-	template<class char_t> inline bool operator!=(const ValueT<char_t>& v, bool b) {return !operator==(v, b);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
-	operator!=(const ValueT<char_t>& v, T i) {return !operator==(v, i);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
-	operator!=(const ValueT<char_t>& v, T f) {return !operator==(v, f);}
-	template<class char_t> inline bool operator!=(const ValueT<char_t>& v, const JSON_TSTRING(char_t)& s) {return !operator==(v, s);}
-	template<class char_t> inline bool operator!=(const ValueT<char_t>& v, const ObjectT<char_t>& o) {return !operator==(v, o);}
-	template<class char_t> inline bool operator!=(const ValueT<char_t>& v, const ArrayT<char_t>& a) {return !operator==(v, a);}
-
-	template<class char_t> inline bool operator!=(bool b, const ValueT<char_t>& v) {return !operator==(v, b);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
-	operator!=(T i, const ValueT<char_t>& v) {return !operator==(v, i);}
-	template<class char_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
-	operator!=(T f, const ValueT<char_t>& v) {return !operator==(v, f);}
-	template<class char_t> inline bool operator!=(const JSON_TSTRING(char_t)& s, const ValueT<char_t>& v) {return !operator==(v, s);}
-	template<class char_t> inline bool operator!=(const ObjectT<char_t>& o, const ValueT<char_t>& v) {return !operator==(v, o);}
-	template<class char_t> inline bool operator!=(const ArrayT<char_t>& a, const ValueT<char_t>& v) {return !operator==(v, a);}
-}
+		size_t count[RAW + 1];   // values of each type, indexed by Type
+		size_t container_bytes;  // objects & arrays, map nodes and deque blocks (child values included)
+		size_t key_bytes;        // keys beyond the inline buffer of basic_string
+		size_t string_bytes;     // owned strings, sso & dma ones excluded
+		size_t sso_count;        // strings stored inline of value
+		size_t dma_bytes;        // bytes referenced by dma strings & raw values, not owned
+		size_t shared_bytes;     // part of heap bytes in shared containers, counted at every reference
+	};
+
+	// Forward declaration
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class ValueT;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class MaskT;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class DocumentT;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class FileValueT;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class GatherWriterT;
+
+	/** A JSON object, i.e., a container whose keys are strings, this
+	is roughly equivalent to a Python dictionary, a PHP's associative
+	array, a Perl or a C++ map(depending on the implementation). */
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class ObjectT : public std::map<typename detail::json_string<char_t, alloc_t>::type, ValueT<char_t, alloc_t>,
+		std::less<typename detail::json_string<char_t, alloc_t>::type>,
+		typename detail::json_rebind<alloc_t, std::pair<const typename detail::json_string<char_t, alloc_t>::type, ValueT<char_t, alloc_t> > >::type>,
+		public detail::json_shared, public detail::json_fragment<typename detail::json_string<char_t, alloc_t>::type, alloc_t>
+	{
+	public:
+		/** 64-bit hash of content, independent of the order of members. */
+		uint64_t hash() const;
+	};
+
+	typedef ObjectT<char>    Object;
+	typedef ObjectT<wchar_t> ObjectW;
+
+	/** A JSON array, i.e., an indexed container of elements. It contains
+	JSON values, that can have any of the types in ValueType. */
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class ArrayT : public std::deque<ValueT<char_t, alloc_t>, typename detail::json_rebind<alloc_t, ValueT<char_t, alloc_t> >::type>, public detail::json_shared,
+		public detail::json_fragment<typename detail::json_string<char_t, alloc_t>::type, alloc_t>
+	{
+	public:
+		/** 64-bit hash of content. */
+		uint64_t hash() const;
+	};
+
+	typedef ArrayT<char>    Array;
+	typedef ArrayT<wchar_t> ArrayW;
+
+	/** A JSON value. Can have either type in ValueTypes. */
+	template<class char_t, class alloc_t>
+	class ValueT
+	{
+	public:
+		typedef typename detail::json_string<char_t, alloc_t>::type tstring;
+
+		/** Default constructor(type = NIL). */
+		ValueT() : _type(NIL) {}
+		/** Constructor with type. */
+		ValueT(Type type);
+		/** Copy constructor. */
+		ValueT(const ValueT<char_t, alloc_t>& v);
+
+		/** Constructor from bool. */
+		ValueT(bool b) : _type(BOOLEAN), _b(b) {}
+		/** Constructor from integer. */
+#define JSON_INTEGER_CTOR(type)		ValueT(type i) : _type(INTEGER), _i(i) {}
+		JSON_INTEGER_CTOR(unsigned char)
+		JSON_INTEGER_CTOR(signed char)
+#ifdef _NATIVE_WCHAR_T_DEFINED
+		JSON_INTEGER_CTOR(wchar_t)
+#endif /* _NATIVE_WCHAR_T_DEFINED */
+		JSON_INTEGER_CTOR(unsigned short)
+		JSON_INTEGER_CTOR(signed short)
+		JSON_INTEGER_CTOR(unsigned int)
+		JSON_INTEGER_CTOR(signed int)
+#if (defined (__GNUC__) && !defined(__x86_64__)) || (defined(_WIN32) && !defined(_WIN64))
+		JSON_INTEGER_CTOR(unsigned long)
+		JSON_INTEGER_CTOR(signed long)
+#endif
+		JSON_INTEGER_CTOR(uint64_t)
+		JSON_INTEGER_CTOR(int64_t)
+#undef JSON_INTEGER_CTOR
+		/** Constructor from float. */
+#define JSON_FLOAT_CTOR(type)		ValueT(type f) : _type(FLOAT), _f(f) {}
+		JSON_FLOAT_CTOR(float)
+		JSON_FLOAT_CTOR(double)
+		JSON_FLOAT_CTOR(long double)
+#undef JSON_FLOAT_CTOR
+
+		/** Constructor from pointer to char(C-string).  */
+		ValueT(const char_t* s, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s, detail::tcslen(s), escape, dma);}
+		/** Constructor from pointer to char(C-string).  */
+		ValueT(const char_t* s, size_t l, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s, l, escape, dma);}
+		/** Constructor from STD string  */
+		ValueT(const tstring& s, int escape = AUTO_DETECT, bool dma = false) : _type(NIL) {assign(s.data(), s.size(), escape, dma);}
+		/** Constructor from pointer to Object. */
+		ValueT(const ObjectT<char_t, alloc_t>& o) : _type(OBJECT), _o(0) {_o = create<ObjectT<char_t, alloc_t> >(o);}
+		/** Constructor from pointer to Array. */
+		ValueT(const ArrayT<char_t, alloc_t>& a) : _type(ARRAY), _a(0) {_a = create<ArrayT<char_t, alloc_t> >(a);}
+#ifdef __XPJSON_SUPPORT_MOVE__
+		/** Move constructor. */
+		ValueT(ValueT<char_t, alloc_t>&& v) : _type(NIL) {assign(JSON_MOVE(v));}
+		/** Move constructor from STD string  */
+		ValueT(tstring&& s, int escape = AUTO_DETECT) : _type(NIL) {assign(JSON_MOVE(s), escape);}
+		/** Move constructor from pointer to Object. */
+		ValueT(ObjectT<char_t, alloc_t>&& o) : _type(OBJECT), _o(0) {_o = create<ObjectT<char_t, alloc_t> >(); _o->swap(o);}
+		/** Move constructor from pointer to Array. */
+		ValueT(ArrayT<char_t, alloc_t>&& a) : _type(ARRAY), _a(0) {_a = create<ArrayT<char_t, alloc_t> >(); _a->swap(a);}
+#endif
+
+		~ValueT() {clear();}
+
+		/** Assign function. */
+		void assign(const ValueT<char_t, alloc_t>& v);
+		/** Assign function from bool. */
+		inline void assign(bool b) {clear(BOOLEAN); _b = b;}
+		/** Assign function from integer. */
+		template<class T>
+		inline typename detail::json_enable_if<detail::json_is_integral<T>::value>::type
+		assign(T i) {clear(INTEGER); _i = i;}
+		/** Assign function from float. */
+		template<class T>
+		inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value>::type
+		assign(T f) {clear(FLOAT); _f = f;}
+		/** Assign function from pointer to char(C-string).  */
+		inline void assign(const char_t* s, int escape = AUTO_DETECT, bool dma = true) {assign(s, detail::tcslen(s), escape, dma);}
+		/** Assign function from pointer to char(C-string).  */
+		inline void assign(const char_t* s, size_t l, int escape = AUTO_DETECT, bool dma = true);
+		/** Assign function from STD string  */
+		inline void assign(const tstring& s, int escape = AUTO_DETECT, bool dma = true) {assign(s.data(), s.size(), escape, dma);}
+		/** Assign function from pointer to Object. */
+		inline void assign(const ObjectT<char_t, alloc_t>& o) {clear(OBJECT); *_o = o;}
+		/** Assign function from pointer to Array. */
+		inline void assign(const ArrayT<char_t, alloc_t>& a) {clear(ARRAY); *_a = a;}
+#ifdef __XPJSON_SUPPORT_MOVE__
+		/** Assign function. */
+		void assign(ValueT<char_t, alloc_t>&& v);
+ 		// Fix: use swap rather than operator= to avoid bug under VS2010
+		/** Assign function from STD string  */
+		inline void assign(tstring&& s, int escape = AUTO_DETECT);
+		/** Assign function from pointer to Object. */
+		inline void assign(ObjectT<char_t, alloc_t>&& o) {clear(OBJECT); _o->clear(); _o->swap(o);}
+		/** Assign function from pointer to Array. */
+		inline void assign(ArrayT<char_t, alloc_t>&& a) {clear(ARRAY); _a->clear(); _a->swap(a);}
+#endif
+
+		/** Assignment operator. */
+		inline ValueT<char_t, alloc_t>& operator=(const ValueT<char_t, alloc_t>& v) {if(this != &v) {assign(v);} return *this;}
+#define JSON_ASSIGNMENT(arg)		{assign(arg);return *this;}
+		/** Assignment operator from int/float/bool. */
+		template<class T>
+		inline typename detail::json_enable_if<detail::json_is_arithmetic<T>::value, ValueT<char_t, alloc_t>&>::type
+		operator=(T a) JSON_ASSIGNMENT(a)
+		/** Assignment operator from pointer to char(C-string).  */
+		inline ValueT<char_t, alloc_t>& operator=(const char_t* s) JSON_ASSIGNMENT(s)
+		/** Assignment operator from STD string  */
+		inline ValueT<char_t, alloc_t>& operator=(const tstring& s) JSON_ASSIGNMENT(s)
+		/** Assignment operator from pointer to Object. */
+		inline ValueT<char_t, alloc_t>& operator=(const ObjectT<char_t, alloc_t>& o) JSON_ASSIGNMENT(o)
+		/** Assignment operator from pointer to Array. */
+		inline ValueT<char_t, alloc_t>& operator=(const ArrayT<char_t, alloc_t>& a) JSON_ASSIGNMENT(a)
+#ifdef __XPJSON_SUPPORT_MOVE__
+		/** Assignment operator. */
+		inline ValueT<char_t, alloc_t>& operator=(ValueT<char_t, alloc_t>&& v) {if(this != &v) {assign(JSON_MOVE(v));} return *this;}
+		/** Assignment operator from STD string  */
+		inline ValueT<char_t, alloc_t>& operator=(tstring&& s) JSON_ASSIGNMENT(JSON_MOVE(s))
+		/** Assignment operator from pointer to Object. */
+		inline ValueT<char_t, alloc_t>& operator=(ObjectT<char_t, alloc_t>&& o) JSON_ASSIGNMENT(JSON_MOVE(o))
+		/** Assignment operator from pointer to Array. */
+		inline ValueT<char_t, alloc_t>& operator=(ArrayT<char_t, alloc_t>&& a) JSON_ASSIGNMENT(JSON_MOVE(a))
+#endif
+#undef JSON_ASSIGNMENT
+
+		/** Type query. */
+		inline Type type() const {touch(); return static_cast<Type>(_type);}
+
+		/** Cast operator for bool */
+		inline operator bool() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, BOOLEAN);
+			return _b;
+		}
+		/** Cast operator for integer */
+#define JSON_INTEGER_OPERATOR(type)		\
+	inline operator type() const {touch(); JSON_CHECK_TYPE(_type, INTEGER);return _i;}
+		JSON_INTEGER_OPERATOR(unsigned char)
+		JSON_INTEGER_OPERATOR(signed char)
+#ifdef _NATIVE_WCHAR_T_DEFINED
+		JSON_INTEGER_OPERATOR(wchar_t)
+#endif /* _NATIVE_WCHAR_T_DEFINED */
+		JSON_INTEGER_OPERATOR(unsigned short)
+		JSON_INTEGER_OPERATOR(signed short)
+		JSON_INTEGER_OPERATOR(unsigned int)
+		JSON_INTEGER_OPERATOR(signed int)
+#if (defined (__GNUC__) && !defined(__x86_64__)) || (defined(_WIN32) && !defined(_WIN64))
+		JSON_INTEGER_OPERATOR(unsigned long)
+		JSON_INTEGER_OPERATOR(signed long)
+#endif
+		JSON_INTEGER_OPERATOR(uint64_t)
+		JSON_INTEGER_OPERATOR(int64_t)
+#undef JSON_INTEGER_OPERATOR
+		/** Cast operator for float */
+#define JSON_FLOAT_OPERATOR(type)		\
+	inline operator type() const {touch(); JSON_CHECK_TYPE(_type, FLOAT);return _f;}
+		JSON_FLOAT_OPERATOR(float)
+		JSON_FLOAT_OPERATOR(double)
+		JSON_FLOAT_OPERATOR(long double)
+#undef JSON_FLOAT_OPERATOR
+		/** Cast operator for STD string */
+		inline operator tstring() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, STRING);
+			return tstring(c_str(), length());
+		}
+		/** Cast operator for Object */
+		inline operator ObjectT<char_t, alloc_t>() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, OBJECT);
+			return *_o;
+		}
+		/** Cast operator for Array */
+		inline operator ArrayT<char_t, alloc_t>() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, ARRAY);
+			return *_a;
+		}
+
+		/** Fetch boolean reference */
+		inline bool& b()
+		{
+			touch();
+			if(_type == NIL) {_type = BOOLEAN; _b = false;}
+			JSON_CHECK_TYPE(_type, BOOLEAN);
+			return _b;
+		}
+		/** Fetch boolean value */
+		inline bool b() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, BOOLEAN);
+			return _b;
+		}
+		/** Fetch integer reference*/
+		inline int64_t& i()
+		{
+			touch();
+			if(_type == NIL) {_type = INTEGER; _i = 0;}
+			JSON_CHECK_TYPE(_type, INTEGER);
+			return _i;
+		}
+		/** Fetch integer value*/
+		inline int64_t i() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, INTEGER);
+			return _i;
+		}
+		/** Fetch float reference */
+		inline double& f()
+		{
+			touch();
+			if(_type == NIL) {_type = FLOAT; _f = 0;}
+			JSON_CHECK_TYPE(_type, FLOAT);
+			return _f;
+		}
+		/** Fetch float value */
+		inline long double f() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, FLOAT);
+			return _f;
+		}
+		/** Fetch string reference */
+		inline tstring& s()
+		{
+			touch();
+			if(_type == NIL) {_type = STRING; _sso = _dma = false; _s = create<tstring>();}
+			JSON_CHECK_TYPE(_type, STRING);
+			if(_sso || _dma){
+				_s = create<tstring>(c_str(), length());
+				_sso = _dma = false;
+			}
+			_e = true; // the string may be modified by caller
+			return *_s;
+		}
+		/** Fetch string const-reference */
+		inline const tstring& s() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, STRING);
+			if(_sso || _dma){
+				_s = create<tstring>(c_str(), length());
+				_sso = _dma = false;
+			}
+			return *_s;
+		}
+		/** Fetch object reference */
+		inline ObjectT<char_t, alloc_t>& o()
+		{
+			touch();
+			if(_type == NIL) {_type = OBJECT; _o = create<ObjectT<char_t, alloc_t> >();}
+			JSON_CHECK_TYPE(_type, OBJECT);
+			detach(_o);
+			return *_o;
+		}
+		/** Fetch object const-reference */
+		inline const ObjectT<char_t, alloc_t>& o() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, OBJECT);
+			return *_o;
+		}
+		/** Fetch array reference */
+		inline ArrayT<char_t, alloc_t>& a()
+		{
+			touch();
+			if(_type == NIL) {_type = ARRAY; _a = create<ArrayT<char_t, alloc_t> >();}
+			JSON_CHECK_TYPE(_type, ARRAY);
+			detach(_a);
+			return *_a;
+		}
+		/** Fetch array const-reference */
+		inline const ArrayT<char_t, alloc_t>& a() const
+		{
+			touch();
+			JSON_CHECK_TYPE(_type, ARRAY);
+			return *_a;
+		}
+		/** Support [] operator for object. */
+		inline ValueT<char_t, alloc_t>& operator[](const char_t* key)
+		{
+			touch();
+			if(_type == NIL) {_type = OBJECT; _o = create<ObjectT<char_t, alloc_t> >();}
+			JSON_CHECK_TYPE(_type, OBJECT);
+			detach(_o);
+			return (*_o)[key];
+		}
+		/** Support [] operator for object. */
+		inline ValueT<char_t, alloc_t>& operator[](const tstring& key)
+		{
+			touch();
+			if(_type == NIL) {_type = OBJECT; _o = create<ObjectT<char_t, alloc_t> >();}
+			JSON_CHECK_TYPE(_type, OBJECT);
+			detach(_o);
+			return (*_o)[key];
+		}
+		/** Support [] operator for array. */
+		template<class T>
+		inline typename detail::json_enable_if<detail::json_is_integral<T>::value, ValueT<char_t, alloc_t>&>::type
+		operator[](T pos)
+		{
+			touch();
+			if(_type == NIL) {_type = ARRAY; _a = create<ArrayT<char_t, alloc_t> >();}
+			JSON_ASSERT_CHECK(pos >= 0, std::underflow_error, "Array index underflow");
+			JSON_CHECK_TYPE(_type, ARRAY);
+			detach(_a);
+			if (pos >= _a->size()) _a->resize(pos + 1);
+			return (*_a)[pos];
+		}
+
+		/** Support get value with elegant cast. */
+		template<class T> T get(const T& default_value) const;
+
+		/** Support get value of key with elegant cast, return default_value if key not exist. */
+		template<class T> T get(const tstring& key, const T& default_value) const;
+
+		/** Clear current value. */
+		void clear(Type	type = NIL);
+
+		/**
+			Share object/array of value(recursively), so that copies of it
+			only add a reference instead of deep copy, and the shared one is
+			copied on write(any non-const access of o(), a() and operator[]).
+			Reference count is atomic, shared values can be copied across
+			threads, and should only be read by const access then, except s().
+			With fragments, shared containers keep their text once written,
+			and write splices it in, e.g. for templates of documents.
+		*/
+		void share(bool fragments = false);
+		/** Whether object/array of value is shared. */
+		inline bool shared() const {return (_type == OBJECT && detail::json_atomic_load(&_o->_refs)) || (_type == ARRAY && detail::json_atomic_load(&_a->_refs));}
+
+		/**
+			64-bit hash of content, equal values have equal hashes, the same for char & wchar_t.
+			Strings are hashed as UTF-8, raw values as parsed, -0.0 as 0.0, members of object in any order.
+			Hashes of shared objects/arrays are memoized, since they're immutable.
+		*/
+		uint64_t hash() const;
+
+		/** Memory footprint of the tree, deque blocks are estimated as they depend on the history. */
+		inline MemoryUsage memory_usage() const {MemoryUsage usage; memory_usage(usage, false); return usage;}
+		/** Accumulate memory footprint of the tree to usage, e.g. sum of documents. */
+		inline void memory_usage(MemoryUsage& usage) const {memory_usage(usage, false);}
+
+		/** Write value to stream. */
+		void write(tstring& out) const;
+
+		void to_string(tstring& out) const;
+
+		/**
+			Read object/array from stream.
+			Return char_t count(offset) parsed.
+			If error occurred, throws an exception.
+		*/
+		size_t read(const char_t* in, size_t len, bool dma = true);
+		size_t read(const char_t* in, bool dma = true)
+		{
+			return read(in, detail::tcslen(in), dma);
+		}
+		size_t read(const tstring& in, bool dma = true)
+		{
+			return read(in.data(), in.size(), dma);
+		}
+		/**
+			Lazy read of object/array, values are parsed level by level when touched by
+			type(), o(), a(), operator[], get() and other accessors, even const ones.
+			Untouched values are neither decoded nor allocated, and written verbatim.
+			in must outlive the value, like dma. share() touches all values.
+			NOTE: touching modifies the value and may throw parse errors, so a lazy value isn't
+			thread-safe even for const access, share() it before reading it from many threads.
+		*/
+		size_t read_lazy(const char_t* in, size_t len);
+		/**
+			Read object/array, only values on paths of mask are built.
+			Others are skipped by bracket & quote matching without being validated.
+			With raw mask, others are kept as raw values referencing in if dma, otherwise they're parsed and copied.
+		*/
+		size_t read(const char_t* in, size_t len, const MaskT<char_t, alloc_t>& mask, bool dma = true);
+		/**
+			Merge patch text(RFC 7396) into the value while parsing it: members of patch objects are merged
+			into objects of the value in place, null removes a member, any other value replaces.
+			Untouched parts of the value are neither copied nor rebuilt.
+			Strings are copied by default since a patch usually lives shorter than the value,
+			with dma the patch text must outlive the value.
+			If error occurred, throws an exception and the value is left partly patched.
+		*/
+		size_t read_merge(const char_t* in, size_t len, bool dma = false);
+
+		/** Raw value, referenced but not copied, the text must outlive the value like dma string. */
+		inline void raw(const char_t* in, size_t len)
+		{
+			JSON_ASSERT_CHECK(len <= (uint)-1, std::length_error, "Raw value is too long.");
+			clear(RAW);
+			_d = in;
+			_dma_len = static_cast<uint>(len);
+		}
+
+		/** String or text of raw value. */
+		const char_t* c_str() const
+		{
+			touch();
+			if(_type != RAW) JSON_CHECK_TYPE(_type, STRING);
+			if(_sso)
+				return sso_s();
+			else if (_dma)
+				return _d;
+			else
+				return _s->c_str();
+		}
+
+		uint64_t length() const
+		{
+			touch();
+			if(_type != RAW) JSON_CHECK_TYPE(_type, STRING);
+			if(_sso)
+				return _sso_len;
+			else if (_dma)
+				return _dma_len;
+			else
+				return _s->length();
+		}
+
+	protected:
+		friend class DocumentT<char_t, alloc_t>;
+		friend class GatherWriterT<char_t, alloc_t>;
+		friend struct detail::json_value_access;
+
+		/**
+			Read types from stream.
+			Return char_t count(offset) parsed.
+			If error occurred, throws an exception.
+		*/
+		size_t read_nil(const char_t* in, size_t len, bool dma = true);
+		size_t read_boolean(const char_t* in, size_t len, bool dma = true);
+		size_t read_number(const char_t* in, size_t len, bool dma = true);
+		/* NOTE: MUST with quotes.*/
+		size_t read_string(const char_t* in, size_t len, bool dma = true);
+		/* NOTE: MUST start with bracket or brace.*/
+		size_t read_masked(const char_t* in, size_t len, const MaskT<char_t, alloc_t>& mask, bool dma, bool raw);
+		/* NOTE: MUST start with brace.*/
+		size_t read_merge_object(const char_t* in, size_t len, bool dma);
+
+		void memory_usage(MemoryUsage& usage, bool in_shared) const;
+
+		/** Parse lazy raw value when touched. */
+		inline void touch() const {if(_type == RAW && _e) materialize();}
+		void materialize() const;
+
+		/** Copy-on-write, make shared container exclusive before modification. */
+		template<class T> static inline void detach(T*& p)
+		{
+			const long refs = detail::json_atomic_load(&p->_refs);
+			if(refs) {
+				if(refs != 1) {
+					T* c = create<T>(*p);
+					release(p);
+					p = c;
+				}
+				else {
+					p->_refs = 0;
+					p->_hash = 0;
+					p->drop();
+				}
+			}
+		}
+		/** Add a reference to shared container, or copy it. */
+		template<class T> static inline T* duplicate(T* p)
+		{
+			if(!detail::json_atomic_load(&p->_refs)) return create<T>(*p);
+			detail::json_atomic_inc(&p->_refs);
+			return p;
+		}
+		/** Delete container unless it's still shared by others. */
+		template<class T> static inline void release(T* p)
+		{
+			if(!detail::json_atomic_load(&p->_refs) || !detail::json_atomic_dec(&p->_refs)) destroy(p);
+		}
+
+		/** Construct & destroy by alloc_t instead of plain new & delete. */
+		template<class T> static inline T* create()
+		{
+			T* p = detail::json_allocate<T, alloc_t>();
+			try {new(p) T();} catch(...) {detail::json_deallocate<T, alloc_t>(p); throw;}
+			return p;
+		}
+		template<class T, class A1> static inline T* create(const A1& a1)
+		{
+			T* p = detail::json_allocate<T, alloc_t>();
+			try {new(p) T(a1);} catch(...) {detail::json_deallocate<T, alloc_t>(p); throw;}
+			return p;
+		}
+		template<class T, class A1, class A2> static inline T* create(const A1& a1, const A2& a2)
+		{
+			T* p = detail::json_allocate<T, alloc_t>();
+			try {new(p) T(a1, a2);} catch(...) {detail::json_deallocate<T, alloc_t>(p); throw;}
+			return p;
+		}
+		template<class T> static inline void destroy(T* p)
+		{
+			p->~T();
+			detail::json_deallocate<T, alloc_t>(p);
+		}
+
+		/** Storage of sso string, from the offset after flags & _sso_len up to the end of value. */
+		inline char_t* sso_s() const
+		{
+			// layout drift must fail the build rather than overwrite _sso_len or the flags
+			(void)sizeof(char[offsetof(ValueT, _sso_len) == 1 && offsetof(ValueT, _b) == 8 ? 1 : -1]);
+			return reinterpret_cast<char_t*>(const_cast<char*>(reinterpret_cast<const char*>(this)) + detail::json_sso<char_t>::offset);
+		}
+
+		// bitfields of one declared type, so that all compilers pack them into the first byte
+		unsigned char _type        : 3; // Type
+		mutable unsigned char _sso : 1; // small string optimization
+		mutable unsigned char _dma : 1; // used for direct memory access string
+		unsigned char _e           : 1; // used for string, indicates needs to be escaped or encoded. for raw, indicates parsed when touched.
+		unsigned char              : 2; // reserved
+		mutable unsigned char _sso_len; // char_t count of sso string, storage see sso_s()
+		uint _dma_len;
+		union {
+			bool    _b;
+			int64_t _i;
+			double  _f;
+			mutable tstring* _s;
+			ObjectT<char_t, alloc_t>* _o;
+			ArrayT<char_t, alloc_t> * _a;
+			const char_t   * _d;
+			char _sso_buf[detail::json_sso<char_t>::size - 8]; // extends value to json_sso::size for sso
+		};
+	};
+
+	typedef ValueT<char>    Value;
+	typedef ValueT<wchar_t> ValueW;
+
+	// keep the fixed layout, sso storage relies on it, offsets are checked by sso_s()
+	JSON_STATIC_ASSERT(sizeof(Value) == detail::json_sso<char>::size, json_value_size_check);
+	JSON_STATIC_ASSERT(sizeof(ValueW) == detail::json_sso<wchar_t>::size, json_valuew_size_check);
+
+	/**
+		Value read from a file, owns the file mapping its dma strings point into.
+		The file is mapped by mmap with sequential advice, or read into a buffer if it can't be mapped.
+		Content of file is an array of char_t, i.e. wchar_t files are in the native wide encoding.
+		Not copyable, copies of the value must not outlive it unless they are read without dma.
+	*/
+	template<class char_t, class alloc_t>
+	class FileValueT : public ValueT<char_t, alloc_t>
+	{
+	public:
+		FileValueT() {}
+		/** Read file, throws an exception if it can't be opened or parsed. */
+		explicit FileValueT(const char* path, bool dma = true) {read_file(path, dma);}
+
+		/** Read file, return char_t count(offset) parsed. Without dma the file is released after read. */
+		size_t read_file(const char* path, bool dma = true)
+		{
+			this->clear();
+			_file.open(path);
+			JSON_ASSERT_CHECK1(_file.size() % sizeof(char_t) == 0, "File error: path=%.200s.", path);
+			const size_t pos = this->read(reinterpret_cast<const char_t*>(_file.data()), _file.size() / sizeof(char_t), dma);
+			if(!dma) _file.close();
+			return pos;
+		}
+
+		/** Whether the file is mapped rather than buffered. */
+		inline bool mapped() const {return _file.mapped();}
+
+	private:
+		FileValueT(const FileValueT&);
+		FileValueT& operator=(const FileValueT&);
+
+		detail::json_file _file;
+	};
+
+	typedef FileValueT<char>    FileValue;
+	typedef FileValueT<wchar_t> FileValueW;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct WriterT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		static inline void write(const ValueT<char_t, alloc_t>& v, tstring& out) {v.write(out);}
+		static void write(const ObjectT<char_t, alloc_t>& o, tstring& out);
+		static void write(const ArrayT<char_t, alloc_t>& a, tstring& out);
+	};
+
+	typedef WriterT<char>    Writer;
+	typedef WriterT<wchar_t> WriterW;
+
+	/**
+		Scatter/gather output for writev / sendmsg, text is written as a list of segments instead of one string.
+		Long strings which need no escaping, raw values and cached text of shared containers are referenced
+		but not copied, only punctuation, numbers, keys and short or escaped strings go into a scratch buffer.
+		Segments are valid until next write or clear, and as long as the values are neither modified nor destroyed.
+	*/
+	template<class char_t, class alloc_t>
+	class GatherWriterT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+		typedef std::pair<const char_t*, size_t> segment;
+
+		/** min_length: strings and texts shorter than it are copied into scratch buffer, since a segment costs more. */
+		explicit GatherWriterT(size_t min_length = 64) : _min_length(min_length), _open(0) {}
+
+		/** Append segments of v. */
+		inline void write(const ValueT<char_t, alloc_t>& v) {value(v); flush();}
+		inline void clear() {_parts.clear(); _scratch.clear(); _open = 0;}
+
+		/** Segment count and char_t count of all segments. */
+		inline size_t count() const {return _parts.size();}
+		size_t length() const;
+		/** Append segments in order, lengths are char_t counts. */
+		void segments(std::vector<segment>& out) const;
+		/** Append segments as iovec alike (iov_base, iov_len in bytes), e.g. struct iovec for writev. */
+		template<class iovec_t> void iovecs(std::vector<iovec_t>& out) const
+		{
+			for(size_t i = 0; i < _parts.size(); ++i) {
+				iovec_t iov;
+				iov.iov_base = const_cast<char_t*>(data(_parts[i]));
+				iov.iov_len = _parts[i].len * sizeof(char_t);
+				out.push_back(iov);
+			}
+		}
+
+	protected:
+		// text of null data is in scratch buffer from pos, which may be reallocated while writing
+		struct part
+		{
+			part(const char_t* d, size_t p, size_t n) : data(d), pos(p), len(n) {}
+			const char_t* data;
+			size_t pos;
+			size_t len;
+		};
+
+		inline const char_t* data(const part& p) const {return p.data ? p.data : _scratch.data() + p.pos;}
+		inline void flush()
+		{
+			if(_scratch.length() == _open) return;
+			_parts.push_back(part(NULL, _open, _scratch.length() - _open));
+			_open = _scratch.length();
+		}
+		inline void reference(const char_t* text, size_t n)
+		{
+			if(n < _min_length) {
+				_scratch.append(text, n);
+				return;
+			}
+			flush();
+			_parts.push_back(part(text, 0, n));
+		}
+		void value(const ValueT<char_t, alloc_t>& v);
+		void write(const ObjectT<char_t, alloc_t>& o);
+		void write(const ArrayT<char_t, alloc_t>& a);
+
+		size_t _min_length;
+		size_t _open;
+		std::vector<part> _parts;
+		tstring _scratch;
+	};
+
+	typedef GatherWriterT<char>    GatherWriter;
+	typedef GatherWriterT<wchar_t> GatherWriterW;
+
+	/**
+		Formatted output for debug dumps, kept apart from WriterT so that compact writing pays nothing for it.
+		Values are written with keys in map order(sorted), text is reformatted in source order without parsing it into values,
+		its structure is checked but scalars aren't validated. Output is appended to out, indents take no memory besides it.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class FormatterT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/**
+			indent: indent chars per level, 0 writes minified text without any newline.
+			inline_width: arrays of scalars are kept on one line if they fit in width chars, 0 never.
+		*/
+		explicit FormatterT(unsigned int indent = 4, char indent_char = ' ', bool crlf = false, size_t inline_width = 0)
+			: _indent(indent), _indent_char(static_cast<char_t>(indent_char)), _crlf(crlf), _inline_width(inline_width) {}
+
+		/** Append formatted v. */
+		void write(const ValueT<char_t, alloc_t>& v, tstring& out) const {write(v, 0, out);}
+		/** Append formatted json text, return char_t count(offset) parsed. If error occurred, throws an exception. */
+		size_t format(const char_t* in, size_t len, tstring& out) const;
+		inline size_t format(const tstring& in, tstring& out) const {return format(in.data(), in.size(), out);}
+
+		/** Append json text without insignificant white spaces. */
+		static inline size_t minify(const char_t* in, size_t len, tstring& out) {return FormatterT(0).format(in, len, out);}
+		static inline size_t minify(const tstring& in, tstring& out) {return minify(in.data(), in.size(), out);}
+
+	protected:
+		inline void newline(size_t depth, tstring& out) const
+		{
+			if(!_indent) return;
+			if(_crlf) out += '\r';
+			out += '\n';
+			out.append(depth * _indent, _indent_char);
+		}
+		void write(const ValueT<char_t, alloc_t>& v, size_t depth, tstring& out) const;
+		static size_t token(const char_t* in, size_t len, tstring& out);
+		size_t inline_array(const char_t* in, size_t len, tstring& out) const;
+
+		unsigned int _indent;
+		char_t _indent_char;
+		bool _crlf;
+		size_t _inline_width;
+	};
+
+	typedef FormatterT<char>    Formatter;
+	typedef FormatterT<wchar_t> FormatterW;
+
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct ReaderT
+	{
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len, bool dma = true) {return v.read(in, len, dma);}
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char_t* in, bool dma = true) {return v.read(in, detail::tcslen(in), dma);}
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const typename ValueT<char_t, alloc_t>::tstring& in, bool dma = true) {return v.read(in.data(), in.size(), dma);}
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len, const MaskT<char_t, alloc_t>& mask, bool dma = true) {return v.read(in, len, mask, dma);}
+		static inline size_t read_lazy(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len) {return v.read_lazy(in, len);}
+		/** Read file by mmap, dma strings point into the mapping owned by v. */
+		static inline size_t read_file(FileValueT<char_t, alloc_t>& v, const char* path, bool dma = true) {return v.read_file(path, dma);}
+		/** Read file into tape document, the mapping is released after read. */
+		static inline size_t read_file(DocumentT<char_t, alloc_t>& d, const char* path)
+		{
+			detail::json_file file;
+			file.open(path);
+			JSON_ASSERT_CHECK1(file.size() % sizeof(char_t) == 0, "File error: path=%.200s.", path);
+			return d.read(reinterpret_cast<const char_t*>(file.data()), file.size() / sizeof(char_t));
+		}
+	};
+
+	typedef ReaderT<char>    Reader;
+	typedef ReaderT<wchar_t> ReaderW;
+
+	/**
+		JSON Pointer(RFC 6901) like "/a/b/0/c", compiled once and resolved against many values.
+		Resolving never allocates nor inserts missing keys.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class PointerT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Empty pointer, refers to the whole document. */
+		PointerT() {}
+		/** Compile pointer, throws an exception if it's invalid. */
+		PointerT(const char_t* in, size_t len) {compile(in, len);}
+		PointerT(const char_t* in) {compile(in, detail::tcslen(in));}
+		PointerT(const tstring& in) {compile(in.data(), in.size());}
+
+		void compile(const char_t* in, size_t len);
+
+		/** Referenced value, or 0 if not found. */
+		const ValueT<char_t, alloc_t>* get(const ValueT<char_t, alloc_t>& v) const;
+		/** Referenced value, or 0 if not found. Shared containers along the path are copied on write. */
+		ValueT<char_t, alloc_t>* get(ValueT<char_t, alloc_t>& v) const;
+
+		/** Count of reference tokens. */
+		inline size_t size() const {return _tokens.size();}
+		/** Unescaped reference token. */
+		inline const tstring& operator[](size_t i) const {return _tokens[i].first;}
+		/** Array index of reference token, npos if it's not an index. */
+		inline size_t index(size_t i) const {return _tokens[i].second;}
+
+	protected:
+		// unescaped token and array index of it, npos if it's not an index
+		typedef pair<tstring, size_t> token;
+		vector<token, typename detail::json_rebind<alloc_t, token>::type> _tokens;
+	};
+
+	typedef PointerT<char>    Pointer;
+	typedef PointerT<wchar_t> PointerW;
+
+	/**
+		JSONPath expression, compiled once and evaluated against many values.
+		Supports:
+			$.a.b  $['a']['b']  $.a[0]  $.a[-1]  $.a[0,2]  $['a','b']
+			$.*  $[*]  $..a  $..*  $.a[1:5:2]  $.a[?(@.b)]  $.a[?(@.b.c >= 10)]  $.a[?(@ == 'x')]
+		Filter operators: == != < <= > >=, literals: number, 'string', "string", true, false, null.
+		Matches are referenced in document order, objects by key order.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class PathT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Compile expression, throws an exception if it's invalid. */
+		PathT(const char_t* in, size_t len) {compile(in, len);}
+		PathT(const char_t* in) {compile(in, detail::tcslen(in));}
+		PathT(const tstring& in) {compile(in.data(), in.size());}
+
+		void compile(const char_t* in, size_t len);
+
+		/** Append at most limit matched values to out, return count appended. */
+		size_t select(const ValueT<char_t, alloc_t>& v, vector<const ValueT<char_t, alloc_t>*>& out, size_t limit = size_t(-1)) const;
+		/** First matched value, or 0. Evaluation stops at the first match. */
+		const ValueT<char_t, alloc_t>* first(const ValueT<char_t, alloc_t>& v) const;
+
+	protected:
+		enum {NAME, WILDCARD, INDEX, SLICE, FILTER};
+		enum {EXISTS, EQ, NE, LT, LE, GT, GE};
+
+		struct step
+		{
+			step() : kind(NAME), recursive(false), start(0), end(0), stride(1), has_start(false), has_end(false), op(EXISTS) {}
+
+			int kind;
+			bool recursive;                  // ..
+			vector<tstring> names;           // NAME
+			vector<int64_t> indexes;         // INDEX, negative ones count from the end
+			int64_t start, end, stride;      // SLICE
+			bool has_start, has_end;
+			vector<tstring> rel;             // FILTER, path relative to @
+			int op;
+			ValueT<char_t, alloc_t> literal;
+		};
+
+		struct context
+		{
+			vector<const ValueT<char_t, alloc_t>*>* out;
+			const ValueT<char_t, alloc_t>* found;
+			size_t count;
+			size_t limit;
+		};
+
+		// return false to stop evaluation
+		bool match(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const;
+		bool descend(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const;
+		bool apply(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const;
+		bool test(const step& s, const ValueT<char_t, alloc_t>& v) const;
+
+		size_t parse_bracket(const char_t* in, size_t len, size_t pos, step& s);
+		size_t parse_quoted(const char_t* in, size_t len, size_t pos, tstring& out);
+		size_t parse_literal(const char_t* in, size_t len, size_t pos, ValueT<char_t, alloc_t>& out);
+
+		vector<step, typename detail::json_rebind<alloc_t, step>::type> _steps;
+	};
+
+	typedef PathT<char>    Path;
+	typedef PathT<wchar_t> PathW;
+
+	/**
+		Field mask for projection-at-parse, a tree of JSON Pointers, e.g. "/id", "/user/name".
+		Token "*" matches any member or element not matched by name.
+		Skipped elements before a selected one are kept as null, so indexes don't change.
+	*/
+	template<class char_t, class alloc_t>
+	class MaskT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** raw: keep values out of mask as raw values instead of dropping them, e.g. for proxies. */
+		explicit MaskT(bool raw = false) : _index(size_t(-1)), _all(false), _raw(raw) {}
+
+		/** Include value referenced by pointer and all of its children. */
+		MaskT& add(const PointerT<char_t, alloc_t>& p);
+		inline MaskT& add(const char_t* p) {return add(PointerT<char_t, alloc_t>(p));}
+
+		/** Whether the whole value is included. */
+		inline bool all() const {return _all;}
+		/** Whether values out of mask are kept as raw values. */
+		inline bool raw() const {return _raw;}
+		/** Mask of member, or 0 if it's excluded. */
+		const MaskT* find(const char_t* key, size_t len) const;
+		/** Mask of element, or 0 if it's excluded. */
+		const MaskT* find(size_t index) const;
+
+	protected:
+		tstring _key;       // token of member / element
+		size_t _index;      // array index of token, npos if it's not an index
+		bool _all;
+		bool _raw;
+		vector<MaskT, typename detail::json_rebind<alloc_t, MaskT>::type> _children;
+	};
+
+	typedef MaskT<char>    Mask;
+	typedef MaskT<wchar_t> MaskW;
+
+	/**
+		Read-only cursor on the tape of DocumentT, a position of tape and nothing else.
+		Copy is cheap, valid until the document is read again or destroyed.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class CursorT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Invalid cursor, e.g. a missing member. */
+		CursorT() : _tape(0), _strings(0), _pos(0), _member(false) {}
+		CursorT(const uint64_t* tape, const char_t* strings, size_t pos, bool member = false) : _tape(tape), _strings(strings), _pos(pos), _member(member) {}
+
+		inline bool valid() const {return _tape != 0;}
+		Type type() const;
+
+		bool b() const;
+		int64_t i() const;
+		double f() const;
+		/** Decoded string, nul terminated. */
+		const char_t* c_str() const;
+		size_t length() const;
+		inline tstring s() const {return tstring(c_str(), length());}
+
+		/** Count of members / elements. */
+		size_t size() const;
+		/** First member / element, a member is positioned at its value, see key(). */
+		CursorT begin() const;
+		CursorT end() const;
+		/** Next member / element, containers are skipped by jump index. */
+		CursorT& operator++();
+		/** Key of member. */
+		inline CursorT key() const {return CursorT(_tape, _strings, _pos - 2);}
+
+		/** Member of object by linear scan, invalid cursor if not found. */
+		CursorT find(const char_t* key, size_t len) const;
+		inline CursorT operator[](const char_t* key) const {return find(key, detail::tcslen(key));}
+		inline CursorT operator[](const tstring& key) const {return find(key.data(), key.size());}
+		/** Element of array, invalid cursor if out of range. */
+		template<class T>
+		inline typename detail::json_enable_if<detail::json_is_integral<T>::value, CursorT>::type
+		operator[](T pos) const
+		{
+			JSON_CHECK_TYPE(type(), ARRAY);
+			CursorT it = begin();
+			const CursorT last = end();
+			for(; pos > 0 && it != last; --pos) ++it;
+			return (pos == 0 && it != last) ? it : CursorT();
+		}
+
+		/** Build value tree of this value. */
+		void to_value(ValueT<char_t, alloc_t>& out) const;
+
+		inline bool operator==(const CursorT& rhs) const {return _tape == rhs._tape && _pos == rhs._pos;}
+		inline bool operator!=(const CursorT& rhs) const {return !operator==(rhs);}
+
+	protected:
+		inline int tag(size_t pos) const {return static_cast<int>(_tape[pos] >> 56);}
+		inline uint64_t payload(size_t pos) const {return _tape[pos] & ((uint64_t(1) << 56) - 1);}
+
+		const uint64_t* _tape;
+		const char_t* _strings;
+		size_t _pos;
+		bool _member;       // positioned at value of a member, key is 2 words before
+	};
+
+	typedef CursorT<char>    Cursor;
+	typedef CursorT<wchar_t> CursorW;
+
+	/**
+		Immutable document on a tape, for read-only workloads(validation, extraction, indexing)
+		without map & deque nodes. Values are 64-bit words in document order, tag << 56 | payload:
+			'{' '['      payload is the index past matching '}' ']'
+			'}' ']'      payload is count of members / elements
+			'"'          payload is offset in string buffer, next word is length
+			'l' 'd'      next word is int64 / bits of double
+			't' 'f' 'n'  no payload
+		A member is a key string followed by its value. Strings are decoded & nul terminated
+		in the string buffer, so tape & strings are position independent.
+	*/
+	template<class char_t, class alloc_t>
+	class DocumentT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+		typedef vector<uint64_t, typename detail::json_rebind<alloc_t, uint64_t>::type> tape_type;
+
+		DocumentT() {}
+		DocumentT(const char_t* in, size_t len) {read(in, len);}
+
+		/**
+			Read object/array by the tokenizer of ValueT::read.
+			Return char_t count(offset) parsed. If error occurred, throws an exception.
+		*/
+		size_t read(const char_t* in, size_t len);
+		inline size_t read(const char_t* in) {return read(in, detail::tcslen(in));}
+		inline size_t read(const tstring& in) {return read(in.data(), in.size());}
+
+		inline void clear() {_tape.clear(); _strings.clear();}
+		inline bool empty() const {return _tape.empty();}
+		/** Cursor of topmost value, invalid if empty. */
+		inline CursorT<char_t, alloc_t> root() const {return empty() ? CursorT<char_t, alloc_t>() : CursorT<char_t, alloc_t>(&_tape[0], _strings.c_str(), 0);}
+
+		inline const tape_type& tape() const {return _tape;}
+		inline const tstring& strings() const {return _strings;}
+
+		/** Build tape of value tree, each distinct string is stored once. Raw values are parsed. */
+		void assign(const ValueT<char_t, alloc_t>& v);
+		/** Append binary snapshot: header, tape & strings in native byte order, see SnapshotT. */
+		void save(std::string& out) const;
+		/** Load binary snapshot by copy, throws an exception if it's invalid. */
+		void load(const void* data, size_t size);
+
+	protected:
+		typedef map<tstring, uint64_t, std::less<tstring>, typename detail::json_rebind<alloc_t, pair<const tstring, uint64_t> >::type> string_table;
+
+		static inline uint64_t word(int t, uint64_t payload) {return (uint64_t(t) << 56) | payload;}
+		static inline int tag(uint64_t w) {return static_cast<int>(w >> 56);}
+		/* NOTE: MUST with quotes.*/
+		size_t read_string(const char_t* in, size_t len);
+		void build(const ValueT<char_t, alloc_t>& v, string_table& table);
+		void build_string(const char_t* s, size_t len, string_table& table);
+
+		tape_type _tape;
+		tstring _strings;
+	};
+
+	typedef DocumentT<char>    Document;
+	typedef DocumentT<wchar_t> DocumentW;
+
+	/**
+		Binary snapshot of DocumentT(see DocumentT::save) used in place without parsing, e.g.
+		a large dictionary mapped at startup. Cursors read the mapped tape & strings directly,
+		to_value() converts it back to a mutable value tree on demand.
+		open() & attach() validate the whole tape in one linear pass(string bounds, jumps & counts),
+		so a corrupted or hostile file throws an exception instead of reading out of bounds.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class SnapshotT
+	{
+	public:
+		SnapshotT() : _tape(0), _strings(0) {}
+		/** Map snapshot file, throws an exception if it's not a valid snapshot of char_t. */
+		explicit SnapshotT(const char* path) : _tape(0), _strings(0) {open(path);}
+
+		/** Map snapshot file, throws an exception if it's not a valid snapshot of char_t. */
+		void open(const char* path)
+		{
+			_tape = 0;
+			_strings = 0;
+			_file.open(path);
+			attach(_file.data(), _file.size());
+		}
+		/** Use snapshot in memory, data must be 8 bytes aligned and outlive the snapshot. */
+		void attach(const void* data, size_t size)
+		{
+			const detail::json_snapshot* h = detail::json_snapshot::check(data, size, sizeof(char_t));
+			_tape = reinterpret_cast<const uint64_t*>(h + 1);
+			_strings = reinterpret_cast<const char_t*>(_tape + h->words);
+		}
+
+		/** Cursor of topmost value, invalid if nothing is opened. */
+		inline CursorT<char_t, alloc_t> root() const {return _tape ? CursorT<char_t, alloc_t>(_tape, _strings, 0) : CursorT<char_t, alloc_t>();}
+		/** Build value tree of the whole snapshot. */
+		inline void to_value(ValueT<char_t, alloc_t>& out) const {root().to_value(out);}
+
+	private:
+		SnapshotT(const SnapshotT&);
+		SnapshotT& operator=(const SnapshotT&);
+
+		detail::json_file _file;
+		const uint64_t* _tape;
+		const char_t* _strings;
+	};
+
+	typedef SnapshotT<char>    Snapshot;
+	typedef SnapshotT<wchar_t> SnapshotW;
+
+	/**
+		MessagePack encoding of values, types are mapped one to one:
+			nil, bool, int in the smallest encoding, float 32 if it's exact otherwise float 64,
+			str in UTF-8, map with str keys, array.
+		Raw values are parsed, bin is read as string, ext and keys of other types are rejected.
+		Output goes to a sink, any type with append(const char*, size_t), e.g. std::string.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct MsgPackT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Exact encoded size in bytes. */
+		static size_t size(const ValueT<char_t, alloc_t>& v);
+
+		/** Encode to sink. */
+		template<class sink_t> static inline void write(const ValueT<char_t, alloc_t>& v, sink_t& out)
+		{
+			detail::json_binary_writer<sink_t> w(out);
+			encode(v, w);
+		}
+		/** Append encoded value, memory is reserved by the exact size. */
+		static inline void write(const ValueT<char_t, alloc_t>& v, std::string& out)
+		{
+			out.reserve(out.size() + size(v));
+			write<std::string>(v, out);
+		}
+		/** Encode to memory, return bytes written. Throws std::length_error if it's too small. */
+		static inline size_t write(const ValueT<char_t, alloc_t>& v, char* out, size_t len)
+		{
+			detail::json_buffer_sink sink(out, len);
+			write(v, sink);
+			return sink.size();
+		}
+
+		/**
+			Decode a value, return bytes consumed. If error occurred, throws an exception.
+			With dma, strings of char reference in, which must outlive the value.
+		*/
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char* in, size_t len, bool dma = true)
+		{
+			detail::json_binary_reader r(in, len);
+			decode(v, r, dma);
+			return r.pos();
+		}
+
+	protected:
+		static inline size_t header_size(size_t n, size_t fix) {return n < fix ? 1 : n < 0x100 && fix == 32 ? 2 : n < 0x10000 ? 3 : 5;}
+		template<class sink_t> static void header(detail::json_binary_writer<sink_t>& w, size_t n, unsigned int fix, unsigned int code8, unsigned int code16, unsigned int code32);
+		template<class sink_t> static void encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w);
+		static size_t read_length(detail::json_binary_reader& r, unsigned int b);
+		static void decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, bool dma);
+	};
+
+	typedef MsgPackT<char>    MsgPack;
+	typedef MsgPackT<wchar_t> MsgPackW;
+
+	/**
+		CBOR(RFC 8949) encoding of values:
+			integers in the shortest head, floats in the narrowest of float 16/32/64 holding them exactly,
+			text strings in UTF-8, maps & arrays of definite length, or indefinite length if asked.
+		Decoding accepts definite & indefinite length strings and containers, byte strings as strings,
+		integer keys as their decimal text, undefined as null, and ignores tags.
+		Output goes to a sink, any type with append(const char*, size_t), e.g. std::string.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct CborT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Exact encoded size in bytes. */
+		static size_t size(const ValueT<char_t, alloc_t>& v, bool indefinite = false);
+
+		/** Encode to sink. */
+		template<class sink_t> static inline void write(const ValueT<char_t, alloc_t>& v, sink_t& out, bool indefinite = false)
+		{
+			detail::json_binary_writer<sink_t> w(out);
+			encode(v, w, indefinite);
+		}
+		/** Append encoded value, memory is reserved by the exact size. */
+		static inline void write(const ValueT<char_t, alloc_t>& v, std::string& out, bool indefinite = false)
+		{
+			out.reserve(out.size() + size(v, indefinite));
+			write<std::string>(v, out, indefinite);
+		}
+		/** Encode to memory, return bytes written. Throws std::length_error if it's too small. */
+		static inline size_t write(const ValueT<char_t, alloc_t>& v, char* out, size_t len, bool indefinite = false)
+		{
+			detail::json_buffer_sink sink(out, len);
+			write(v, sink, indefinite);
+			return sink.size();
+		}
+
+		/**
+			Decode a data item, return bytes consumed. If error occurred, throws an exception.
+			With dma, definite length text strings of char reference in, which must outlive the value.
+		*/
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char* in, size_t len, bool dma = true)
+		{
+			detail::json_binary_reader r(in, len);
+			decode(v, r, dma);
+			return r.pos();
+		}
+
+	protected:
+		static inline size_t head_size(uint64_t n) {return n < 24 ? 1 : n < 0x100 ? 2 : n < 0x10000 ? 3 : n <= 0xFFFFFFFFULL ? 5 : 9;}
+		template<class sink_t> static void head(detail::json_binary_writer<sink_t>& w, unsigned int major, uint64_t n);
+		// bytes of the narrowest float holding f exactly, 2 with half set, 4 or 8
+		static size_t float_size(double f, unsigned int& half);
+		static double half_to_double(unsigned int half);
+		template<class sink_t> static void encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w, bool indefinite);
+		static uint64_t argument(detail::json_binary_reader& r, unsigned int info);
+		static void decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, bool dma);
+	};
+
+	typedef CborT<char>    Cbor;
+	typedef CborT<wchar_t> CborW;
+
+	/**
+		BSON encoding of object values, lengths of documents are back-patched in a single pass,
+		so output goes to std::string or memory rather than any sink.
+		Integers are int32 if they fit, else int64, arrays are documents keyed by indexes.
+		Decoding also accepts binary as string, ObjectId as its hex text, datetime & timestamp as integers,
+		undefined as null, JavaScript code & symbols as strings.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct BsonT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Append encoded document, v must be an object. */
+		static inline void write(const ValueT<char_t, alloc_t>& v, std::string& out)
+		{
+			detail::json_binary_writer<std::string> w(out);
+			encode_root(v, w);
+		}
+		/** Encode to memory, return bytes written. Throws std::length_error if it's too small. */
+		static inline size_t write(const ValueT<char_t, alloc_t>& v, char* out, size_t len)
+		{
+			detail::json_buffer_sink sink(out, len);
+			detail::json_binary_writer<detail::json_buffer_sink> w(sink);
+			encode_root(v, w);
+			return sink.size();
+		}
+
+		/**
+			Decode a document, return bytes consumed. If error occurred, throws an exception.
+			With dma, strings of char reference in, which must outlive the value.
+		*/
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char* in, size_t len, bool dma = true)
+		{
+			detail::json_binary_reader r(in, len);
+			decode_document(v, r, OBJECT, dma);
+			return r.pos();
+		}
+
+	protected:
+		template<class sink_t> static void encode_root(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w);
+		template<class sink_t> static void encode_document(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w);
+		template<class sink_t> static void encode_element(const char_t* name, size_t n, const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w);
+		static void decode_document(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, Type type, bool dma);
+		static void decode_element(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, unsigned int type, bool dma);
+	};
+
+	typedef BsonT<char>    Bson;
+	typedef BsonT<wchar_t> BsonW;
+
+	/**
+		UBJSON(Universal Binary JSON) encoding of values:
+			integers & lengths in the smallest of int8/uint8/int16/int32/int64, float32 if it is exact,
+			NaN & infinity as null, containers delimited by their end markers.
+		Decoding accepts sized & typed containers(the '#' & '$' forms), no-ops, chars and high-precision numbers.
+		Output goes to a sink, any type with append(const char*, size_t), e.g. std::string.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct UbjsonT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Exact encoded size in bytes. */
+		static size_t size(const ValueT<char_t, alloc_t>& v);
+
+		/** Encode to sink. */
+		template<class sink_t> static inline void write(const ValueT<char_t, alloc_t>& v, sink_t& out)
+		{
+			detail::json_binary_writer<sink_t> w(out);
+			encode(v, w);
+		}
+		/** Append encoded value, memory is reserved by the exact size. */
+		static inline void write(const ValueT<char_t, alloc_t>& v, std::string& out)
+		{
+			out.reserve(out.size() + size(v));
+			write<std::string>(v, out);
+		}
+		/** Encode to memory, return bytes written. Throws std::length_error if it's too small. */
+		static inline size_t write(const ValueT<char_t, alloc_t>& v, char* out, size_t len)
+		{
+			detail::json_buffer_sink sink(out, len);
+			write(v, sink);
+			return sink.size();
+		}
+
+		/**
+			Decode a value, return bytes consumed. If error occurred, throws an exception.
+			With dma, strings of char reference in, which must outlive the value.
+		*/
+		static inline size_t read(ValueT<char_t, alloc_t>& v, const char* in, size_t len, bool dma = true)
+		{
+			detail::json_binary_reader r(in, len);
+			unsigned int marker;
+			while((marker = r.byte()) == 'N');
+			decode(v, r, marker, dma);
+			return r.pos();
+		}
+
+	protected:
+		static inline size_t int_size(int64_t i)
+		{
+			return (i >= -128 && i < 256) ? 2 : (i >= -32768 && i < 32768) ? 3 : (i >= -2147483647 - 1 && i <= 2147483647) ? 5 : 9;
+		}
+		template<class sink_t> static void encode_int(detail::json_binary_writer<sink_t>& w, int64_t i);
+		template<class sink_t> static void encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w);
+		static int64_t decode_int(detail::json_binary_reader& r, unsigned int marker);
+		static size_t decode_length(detail::json_binary_reader& r);
+		static void decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, unsigned int marker, bool dma);
+	};
+
+	typedef UbjsonT<char>    Ubjson;
+	typedef UbjsonT<wchar_t> UbjsonW;
+
+	/**
+		Fields of a struct bound to json objects, declared inside the struct:
+			struct Point {int x, y; std::string tag; JSON_BIND(Point, JSON_FIELD(x) JSON_FIELD(y) JSON_FIELD_AS(tag, "label"))};
+		Fields are bool, arithmetic, strings, std::vector/std::deque/std::map(string keys) of fields, ValueT or bound structs.
+	*/
+#define JSON_BIND(type, fields)		template<class binder_t> static void json_bind(binder_t& json_binder_) {typedef type json_self_t_; fields}
+#define JSON_FIELD(member)			json_binder_.field(#member, &json_self_t_::member);
+#define JSON_FIELD_AS(member, key)	json_binder_.field(key, &json_self_t_::member);
+
+	/**
+		Typed binding, reads json text straight into bound structs and writes them back without building values.
+		Keys are dispatched by a perfect hash of the fields, built once per struct on first use.
+		Members absent from text or null keep their values, unknown keys are skipped, mismatched types throw std::logic_error.
+		NOTE: before C++11 the table is a function-local static that isn't thread-safe to build, use each bound struct once
+		before threads start then. Keys of fields must be unique.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	struct BinderT
+	{
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		/** Parse into obj, return char_t count(offset) parsed. If error occurred, throws an exception. */
+		template<class T> static size_t read(T& obj, const char_t* in, size_t len);
+		template<class T> static inline size_t read(T& obj, const tstring& in) {return read(obj, in.data(), in.size());}
+
+		/** Append obj as json text. */
+		template<class T> static void write(const T& obj, tstring& out);
+	};
+
+	typedef BinderT<char>    Binder;
+	typedef BinderT<wchar_t> BinderW;
+
+	/**
+		JSON Schema(draft 7 subset) compiled to a validator. Keywords: type, enum, const, minimum, maximum, exclusiveMinimum,
+		exclusiveMaximum, multipleOf, minLength, maxLength, pattern, items(schema or tuple), additionalItems, minItems,
+		maxItems, properties, required, additionalProperties, minProperties & maxProperties, others are ignored.
+		Validation walks a value, or is fused into parsing: read builds the value and check only scans the text,
+		both stop at the first invalid value, check skips members without constraints unparsed.
+	*/
+	template<class char_t, class alloc_t = std::allocator<char_t> >
+	class SchemaT
+	{
+	public:
+		typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+		SchemaT() {compile(ValueT<char_t, alloc_t>(true));}
+		explicit SchemaT(const ValueT<char_t, alloc_t>& schema) {compile(schema);}
+
+		/** Compile schema, throws std::logic_error if it's malformed. Patterns need __XPJSON_SUPPORT_REGEX__. */
+		void compile(const ValueT<char_t, alloc_t>& schema);
+
+		/** Validate v, on failure the keyword & location of the first invalid value are written to error, e.g. "minimum at #/a/0". */
+		bool validate(const ValueT<char_t, alloc_t>& v, std::string* error = 0) const;
+
+		/** Parse & validate in one pass, return char_t count(offset) parsed. Throws std::logic_error at the first invalid value. */
+		size_t read(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len, bool dma = true) const;
+		/** Validate text without building values, return char_t count(offset) parsed. Throws like read. */
+		size_t check(const char_t* in, size_t len) const;
+
+	protected:
+		enum {
+			HAS_MINIMUM = 0x01, HAS_MAXIMUM = 0x02, EXCLUSIVE_MINIMUM = 0x04, EXCLUSIVE_MAXIMUM = 0x08,
+			MULTIPLE_OF = 0x10, HAS_ENUM = 0x20, HAS_PATTERN = 0x40, ANY = 0x80, NEVER = 0x100
+		};
+		// "integer" accepts floats without fraction too
+		enum {INTEGRAL = 1 << (RAW + 1)};
+
+		struct property
+		{
+			size_t node;     // npos if unconstrained
+			size_t required; // index in required names, or npos
+		};
+		typedef std::pair<tstring, property> property_t;
+
+		struct node
+		{
+			node();
+			unsigned int flags;
+			unsigned int types; // mask of 1 << Type
+			long double minimum, maximum, exclusive_minimum, exclusive_maximum, multiple_of;
+			size_t min_length, max_length, min_items, max_items, min_properties, max_properties;
+			size_t items, additional_items, additional; // nodes, npos if unconstrained
+			std::vector<size_t> tuple;
+			std::vector<property_t> properties; // sorted by name
+			size_t required;
+			ValueT<char_t, alloc_t> enums;
+#if __XPJSON_SUPPORT_REGEX__
+			std::basic_regex<char_t> pattern;
+#endif
+		};
+
+		// location of the value being validated, keys aren't escaped until failed
+		struct token
+		{
+			const char_t* key;
+			size_t n;
+			size_t index;
+		};
+		typedef std::vector<token> path_t;
+
+		static const size_t npos = static_cast<size_t>(-1);
+
+		size_t compile_node(const ValueT<char_t, alloc_t>& schema);
+		const property* find(const node& s, const char_t* key, size_t n) const;
+		const char* check_value(size_t n, const ValueT<char_t, alloc_t>& v, path_t& path) const;
+		const char* check_number(const node& s, long double x) const;
+		const char* check_string(const node& s, const char_t* str, size_t n) const;
+		size_t parse(size_t n, ValueT<char_t, alloc_t>* out, const char_t* in, size_t len, bool dma, path_t& path) const;
+		static void format(const char* keyword, const path_t& path, std::string& out);
+		static void fail(const char* keyword, const path_t& path);
+
+		std::vector<node> _nodes;
+	};
+
+	typedef SchemaT<char>    Schema;
+	typedef SchemaT<wchar_t> SchemaW;
+
+	/* Compare functions */
+	/**
+		Deep equality, floats are equal if they differ by at most epsilon times the larger magnitude(1 at least),
+		exactly if epsilon is 0 like operator==. Types must match, e.g. 1 isn't 1.0, raw values compare their text.
+		Exact comparison rejects objects/arrays with different memoized hashes at once.
+	*/
+	template<class char_t, class alloc_t> bool equal(const ObjectT<char_t, alloc_t>& lhs, const ObjectT<char_t, alloc_t>& rhs, double epsilon);
+	template<class char_t, class alloc_t> bool equal(const ArrayT<char_t, alloc_t>& lhs, const ArrayT<char_t, alloc_t>& rhs, double epsilon);
+	template<class char_t, class alloc_t> bool equal(const ValueT<char_t, alloc_t>& lhs, const ValueT<char_t, alloc_t>& rhs, double epsilon);
+
+	template<class char_t, class alloc_t> inline bool operator==(const ObjectT<char_t, alloc_t>& lhs, const ObjectT<char_t, alloc_t>& rhs) {return equal(lhs, rhs, 0.0);}
+	template<class char_t, class alloc_t> inline bool operator==(const ArrayT<char_t, alloc_t>& lhs, const ArrayT<char_t, alloc_t>& rhs) {return equal(lhs, rhs, 0.0);}
+	template<class char_t, class alloc_t> inline bool operator==(const ValueT<char_t, alloc_t>& lhs, const ValueT<char_t, alloc_t>& rhs) {return equal(lhs, rhs, 0.0);}
+
+	template<class char_t, class alloc_t> inline bool operator!=(const ObjectT<char_t, alloc_t>& lhs, const ObjectT<char_t, alloc_t>& rhs) {return !operator==(lhs, rhs);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ArrayT<char_t, alloc_t>& lhs, const ArrayT<char_t, alloc_t>& rhs) {return !operator==(lhs, rhs);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ValueT<char_t, alloc_t>& lhs, const ValueT<char_t, alloc_t>& rhs) {return !operator==(lhs, rhs);}
+
+	template<class char_t, class alloc_t> inline bool operator==(const ValueT<char_t, alloc_t>& v, bool b) {return v.type() == BOOLEAN && b == v.b();}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
+	operator==(const ValueT<char_t, alloc_t>& v, T i) {return v.type() == INTEGER && i == v.i();}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
+	operator==(const ValueT<char_t, alloc_t>& v, T f) {return v.type() == FLOAT && v.f() == static_cast<double>(f);}
+	template<class char_t, class alloc_t, class traits_t, class salloc_t> inline bool operator==(const ValueT<char_t, alloc_t>& v, const basic_string<char_t, traits_t, salloc_t>& s) {return v.type() == STRING && !s.compare(0, s.length(), v.c_str(), v.length());}
+	template<class char_t, class alloc_t> inline bool operator==(const ValueT<char_t, alloc_t>& v, const ObjectT<char_t, alloc_t>& o) {return v.type() == OBJECT && o == v.o();}
+	template<class char_t, class alloc_t> inline bool operator==(const ValueT<char_t, alloc_t>& v, const ArrayT<char_t, alloc_t>& a) {return v.type() == ARRAY && a == v.a();}
+
+	template<class char_t, class alloc_t> inline bool operator==(bool b, const ValueT<char_t, alloc_t>& v) {return operator==(v, b);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
+	operator==(T i, const ValueT<char_t, alloc_t>& v) {return operator==(v, i);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
+	operator==(T f, const ValueT<char_t, alloc_t>& v) {return operator==(v, f);}
+	template<class char_t, class alloc_t, class traits_t, class salloc_t> inline bool operator==(const basic_string<char_t, traits_t, salloc_t>& s, const ValueT<char_t, alloc_t>& v) {return operator==(v, s);}
+	template<class char_t, class alloc_t> inline bool operator==(const ObjectT<char_t, alloc_t>& o, const ValueT<char_t, alloc_t>& v) {return operator==(v, o);}
+	template<class char_t, class alloc_t> inline bool operator==(const ArrayT<char_t, alloc_t>& a, const ValueT<char_t, alloc_t>& v) {return operator==(v, a);}
+
+	template<class char_t, class alloc_t> inline bool operator!=(const ValueT<char_t, alloc_t>& v, bool b) {return !operator==(v, b);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
+	operator!=(const ValueT<char_t, alloc_t>& v, T i) {return !operator==(v, i);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
+	operator!=(const ValueT<char_t, alloc_t>& v, T f) {return !operator==(v, f);}
+	template<class char_t, class alloc_t, class traits_t, class salloc_t> inline bool operator!=(const ValueT<char_t, alloc_t>& v, const basic_string<char_t, traits_t, salloc_t>& s) {return !operator==(v, s);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ValueT<char_t, alloc_t>& v, const ObjectT<char_t, alloc_t>& o) {return !operator==(v, o);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ValueT<char_t, alloc_t>& v, const ArrayT<char_t, alloc_t>& a) {return !operator==(v, a);}
+
+	template<class char_t, class alloc_t> inline bool operator!=(bool b, const ValueT<char_t, alloc_t>& v) {return !operator==(v, b);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_integral<T>::value, bool>::type
+	operator!=(T i, const ValueT<char_t, alloc_t>& v) {return !operator==(v, i);}
+	template<class char_t, class alloc_t, class T> inline typename detail::json_enable_if<detail::json_is_floating_point<T>::value, bool>::type
+	operator!=(T f, const ValueT<char_t, alloc_t>& v) {return !operator==(v, f);}
+	template<class char_t, class alloc_t, class traits_t, class salloc_t> inline bool operator!=(const basic_string<char_t, traits_t, salloc_t>& s, const ValueT<char_t, alloc_t>& v) {return !operator==(v, s);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ObjectT<char_t, alloc_t>& o, const ValueT<char_t, alloc_t>& v) {return !operator==(v, o);}
+	template<class char_t, class alloc_t> inline bool operator!=(const ArrayT<char_t, alloc_t>& a, const ValueT<char_t, alloc_t>& v) {return !operator==(v, a);}
+
+	/* Patch functions */
+	/**
+		JSON Patch(RFC 6902) turning from into to, appended to patch as an array of add, remove & replace ops,
+		paths are JSON Pointers(RFC 6901). Containers are diffed member by member, shared subtrees with equal
+		memoized hashes are skipped, arrays are matched by the longest common subsequence of element hashes.
+	*/
+	template<class char_t, class alloc_t> void diff(const ValueT<char_t, alloc_t>& from, const ValueT<char_t, alloc_t>& to, ValueT<char_t, alloc_t>& patch);
+	/**
+		Apply JSON Patch in place, only containers on paths of ops are modified, other subtrees are untouched.
+		If an op fails(bad op, path not found or test not equal), throws std::logic_error and the ops before it stay applied.
+	*/
+	template<class char_t, class alloc_t> void apply_patch(ValueT<char_t, alloc_t>& v, const ValueT<char_t, alloc_t>& patch);
+	/**
+		Apply JSON Merge Patch(RFC 7396) in place: members of patch objects are merged into objects of v,
+		null removes a member, any other value replaces. Untouched parts of v are neither copied nor rebuilt.
+		See also ValueT::read_merge to merge while parsing patch text.
+	*/
+	template<class char_t, class alloc_t> void merge_patch(ValueT<char_t, alloc_t>& v, const ValueT<char_t, alloc_t>& patch);
+#ifdef __XPJSON_SUPPORT_MOVE__
+	/** Apply JSON Merge Patch in place, inserted subtrees are moved from patch rather than copied. */
+	template<class char_t, class alloc_t> void merge_patch(ValueT<char_t, alloc_t>& v, ValueT<char_t, alloc_t>&& patch);
+#endif
+}
+
+namespace JSON
+{
+	const char* get_type_name(int type)
+	{
+		switch(type) {
+			case NIL:     return "Null";
+			case BOOLEAN: return "Boolean";
+			case INTEGER: return "Integer";
+			case FLOAT:   return "Floating";
+			case STRING:  return "String";
+			case OBJECT:  return "Object";
+			case ARRAY:   return "Array";
+			case RAW:     return "Raw";
+		}
+		return "Unknown";
+	}
+
+	template<class char_t, class alloc_t>
+	ValueT<char_t, alloc_t>::ValueT(Type type)
+		: _type(type)
+	{
+		switch(_type) {
+			case BOOLEAN: _b = false; break;
+			case INTEGER: _i = 0;     break;
+			case FLOAT:   _f = 0;     break;
+			case STRING:
+				_sso = true;
+				_dma = _e = false;
+				_sso_len = 0;
+				break;
+			case RAW:
+				_sso = false;
+				_dma = true;
+				_e = false;
+				_d = 0;
+				_dma_len = 0;
+				break;
+			case OBJECT:  _o = create<ObjectT<char_t, alloc_t> >();  break;
+			case ARRAY:   _a = create<ArrayT<char_t, alloc_t> >();  break;
+			default:      break;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	ValueT<char_t, alloc_t>::ValueT(const ValueT<char_t, alloc_t>& v)
+		: _type(v._type)
+	{
+		if(this != &v) {
+			switch(_type) {
+				case NIL:     _type = NIL; break;
+				case BOOLEAN: _b = v._b;   break;
+				case INTEGER: _i = v._i;   break;
+				case FLOAT:   _f = v._f;   break;
+				case STRING:
+					_sso = true;
+					_dma = _e = false;
+					_sso_len = 0;
+					assign(v.c_str(), v.length(), v._e, v._dma);
+					break;
+				case RAW:
+					_sso = false;
+					_dma = true;
+					_e = v._e;
+					_d = v._d;
+					_dma_len = v._dma_len;
+					break;
+				case OBJECT:  _o = duplicate(v._o); break;
+				case ARRAY:   _a = duplicate(v._a); break;
+			}
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::assign(const char_t* s, size_t l, int escape, bool dma)
+	{
+		clear(STRING);
+		if(escape == AUTO_DETECT) {
+			escape = DONT_ESCAPE;
+			size_t pos = 0;
+			while(pos < l) {
+				if((escape = detail::check_need_conv<char_t>(s[pos])))
+					break;
+				++pos;
+			}
+		}
+		_e = escape;
+		// prefer sso to dma if possible, no allocation either and not bound to lifetime of s
+		if(l <= detail::json_sso<char_t>::capacity) {
+			if(!_sso && !_dma) destroy(_s);
+			_sso = true;
+			_dma = false;
+			_sso_len = static_cast<unsigned char>(l);
+			memcpy(sso_s(), s, l * sizeof(char_t));
+		}
+		else if(dma && l <= (uint)-1) {
+			if(!_sso && !_dma) destroy(_s);
+			_sso = false;
+			_dma = true;
+			_d = s;
+			_dma_len = l;
+		}
+		else {
+			if(_sso || _dma) {
+				_sso = _dma = false;
+				_s = create<tstring>(s, l);
+			}
+			else {
+				_s->assign(s, l);
+			}
+		}
+	}
+
+#ifdef __XPJSON_SUPPORT_MOVE__
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::assign(tstring&& s, int escape)
+	{
+		if(escape == AUTO_DETECT) {
+			escape = DONT_ESCAPE;
+			size_t pos = 0;
+			while(pos < s.length()) {
+				if((escape = detail::check_need_conv<char_t>(s[pos])))
+					break;
+				++pos;
+			}
+		}
+		if(s.length() <= detail::json_sso<char_t>::capacity) {
+			assign(s.data(), s.length(), escape, false);
+			s.clear();
+			return;
+		}
+		clear(STRING);
+		if(_sso || _dma) {
+			_sso = _dma = false;
+			_s = create<tstring>();
+		}
+		_s->swap(s);
+		_e = escape;
+	}
+#endif
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::assign(const ValueT<char_t, alloc_t>& v)
+	{
+		if(this != &v) {
+			if(v.shared()) {
+				clear();
+				if((_type = v._type) == OBJECT) _o = duplicate(v._o);
+				else _a = duplicate(v._a);
+				return;
+			}
+			clear(static_cast<Type>(v._type));
+			switch(_type) {
+				case NIL:     _type = NIL; break;
+				case BOOLEAN: _b = v._b;   break;
+				case INTEGER: _i = v._i;   break;
+				case FLOAT:   _f = v._f;   break;
+				case STRING:
+					assign(v.c_str(), v.length(), v._e, v._dma);
+					break;
+				case RAW:     _d = v._d; _dma_len = v._dma_len; _e = v._e; break;
+				case OBJECT:  *_o = *v._o; break;
+				case ARRAY:   *_a = *v._a; break;
+			}
+		}
+	}
+
+#ifdef __XPJSON_SUPPORT_MOVE__
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::assign(ValueT<char_t, alloc_t>&& v)
+	{
+		if(this != &v) {
+			clear(static_cast<Type>(v._type));
+			switch(_type) {
+				case NIL:     _type = NIL; break;
+				case BOOLEAN: _b = v._b;   break;
+				case INTEGER: _i = v._i;   break;
+				case FLOAT:   _f = v._f;   break;
+				case STRING:
+					if(!_sso && !_dma && !v._sso && !v._dma) {
+						swap(_s, v._s);
+						_e = v._e;
+					}
+					else {
+						assign(v.c_str(), v.length(), v._e, v._dma);
+					}
+					break;
+				case RAW:     _d = v._d; _dma_len = v._dma_len; _e = v._e; break;
+				case OBJECT:  swap(_o, v._o); break;
+				case ARRAY:   swap(_a, v._a); break;
+			}
+			v.clear();
+		}
+	}
+#endif
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::clear(Type	type /*= NIL*/)
+	{
+		if(_type != type) {
+			switch(_type) {
+				case STRING: if(!_sso && !_dma) destroy(_s); break;
+				case OBJECT: release(_o); break;
+				case ARRAY:  release(_a); break;
+				default: break;
+			}
+			switch(type) {
+				case STRING:
+					_sso = true;
+					_dma = _e = false;
+					_sso_len = 0;
+					break;
+				case RAW:
+					_sso = false;
+					_dma = true;
+					_e = false;
+					_d = 0;
+					_dma_len = 0;
+					break;
+				case OBJECT: _o = create<ObjectT<char_t, alloc_t> >(); break;
+				case ARRAY:  _a = create<ArrayT<char_t, alloc_t> >();  break;
+				default: break;
+			}
+			_type = type;
+		}
+		else {
+			switch(_type) {
+				case STRING:
+					if(!_sso && !_dma) _s->clear();
+					else {_sso = true; _dma = false; _sso_len = 0;}
+					_e = false;
+					break;
+				case OBJECT:
+					if(detail::json_atomic_load(&_o->_refs)) {release(_o); _o = create<ObjectT<char_t, alloc_t> >();}
+					else _o->clear();
+					break;
+				case ARRAY:
+					if(detail::json_atomic_load(&_a->_refs)) {release(_a); _a = create<ArrayT<char_t, alloc_t> >();}
+					else _a->clear();
+					break;
+				default: break;
+			}
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::memory_usage(MemoryUsage& usage, bool in_shared) const
+	{
+		++usage.count[_type];
+		const size_t heap = usage.heap_bytes();
+		const bool shared_root = !in_shared && shared();
+		switch(_type) {
+			case STRING:
+				if(_sso) ++usage.sso_count;
+				else if(_dma) usage.dma_bytes += _dma_len * sizeof(char_t);
+				else usage.string_bytes += sizeof(tstring) + detail::json_string_heap(*_s);
+				break;
+			case RAW:
+				usage.dma_bytes += _dma_len * sizeof(char_t);
+				break;
+			case OBJECT:
+				usage.container_bytes += sizeof(ObjectT<char_t, alloc_t>)
+					+ _o->size() * (sizeof(typename ObjectT<char_t, alloc_t>::value_type) + detail::json_map_node_overhead());
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = _o->begin(); it != _o->end(); ++it) {
+					usage.key_bytes += detail::json_string_heap(it->first);
+					it->second.memory_usage(usage, in_shared || shared_root);
+				}
+				if(const tstring* fragment = _o->fragment()) usage.string_bytes += sizeof(tstring) + detail::json_string_heap(*fragment);
+				break;
+			case ARRAY:
+				usage.container_bytes += sizeof(ArrayT<char_t, alloc_t>) + detail::json_deque_heap<ValueT<char_t, alloc_t> >(_a->size());
+				for(typename ArrayT<char_t, alloc_t>::const_iterator it = _a->begin(); it != _a->end(); ++it) it->memory_usage(usage, in_shared || shared_root);
+				if(const tstring* fragment = _a->fragment()) usage.string_bytes += sizeof(tstring) + detail::json_string_heap(*fragment);
+				break;
+			default: break;
+		}
+		if(shared_root) usage.shared_bytes += usage.heap_bytes() - heap;
+	}
+
+	template<class char_t, class alloc_t>
+	uint64_t ValueT<char_t, alloc_t>::hash() const
+	{
+		switch(type()) {
+			case NIL:     return detail::json_hash_mix(NIL, 0);
+			case BOOLEAN: return detail::json_hash_mix(BOOLEAN, _b);
+			case INTEGER: return detail::json_hash_mix(INTEGER, static_cast<uint64_t>(_i));
+			case FLOAT:   return detail::json_hash_mix(FLOAT, _f == 0 ? 0 : detail::json_bits(_f));
+			case STRING: {
+					detail::json_hasher h(STRING);
+					detail::json_binary_writer<detail::json_hasher> w(h);
+					detail::json_utf8<char_t>::write(w, c_str(), static_cast<size_t>(length()));
+					return h.final();
+				}
+			case OBJECT:  return _o->hash();
+			case ARRAY:   return _a->hash();
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(*this, parsed);
+					return parsed.hash();
+				}
+		}
+		return 0;
+	}
+
+	template<class char_t, class alloc_t>
+	uint64_t ObjectT<char_t, alloc_t>::hash() const
+	{
+		if(cached()) return _hash;
+		// members are combined by sum, which doesn't depend on order
+		uint64_t sum = 0;
+		for(typename ObjectT<char_t, alloc_t>::const_iterator it = this->begin(); it != this->end(); ++it) {
+			detail::json_hasher h(STRING);
+			detail::json_binary_writer<detail::json_hasher> w(h);
+			detail::json_utf8<char_t>::write(w, it->first.data(), it->first.size());
+			sum += detail::json_hash_mix(h.final(), it->second.hash());
+		}
+		return cache(detail::json_hash_mix(OBJECT ^ (static_cast<uint64_t>(this->size()) << 8), sum));
+	}
+
+	template<class char_t, class alloc_t>
+	uint64_t ArrayT<char_t, alloc_t>::hash() const
+	{
+		if(cached()) return _hash;
+		uint64_t h = detail::json_hash_mix(ARRAY, this->size());
+		for(typename ArrayT<char_t, alloc_t>::const_iterator it = this->begin(); it != this->end(); ++it) h = detail::json_hash_mix(h, it->hash());
+		return cache(h);
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::share(bool fragments)
+	{
+		touch();
+		switch(_type) {
+			case OBJECT:
+				if(!detail::json_atomic_load(&_o->_refs)) {
+					for(typename ObjectT<char_t, alloc_t>::iterator it = _o->begin(); it != _o->end(); ++it) it->second.share(fragments);
+					_o->_fragments = fragments;
+					_o->_refs = 1;
+				}
+				break;
+			case ARRAY:
+				if(!detail::json_atomic_load(&_a->_refs)) {
+					for(typename ArrayT<char_t, alloc_t>::iterator it = _a->begin(); it != _a->end(); ++it) it->share(fragments);
+					_a->_fragments = fragments;
+					_a->_refs = 1;
+				}
+				break;
+			default: break;
+		}
+	}
+
+	namespace detail
+	{
+		namespace
+		{
+			template<class char_t, class alloc_t, class T>
+			typename json_enable_if<json_is_arithmetic<T>::value, T>::type
+			internal_type_casting(const JSON::ValueT<char_t, alloc_t>& v, const T& value)
+			{
+				switch(v.type()) {
+					case NIL:     break;
+					case BOOLEAN: return T(v.b());
+					case INTEGER: return T(v.i());
+					case FLOAT:   return T(v.f());
+					case STRING:
+						if(v.length() == detail::boolean_true_length() && !memcmp(v.c_str(), detail::boolean<true, char_t>(), detail::boolean_true_length() * sizeof(char_t)))
+							return T(1);
+						else if(v.length() == detail::boolean_false_length() && !memcmp(v.c_str(), detail::boolean<false, char_t>(), detail::boolean_false_length() * sizeof(char_t)))
+							return T(0);
+						else {
+							// sso & dma strings are not nul terminated
+							const typename ValueT<char_t, alloc_t>::tstring s(v.c_str(), static_cast<size_t>(v.length()));
+							char_t* end = 0;
+							double d = ttod(s.c_str(), &end);
+							JSON_ASSERT_CHECK1(end == s.c_str() + s.length(), "Type-casting error: (%s) to arithmetic.", detail::get_cstr(v.c_str(), v.length()).c_str());
+							return T(d);
+						}
+						JSON_ASSERT_CHECK1(false, "Type-casting error: (%s) to arithmetic.", detail::get_cstr(v.c_str(), v.length()).c_str());
+					default: JSON_ASSERT_CHECK1(false, "Type-casting error: from (%s) type to arithmetic.", get_type_name(v.type()));
+				}
+				return T(value);
+			}
+
+			template<class char_t, class alloc_t, class T>
+			typename json_enable_if<json_is_string<T, char_t>::value, T>::type
+			internal_type_casting(const JSON::ValueT<char_t, alloc_t>& v, const T& value)
+			{
+				switch(v.type()) {
+					case NIL:     break;
+					case BOOLEAN: return T(v.b() ? detail::boolean<true, char_t>() : detail::boolean<false, char_t>());
+					case INTEGER: return to_string<T, int64_t>(v.i());
+					case FLOAT:   return to_string<T, double>(v.f());
+					case STRING:
+					case RAW:     return T(v.c_str(), v.length());
+					default: JSON_ASSERT_CHECK1(false, "Type-casting error: from (%s) type to string.", get_type_name(v.type()));
+				}
+				return T(value);
+			}
+		}
+	}
+
+	template<class char_t, class alloc_t> template<class T>
+	T JSON::ValueT<char_t, alloc_t>::get(const T& default_value) const
+	{
+		return JSON_MOVE((detail::internal_type_casting<char_t, alloc_t, T>(*this, default_value)));
+	}
+
+	template<class char_t, class alloc_t> template<class T>
+	T JSON::ValueT<char_t, alloc_t>::get(const tstring& key, const T& default_value) const
+	{
+		touch();
+		JSON_CHECK_TYPE(_type, OBJECT);
+		typename ObjectT<char_t, alloc_t>::const_iterator it = _o->find(key);
+		if(it != _o->end()) return JSON_MOVE((detail::internal_type_casting<char_t, alloc_t, T>(it->second, default_value)));
+		return T(default_value);
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::write(tstring& out) const
+	{
+		switch(_type) {
+			case NIL:     out += detail::nil_null<char_t>(); break;
+			case INTEGER: detail::to_string(_i, out);        break;
+			case FLOAT:   detail::to_string(_f, out);        break;
+			case OBJECT:  WriterT<char_t, alloc_t>::write(*_o, out);  break;
+			case ARRAY:   WriterT<char_t, alloc_t>::write(*_a, out);  break;
+			case BOOLEAN:
+				out += (_b ? detail::boolean<true, char_t>() : detail::boolean<false, char_t>());
+				break;
+			case STRING:
+				out += '\"';
+				if(_e) detail::encode(c_str(), length(), out);
+				else out.append(c_str(), length());
+				out += '\"';
+				break;
+			case RAW:     out.append(_d, _dma_len);          break;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::to_string(tstring& out) const
+	{
+		touch();
+		if(_type == STRING) out = s();
+		else {out.clear(); write(out);}
+	}
+
+#define case_white_space	case ' ':case '\n':case '\r':case '\t'
+#define case_number_1_9		case '1':case '2':case '3':case '4':case '5':case '6':case '7':case '8':case '9'
+#define case_number_0_9		case '0':case_number_1_9
+#define case_number_ending	case_white_space: case ',':case ']':case '}'
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_string(const char_t* in, size_t len, bool dma)
+	{
+		enum {NONE = 0, NORMAL};
+		unsigned char state = NONE;
+		size_t pos = 0;
+		size_t start = 0;
+		_e = false;
+		while(pos < len) {
+			switch(state) {
+				case NONE:
+					switch(in[pos]) {
+						case '\"': state = NORMAL; start = pos + 1; break;
+						case_white_space:                           break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case NORMAL:
+					switch(in[pos]) {
+						case '\"':
+							if(_e) {
+								tstring decoded;
+								detail::decode(in + start, pos - start, decoded);
+#ifdef __XPJSON_SUPPORT_MOVE__
+								assign(JSON_MOVE(decoded), NEED_ESCAPE);
+#else
+								assign(decoded.data(), decoded.size(), NEED_ESCAPE, false);
+#endif
+							}
+							else {
+								assign(in + start, pos - start, _e, dma);
+							}
+							return pos + 1;
+						default:
+							if(!_e) _e = detail::check_need_conv<char_t>(in[pos]);
+							if(_e && in[pos] == '\\') ++pos;
+							break;
+					}
+					break;
+			}
+			++pos;
+		}
+		JSON_PARSE_CHECK(false);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_number(const char_t* in, size_t len, bool)
+	{
+		enum {NONE = 0,SIGN, ZERO, DIGIT, POINT, DIGIT_FRAC, EXP, EXP_SIGN, DIGIT_EXP};
+		unsigned char state = NONE;
+		size_t pos = 0;
+		size_t start = 0;
+		while(pos < len) {
+			switch(state) {
+				case NONE:
+					switch(in[pos]) {
+						case '-':         state = SIGN;  start = pos; break;
+						case '0':         state = ZERO;  start = pos; break;
+						case_number_1_9:  state = DIGIT; start = pos; break;
+						case_white_space:                             break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case SIGN:
+					switch(in[pos]) {
+						case '0':        state = ZERO;  break;
+						case_number_1_9: state = DIGIT; break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case ZERO:
+					JSON_PARSE_CHECK(in[pos] != '0');
+				case DIGIT:
+					if(!isdigit(in[pos]) || state != DIGIT) {
+						switch(in[pos]) {
+							case '.': state = POINT; break;
+							case_number_ending:      goto GOTO_END;
+							default: JSON_PARSE_CHECK(false);
+						}
+					}
+					break;
+				case POINT:
+					switch(in[pos]) {
+						case_number_0_9: state = DIGIT_FRAC; break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case DIGIT_FRAC:
+					switch(in[pos]) {
+						case_number_0_9:    state = DIGIT_FRAC; break;
+						case 'e': case 'E': state = EXP;        break;
+						case_number_ending:                     goto GOTO_END;
+					}
+					break;
+				case EXP:
+					switch(in[pos]) {
+						case_number_0_9:    state = DIGIT_EXP; break;
+						case '+': case '-': state = EXP_SIGN;  break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case EXP_SIGN:
+					switch(in[pos]) {
+						case_number_0_9: state = DIGIT_EXP; break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case DIGIT_EXP:
+					switch(in[pos]) {
+						case_number_0_9:    break;
+						case_number_ending: goto GOTO_END;
+					}
+					break;
+			}
+			++pos;
+		}
+GOTO_END:
+		char_t* end = 0;
+		switch(state) {
+			case ZERO:
+			case DIGIT:
+				clear(INTEGER);
+				_i = detail::ttoi64<char_t>(in + start, &end);
+				JSON_PARSE_CHECK(end == in + pos);
+				return pos;
+			case DIGIT_FRAC:
+			case DIGIT_EXP:
+				clear(FLOAT);
+				_f = detail::ttod<char_t>(in + start, &end);
+				JSON_PARSE_CHECK(end == in + pos);
+				return pos;
+		}
+		JSON_PARSE_CHECK(false);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_nil(const char_t* in, size_t len, bool)
+	{
+		size_t pos = 0;
+		while(pos < len) {
+			switch(in[pos]) {
+				case 'n':
+					JSON_PARSE_CHECK(len - pos >= detail::nil_null_length());
+					if(! memcmp(in + pos, detail::nil_null<char_t>(), detail::nil_null_length() * sizeof(char_t))) {
+						clear();
+						return pos + detail::nil_null_length();
+					}
+					break;
+				case_white_space: break;
+				default: JSON_PARSE_CHECK(false);
+			}
+			++pos;
+		}
+		JSON_PARSE_CHECK(false);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_boolean(const char_t* in, size_t len, bool)
+	{
+		size_t pos = 0;
+		while(pos < len) {
+			switch(in[pos]) {
+				case 't':
+					JSON_PARSE_CHECK(len - pos >= detail::boolean_true_length());
+					if(!memcmp(in + pos, detail::boolean<true, char_t>(), detail::boolean_true_length() * sizeof(char_t))) {
+						clear(BOOLEAN);
+						_b = true;
+						return pos + detail::boolean_true_length();
+					}
+					break;
+				case 'f':
+					JSON_PARSE_CHECK(len - pos >= detail::boolean_false_length());
+					if(!memcmp(in + pos, detail::boolean<false, char_t>(), detail::boolean_false_length() * sizeof(char_t))) {
+						clear(BOOLEAN);
+						_b = false;
+						return pos + detail::boolean_false_length();
+					}
+					break;
+				case_white_space: break;
+				default: JSON_PARSE_CHECK(false);
+			}
+			++pos;
+		}
+		JSON_PARSE_CHECK(false);
+	}
+
+#define OBJECT_ARRAY_PARSE_END(type) {									\
+		JSON_PARSE_CHECK(pv.back()->_type == type);						\
+		pv.pop_back();													\
+		if(pv.empty()) return pos + 1;/* Object/Array parse finished. */\
+		if(pv.back()->_type == OBJECT) state = OBJECT_PAIR_VALUE;		\
+		else if(pv.back()->_type == ARRAY) state = ARRAY_ELEM;			\
+	}
+
+#define PUSH_VALUE_TO_STACK(type)										\
+	if(pv.back()->_type == NIL) pv.back()->clear(type);					\
+	else {																\
+		pv.back()->_a->push_back(JSON_MOVE((ValueT<char_t, alloc_t>(type))));		\
+		pv.push_back(&pv.back()->_a->back());							\
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read(const char_t* in, size_t len, bool dma/* = true*/)
+	{
+		// Indicate current parse state
+		enum {NONE = 0,
+			OBJECT_LBRACE,          /* { */
+			OBJECT_PAIR_KEY_QUOTE,  /* {"," */
+			OBJECT_PAIR_KEY,        /* "..." */
+			OBJECT_PAIR_COLON,      /* "...": */
+			OBJECT_PAIR_VALUE,      /* "...":"..." */
+			OBJECT_COMMA,           /* {..., */
+			ARRAY_LBRACKET,         /* [ */
+			ARRAY_ELEM,             /* [...[...,... */
+			ARRAY_COMMA             /* [..., */
+		};
+		unsigned char state = NONE;
+		size_t pos = 0;
+		union {
+			size_t start;
+			size_t(ValueT<char_t, alloc_t>::*fp)(const char_t*, size_t, bool);
+		} u;
+		memset(&u, 0, sizeof(u));
+		vector<ValueT<char_t, alloc_t>*, typename detail::json_rebind<alloc_t, ValueT<char_t, alloc_t>*>::type> pv(1, this);
+		while(pos < len) {
+			switch(state) {
+				case NONE:
+					// Topmost value parse.
+					switch(in[pos]) {
+						case '{': state = OBJECT_LBRACE;  clear(OBJECT); break;
+						case '[': state = ARRAY_LBRACKET; clear(ARRAY);  break;
+						case_white_space:                                break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case OBJECT_LBRACE:
+				case OBJECT_COMMA:
+					switch(in[pos]) {
+						case '\"': state = OBJECT_PAIR_KEY_QUOTE; u.start = pos + 1; break;
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+						case '}': OBJECT_ARRAY_PARSE_END(OBJECT) break;
+#else
+						case '}':
+							if(state == OBJECT_LBRACE) OBJECT_ARRAY_PARSE_END(OBJECT)
+							else JSON_PARSE_CHECK(false);
+							break;
+#endif
+						case_white_space: break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case OBJECT_PAIR_KEY_QUOTE:
+					switch(in[pos]) {
+						case '\\':
+							while(++pos < len) {
+								if(in[pos] == '\"' && in[pos - 1] != '\\') {
+									state = OBJECT_PAIR_KEY;
+									tstring key;
+									detail::decode(in + u.start, pos - u.start, key);
+									pv.push_back(&(*pv.back()->_o)[JSON_MOVE(key)]);
+									u.start = 0;
+									break;
+								}
+							}
+							JSON_PARSE_CHECK(state == OBJECT_PAIR_KEY);
+							break;
+						case '\"':
+							state = OBJECT_PAIR_KEY;
+							// Insert a value
+							pv.push_back(&(*pv.back()->_o)[JSON_MOVE(tstring(in + u.start, pos - u.start))]);
+							u.start = 0;
+							break;
+						default: break;
+					}
+					break;
+				case OBJECT_PAIR_KEY:
+					switch(in[pos]) {
+						case ':': state = OBJECT_PAIR_COLON; break;
+						case_white_space:                    break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case OBJECT_PAIR_COLON:
+				case ARRAY_LBRACKET:
+				case ARRAY_COMMA:
+					switch(in[pos]) {
+						case '\"':                 u.fp = &ValueT::read_string;       break;
+						case '-': case_number_0_9: u.fp = &ValueT::read_number;       break;
+						case 't': case 'f':        u.fp = &ValueT::read_boolean;      break;
+						case 'n':                  u.fp = &ValueT::read_nil;          break;
+						case '{': state = OBJECT_LBRACE;  PUSH_VALUE_TO_STACK(OBJECT) break;
+						case '[': state = ARRAY_LBRACKET; PUSH_VALUE_TO_STACK(ARRAY)  break;
+						case ']':
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+							if(state != OBJECT_PAIR_COLON)
+#else
+							if(state == ARRAY_LBRACKET)
+#endif
+							  OBJECT_ARRAY_PARSE_END(ARRAY)
+							else JSON_PARSE_CHECK(false);
+							break;
+						case_white_space: break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					if(u.fp) {
+						// If top elem is array, push a elem.
+						if(pv.back()->_type == ARRAY) {
+							pv.back()->_a->push_back(JSON_MOVE((ValueT<char_t, alloc_t>())));
+							pv.push_back(&pv.back()->_a->back());
+						}
+						// ++pos at last, so minus 1 here.
+						pos += (pv.back()->*u.fp)(in + pos, len - pos, dma) - 1;
+						u.fp = 0;
+						// pop nil/number/boolean/string Value
+						pv.pop_back();
+						JSON_PARSE_CHECK(!pv.empty());
+						switch(pv.back()->_type) {
+							case OBJECT: state = OBJECT_PAIR_VALUE; break;
+							case ARRAY:  state = ARRAY_ELEM;        break;
+							default: JSON_PARSE_CHECK(false);
+						}
+					}
+					break;
+				case OBJECT_PAIR_VALUE:
+					switch(in[pos]) {
+						case '}': OBJECT_ARRAY_PARSE_END(OBJECT)  break;
+						case ',': state = OBJECT_COMMA;           break;
+						case_white_space:                         break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+				case ARRAY_ELEM:
+					switch(in[pos]) {
+						case ']': OBJECT_ARRAY_PARSE_END(ARRAY)  break;
+						case ',': state = ARRAY_COMMA;           break;
+						case_white_space:                        break;
+						default: JSON_PARSE_CHECK(false);
+					}
+					break;
+			}
+			++pos;
+		}
+		JSON_PARSE_CHECK(false);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read(const char_t* in, size_t len, const MaskT<char_t, alloc_t>& mask, bool dma/* = true*/)
+	{
+		if(mask.all()) return read(in, len, dma);
+		size_t pos = 0;
+		while(pos < len) {
+			switch(in[pos]) {
+				case '{': case '[': return pos + read_masked(in + pos, len - pos, mask, dma, mask.raw());
+				case_white_space: break;
+				default: JSON_PARSE_CHECK(false);
+			}
+			++pos;
+		}
+		JSON_PARSE_CHECK(false);
+		return pos;
+	}
+
+#define SKIP_WHITE_SPACE() while(pos < len && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\r' || in[pos] == '\t')) ++pos
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_masked(const char_t* in, size_t len, const MaskT<char_t, alloc_t>& mask, bool dma, bool raw)
+	{
+		const bool object = (in[0] == '{');
+		clear(object ? OBJECT : ARRAY);
+		size_t pos = 1;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		if(in[pos] == (object ? '}' : ']')) return pos + 1;
+		for(size_t index = 0; ; ++index) {
+			const MaskT<char_t, alloc_t>* m = 0;
+			size_t start = 0, end = 0;
+			tstring key;
+			if(object) {
+				JSON_PARSE_CHECK(in[pos] == '\"');
+				start = ++pos;
+				bool escaped = false;
+				while(pos < len && in[pos] != '\"') {
+					if(in[pos] == '\\') {escaped = true; ++pos;}
+					++pos;
+				}
+				JSON_PARSE_CHECK(pos < len);
+				end = pos++;
+				if(escaped) {
+					detail::decode(in + start, end - start, key);
+					m = mask.find(key.data(), key.length());
+				}
+				else m = mask.find(in + start, end - start);
+				SKIP_WHITE_SPACE();
+				JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+				++pos;
+				SKIP_WHITE_SPACE();
+			}
+			else m = mask.find(index);
+			JSON_PARSE_CHECK(pos < len);
+			// containers are descended by mask, scalars are built only if included as a whole
+			const bool build = m && (m->all() || in[pos] == '{' || in[pos] == '[');
+			if(build || raw) {
+				ValueT<char_t, alloc_t>* v = 0;
+				if(object) {
+					if(key.empty()) key.assign(in + start, end - start);
+					v = &(*_o)[JSON_MOVE(key)];
+				}
+				else {
+					_a->resize(index + 1);
+					v = &_a->back();
+				}
+				// raw values reference in, so they're parsed into owned values without dma
+				if(!build && dma) {
+					const size_t l = detail::json_skip(in + pos, len - pos);
+					v->raw(in + pos, l);
+					pos += l;
+				}
+				else switch(in[pos]) {
+					case '\"': pos += v->read_string(in + pos, len - pos, dma); break;
+					case 't': case 'f': pos += v->read_boolean(in + pos, len - pos, dma); break;
+					case 'n': pos += v->read_nil(in + pos, len - pos, dma); break;
+					case '{': case '[': pos += !m || m->all() ? v->read(in + pos, len - pos, dma) : v->read_masked(in + pos, len - pos, *m, dma, raw); break;
+					default: pos += v->read_number(in + pos, len - pos, dma); break;
+				}
+			}
+			else pos += detail::json_skip(in + pos, len - pos);
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] == (object ? '}' : ']')) return pos + 1;
+			JSON_PARSE_CHECK(in[pos] == ',');
+			++pos;
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+			if(in[pos] == (object ? '}' : ']')) return pos + 1;
+#endif
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_merge(const char_t* in, size_t len, bool dma/* = false*/)
+	{
+		size_t pos = 0;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		switch(in[pos]) {
+			case '{':           return pos + read_merge_object(in + pos, len - pos, dma);
+			case '[':           return pos + read(in + pos, len - pos, dma);
+			case '\"':          return pos + read_string(in + pos, len - pos, dma);
+			case 't': case 'f': return pos + read_boolean(in + pos, len - pos, dma);
+			case 'n':           return pos + read_nil(in + pos, len - pos, dma);
+			default:            return pos + read_number(in + pos, len - pos, dma);
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_merge_object(const char_t* in, size_t len, bool dma)
+	{
+		if(type() != OBJECT) clear(OBJECT);
+		ObjectT<char_t, alloc_t>& o = this->o();
+		size_t pos = 1;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		if(in[pos] == '}') return pos + 1;
+		tstring key;
+		for(;;) {
+			JSON_PARSE_CHECK(in[pos] == '\"');
+			const size_t start = ++pos;
+			bool escaped = false;
+			while(pos < len && in[pos] != '\"') {
+				if(in[pos] == '\\') {escaped = true; ++pos;}
+				++pos;
+			}
+			JSON_PARSE_CHECK(pos < len);
+			key.clear();
+			if(escaped) detail::decode(in + start, pos - start, key);
+			else key.assign(in + start, pos - start);
+			++pos;
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+			++pos;
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			// values are parsed straight into their place
+			switch(in[pos]) {
+				case 'n': {
+						ValueT<char_t, alloc_t> nil;
+						pos += nil.read_nil(in + pos, len - pos, dma);
+						o.erase(key);
+					}
+					break;
+				case '{':           pos += o[key].read_merge_object(in + pos, len - pos, dma); break;
+				case '[':           pos += o[key].read(in + pos, len - pos, dma);              break;
+				case '\"':          pos += o[key].read_string(in + pos, len - pos, dma);       break;
+				case 't': case 'f': pos += o[key].read_boolean(in + pos, len - pos, dma);      break;
+				default:            pos += o[key].read_number(in + pos, len - pos, dma);       break;
+			}
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] == '}') return pos + 1;
+			JSON_PARSE_CHECK(in[pos] == ',');
+			++pos;
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+			if(in[pos] == '}') return pos + 1;
+#endif
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t ValueT<char_t, alloc_t>::read_lazy(const char_t* in, size_t len)
+	{
+		size_t pos = 0;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len && (in[pos] == '{' || in[pos] == '['));
+		const size_t end = pos + detail::json_skip(in + pos, len - pos);
+		raw(in + pos, end - pos);
+		_e = true;
+		return end;
+	}
+
+	template<class char_t, class alloc_t>
+	void ValueT<char_t, alloc_t>::materialize() const
+	{
+		// parse one level, children are kept lazy. parsed apart so that errors leave the value lazy
+		ValueT<char_t, alloc_t>& v = const_cast<ValueT<char_t, alloc_t>&>(*this);
+		const char_t* in = _d;
+		const size_t len = _dma_len;
+		size_t pos = 0;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		ValueT<char_t, alloc_t> parsed;
+		switch(in[pos]) {
+			case '{':
+				parsed.read_masked(in + pos, len - pos, MaskT<char_t, alloc_t>(), true, true);
+				for(typename ObjectT<char_t, alloc_t>::iterator it = parsed._o->begin(); it != parsed._o->end(); ++it) it->second._e = true;
+				v.clear(OBJECT);
+				v._o->swap(*parsed._o);
+				return;
+			case '[':
+				parsed.read_masked(in + pos, len - pos, MaskT<char_t, alloc_t>(), true, true);
+				for(typename ArrayT<char_t, alloc_t>::iterator it = parsed._a->begin(); it != parsed._a->end(); ++it) it->_e = true;
+				v.clear(ARRAY);
+				v._a->swap(*parsed._a);
+				return;
+			case '\"':          parsed.read_string(in + pos, len - pos, true);  break;
+			case 't': case 'f': parsed.read_boolean(in + pos, len - pos, true); break;
+			case 'n':           parsed.read_nil(in + pos, len - pos, true);     break;
+			default:            parsed.read_number(in + pos, len - pos, true);  break;
+		}
+		v = parsed;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t DocumentT<char_t, alloc_t>::read_string(const char_t* in, size_t len)
+	{
+		size_t pos = 1;
+		bool escaped = false;
+		for(;;) {
+			pos += detail::json_find_quote(in + pos, len - pos);
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] == '\"') break;
+			escaped = true;
+			pos = std::min(pos + 2, len);
+		}
+		const size_t offset = _strings.size();
+		if(escaped) detail::decode(in + 1, pos - 1, _strings);
+		else _strings.append(in + 1, pos - 1);
+		_tape.push_back(word('\"', offset));
+		_tape.push_back(_strings.size() - offset);
+		_strings += char_t(0);
+		return pos + 1;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t DocumentT<char_t, alloc_t>::read(const char_t* in, size_t len)
+	{
+		clear();
+		// openers of containers in progress
+		vector<size_t, typename detail::json_rebind<alloc_t, size_t>::type> open;
+		vector<size_t, typename detail::json_rebind<alloc_t, size_t>::type> count;
+		ValueT<char_t, alloc_t> scalar;
+		size_t pos = 0;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len && (in[pos] == '{' || in[pos] == '['));
+		for(;;) {
+			char_t closer = 0;
+			if(!open.empty()) {
+				closer = (tag(_tape[open.back()]) == '{') ? '}' : ']';
+				++count.back();
+				if(closer == '}') {
+					JSON_PARSE_CHECK(in[pos] == '\"');
+					pos += read_string(in + pos, len - pos);
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+				}
+			}
+			bool end = false;
+			switch(in[pos]) {
+				case '{': case '[':
+					closer = (in[pos] == '{') ? '}' : ']';
+					open.push_back(_tape.size());
+					count.push_back(0);
+					_tape.push_back(word(in[pos], 0));
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] != closer) continue;
+					end = true;
+					break;
+				case '\"':
+					pos += read_string(in + pos, len - pos);
+					break;
+				case 't': case 'f':
+					pos += scalar.read_boolean(in + pos, len - pos);
+					_tape.push_back(word(scalar._b ? 't' : 'f', 0));
+					break;
+				case 'n':
+					pos += scalar.read_nil(in + pos, len - pos);
+					_tape.push_back(word('n', 0));
+					break;
+				default:
+					pos += scalar.read_number(in + pos, len - pos);
+					if(scalar._type == INTEGER) {
+						_tape.push_back(word('l', 0));
+						_tape.push_back(static_cast<uint64_t>(scalar._i));
+					}
+					else {
+						uint64_t bits;
+						memcpy(&bits, &scalar._f, sizeof(bits));
+						_tape.push_back(word('d', 0));
+						_tape.push_back(bits);
+					}
+					break;
+			}
+			// separators & closers up to the next value
+			for(;;) {
+				if(!end) {
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == ',') {
+						++pos;
+						SKIP_WHITE_SPACE();
+						JSON_PARSE_CHECK(pos < len);
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+						if(in[pos] != closer) break;
+#else
+						break;
+#endif
+					}
+					JSON_PARSE_CHECK(in[pos] == closer);
+				}
+				_tape[open.back()] |= _tape.size() + 1;
+				_tape.push_back(word(closer, count.back()));
+				open.pop_back();
+				count.pop_back();
+				++pos;
+				if(open.empty()) return pos;
+				closer = (tag(_tape[open.back()]) == '{') ? '}' : ']';
+				end = false;
+			}
+		}
+	}
+
+#undef SKIP_WHITE_SPACE
+
+#undef case_white_space
+#undef case_number_1_9
+#undef case_number_0_9
+#undef case_number_ending
+#undef OBJECT_ARRAY_PARSE_END
+#undef PUSH_VALUE_TO_STACK
+
+	template<class char_t, class alloc_t>
+	void WriterT<char_t, alloc_t>::write(const ObjectT<char_t, alloc_t>& o, tstring& out)
+	{
+		if(const tstring* fragment = o.fragment()) {
+			out += *fragment;
+			return;
+		}
+		const size_t start = out.length();
+		out += '{';
+		for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
+			out += '\"';
+			detail::encode(it->first.c_str(), it->first.length(), out);
+			out += '\"';
+			out += ':';
+			it->second.write(out);
+			out += ',';
+		}
+		if(out[out.length() - 1] != '{') out[out.length() - 1] = '}'; else out += '}';
+		if(o._fragments && detail::json_atomic_load(&o._refs)) o.keep(out.data() + start, out.length() - start);
+	}
+
+	template<class char_t, class alloc_t>
+	void WriterT<char_t, alloc_t>::write(const ArrayT<char_t, alloc_t>& a, tstring& out)
+	{
+		if(const tstring* fragment = a.fragment()) {
+			out += *fragment;
+			return;
+		}
+		const size_t start = out.length();
+		out += '[';
+		for(size_t i = 0; i < a.size(); ++i) {
+			a[i].write(out);
+			out += ',';
+		}
+		if(out[out.length() - 1] != '[') out[out.length() - 1] = ']'; else out += ']';
+		if(a._fragments && detail::json_atomic_load(&a._refs)) a.keep(out.data() + start, out.length() - start);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t GatherWriterT<char_t, alloc_t>::length() const
+	{
+		size_t n = 0;
+		for(size_t i = 0; i < _parts.size(); ++i) n += _parts[i].len;
+		return n;
+	}
+
+	template<class char_t, class alloc_t>
+	void GatherWriterT<char_t, alloc_t>::segments(std::vector<segment>& out) const
+	{
+		out.reserve(out.size() + _parts.size());
+		for(size_t i = 0; i < _parts.size(); ++i) out.push_back(segment(data(_parts[i]), _parts[i].len));
+	}
+
+	template<class char_t, class alloc_t>
+	void GatherWriterT<char_t, alloc_t>::value(const ValueT<char_t, alloc_t>& v)
+	{
+		switch(v._type) {
+			case OBJECT:  write(*v._o); break;
+			case ARRAY:   write(*v._a); break;
+			case RAW:     reference(v._d, v._dma_len); break;
+			case STRING:
+				if(!v._e && !v._sso) {
+					_scratch += '\"';
+					reference(v._dma ? v._d : v._s->data(), static_cast<size_t>(v.length()));
+					_scratch += '\"';
+					break;
+				}
+				v.write(_scratch);
+				break;
+			default:      v.write(_scratch); break;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	void GatherWriterT<char_t, alloc_t>::write(const ObjectT<char_t, alloc_t>& o)
+	{
+		const tstring* fragment = o.fragment();
+		if(!fragment && o._fragments && detail::json_atomic_load(&o._refs)) {
+			// written once to be kept, then referenced by every write
+			tstring text;
+			WriterT<char_t, alloc_t>::write(o, text);
+			fragment = o.fragment();
+		}
+		if(fragment) {
+			reference(fragment->data(), fragment->length());
+			return;
+		}
+		_scratch += '{';
+		for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
+			if(it != o.begin()) _scratch += ',';
+			_scratch += '\"';
+			detail::encode(it->first.c_str(), it->first.length(), _scratch);
+			_scratch += '\"';
+			_scratch += ':';
+			value(it->second);
+		}
+		_scratch += '}';
+	}
+
+	template<class char_t, class alloc_t>
+	void GatherWriterT<char_t, alloc_t>::write(const ArrayT<char_t, alloc_t>& a)
+	{
+		const tstring* fragment = a.fragment();
+		if(!fragment && a._fragments && detail::json_atomic_load(&a._refs)) {
+			tstring text;
+			WriterT<char_t, alloc_t>::write(a, text);
+			fragment = a.fragment();
+		}
+		if(fragment) {
+			reference(fragment->data(), fragment->length());
+			return;
+		}
+		_scratch += '[';
+		for(size_t i = 0; i < a.size(); ++i) {
+			if(i) _scratch += ',';
+			value(a[i]);
+		}
+		_scratch += ']';
+	}
+
+	template<class char_t, class alloc_t>
+	void PointerT<char_t, alloc_t>::compile(const char_t* in, size_t len)
+	{
+		_tokens.clear();
+		JSON_ASSERT_CHECK1(!len || in[0] == '/', "Pointer error: in=%.50s.", detail::get_cstr(in, len).c_str());
+		for(size_t pos = 0; pos < len; ++pos) {
+			_tokens.push_back(token(tstring(), size_t(-1)));
+			tstring& key = _tokens.back().first;
+			size_t start = pos + 1;
+			while(++pos < len && in[pos] != '/') {
+				if(in[pos] != '~') continue;
+				key.append(in + start, pos - start);
+				JSON_ASSERT_CHECK1(pos + 1 < len && (in[pos + 1] == '0' || in[pos + 1] == '1'), "Pointer error: in=%.50s.", detail::get_cstr(in, len).c_str());
+				key += (in[++pos] == '0' ? '~' : '/');
+				start = pos + 1;
+			}
+			key.append(in + start, pos - start);
+			// array index: 0 or digits without leading zero
+			if(!key.empty() && key.length() < 20 && (key[0] != '0' || key.length() == 1)) {
+				size_t i = 0, index = 0;
+				while(i < key.length() && key[i] >= '0' && key[i] <= '9') index = index * 10 + (key[i++] - '0');
+				if(i == key.length()) _tokens.back().second = index;
+			}
+			--pos;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	const ValueT<char_t, alloc_t>* PointerT<char_t, alloc_t>::get(const ValueT<char_t, alloc_t>& v) const
+	{
+		const ValueT<char_t, alloc_t>* p = &v;
+		for(size_t i = 0; i < _tokens.size(); ++i) {
+			switch(p->type()) {
+				case OBJECT: {
+						typename ObjectT<char_t, alloc_t>::const_iterator it = p->o().find(_tokens[i].first);
+						if(it == p->o().end()) return 0;
+						p = &it->second;
+					}
+					break;
+				case ARRAY:
+					if(_tokens[i].second >= p->a().size()) return 0;
+					p = &p->a()[_tokens[i].second];
+					break;
+				default: return 0;
+			}
+		}
+		return p;
+	}
+
+	template<class char_t, class alloc_t>
+	ValueT<char_t, alloc_t>* PointerT<char_t, alloc_t>::get(ValueT<char_t, alloc_t>& v) const
+	{
+		// check on const path first, nothing is copied if not found
+		if(!get(static_cast<const ValueT<char_t, alloc_t>&>(v))) return 0;
+		ValueT<char_t, alloc_t>* p = &v;
+		for(size_t i = 0; i < _tokens.size(); ++i) {
+			if(p->type() == OBJECT) p = &p->o().find(_tokens[i].first)->second;
+			else p = &p->a()[_tokens[i].second];
+		}
+		return p;
+	}
+
+	template<class char_t, class alloc_t>
+	MaskT<char_t, alloc_t>& MaskT<char_t, alloc_t>::add(const PointerT<char_t, alloc_t>& p)
+	{
+		MaskT* m = this;
+		for(size_t i = 0; i < p.size() && !m->_all; ++i) {
+			size_t n = 0;
+			while(n < m->_children.size() && m->_children[n]._key != p[i]) ++n;
+			if(n == m->_children.size()) {
+				m->_children.push_back(MaskT());
+				m->_children.back()._key = p[i];
+				m->_children.back()._index = p.index(i);
+			}
+			m = &m->_children[n];
+		}
+		m->_all = true;
+		m->_children.clear();
+		return *this;
+	}
+
+	template<class char_t, class alloc_t>
+	const MaskT<char_t, alloc_t>* MaskT<char_t, alloc_t>::find(const char_t* key, size_t len) const
+	{
+		const MaskT* any = 0;
+		for(size_t n = 0; n < _children.size(); ++n) {
+			const tstring& k = _children[n]._key;
+			if(k.length() == len && !memcmp(k.data(), key, len * sizeof(char_t))) return &_children[n];
+			if(k.length() == 1 && k[0] == '*') any = &_children[n];
+		}
+		return any;
+	}
+
+	template<class char_t, class alloc_t>
+	const MaskT<char_t, alloc_t>* MaskT<char_t, alloc_t>::find(size_t index) const
+	{
+		const MaskT* any = 0;
+		for(size_t n = 0; n < _children.size(); ++n) {
+			if(_children[n]._index == index) return &_children[n];
+			if(_children[n]._key.length() == 1 && _children[n]._key[0] == '*') any = &_children[n];
+		}
+		return any;
+	}
+
+#define JSON_PATH_CHECK(expression) JSON_ASSERT_CHECK2(expression, "Path error: in=%.50s pos=%zu.", detail::get_cstr(in, len).c_str(), pos)
+#define JSON_PATH_SKIP_WHITE_SPACE() while(pos < len && (in[pos] == ' ' || in[pos] == '\t')) ++pos
+
+	template<class char_t, class alloc_t>
+	void PathT<char_t, alloc_t>::compile(const char_t* in, size_t len)
+	{
+		_steps.clear();
+		size_t pos = 0;
+		JSON_PATH_CHECK(len && in[0] == '$');
+		++pos;
+		while(pos < len) {
+			_steps.push_back(step());
+			step& s = _steps.back();
+			if(in[pos] == '.') {
+				if(++pos < len && in[pos] == '.') {
+					s.recursive = true;
+					++pos;
+				}
+				JSON_PATH_CHECK(pos < len);
+				if(in[pos] == '[') pos = parse_bracket(in, len, pos, s);
+				else if(in[pos] == '*') {
+					s.kind = WILDCARD;
+					++pos;
+				}
+				else {
+					const size_t start = pos;
+					while(pos < len && in[pos] != '.' && in[pos] != '[') ++pos;
+					JSON_PATH_CHECK(pos > start);
+					s.names.push_back(tstring(in + start, pos - start));
+				}
+			}
+			else {
+				JSON_PATH_CHECK(in[pos] == '[');
+				pos = parse_bracket(in, len, pos, s);
+			}
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t PathT<char_t, alloc_t>::parse_bracket(const char_t* in, size_t len, size_t pos, step& s)
+	{
+		++pos;
+		JSON_PATH_SKIP_WHITE_SPACE();
+		JSON_PATH_CHECK(pos < len);
+		if(in[pos] == '*') {
+			s.kind = WILDCARD;
+			++pos;
+		}
+		else if(in[pos] == '?') {
+			s.kind = FILTER;
+			JSON_PATH_CHECK(++pos < len && in[pos] == '(');
+			++pos;
+			JSON_PATH_SKIP_WHITE_SPACE();
+			JSON_PATH_CHECK(pos < len && in[pos] == '@');
+			++pos;
+			while(pos < len && in[pos] == '.') {
+				const size_t start = ++pos;
+				while(pos < len && in[pos] != '.' && in[pos] != ' ' && in[pos] != ')' && in[pos] != '=' && in[pos] != '!' && in[pos] != '<' && in[pos] != '>') ++pos;
+				JSON_PATH_CHECK(pos > start);
+				s.rel.push_back(tstring(in + start, pos - start));
+			}
+			JSON_PATH_SKIP_WHITE_SPACE();
+			JSON_PATH_CHECK(pos < len);
+			if(in[pos] != ')') {
+				switch(in[pos]) {
+					case '=': s.op = EQ; JSON_PATH_CHECK(++pos < len && in[pos] == '='); break;
+					case '!': s.op = NE; JSON_PATH_CHECK(++pos < len && in[pos] == '='); break;
+					case '<': s.op = LT; if(pos + 1 < len && in[pos + 1] == '=') {s.op = LE; ++pos;} break;
+					case '>': s.op = GT; if(pos + 1 < len && in[pos + 1] == '=') {s.op = GE; ++pos;} break;
+					default: JSON_PATH_CHECK(false);
+				}
+				++pos;
+				JSON_PATH_SKIP_WHITE_SPACE();
+				pos = parse_literal(in, len, pos, s.literal);
+				JSON_PATH_SKIP_WHITE_SPACE();
+				JSON_PATH_CHECK(pos < len && in[pos] == ')');
+			}
+			++pos;
+		}
+		else if(in[pos] == '\'' || in[pos] == '\"') {
+			for(;;) {
+				s.names.push_back(tstring());
+				pos = parse_quoted(in, len, pos, s.names.back());
+				JSON_PATH_SKIP_WHITE_SPACE();
+				if(pos >= len || in[pos] != ',') break;
+				++pos;
+				JSON_PATH_SKIP_WHITE_SPACE();
+			}
+		}
+		else {
+			// [i,j,...] or [start:end:stride]
+			int64_t n[3] = {0, 0, 1};
+			bool has[3] = {false, false, false};
+			size_t colons = 0;
+			for(;;) {
+				JSON_PATH_SKIP_WHITE_SPACE();
+				const size_t start = pos;
+				if(pos < len && in[pos] == '-') ++pos;
+				while(pos < len && in[pos] >= '0' && in[pos] <= '9') ++pos;
+				if(pos > start) {
+					JSON_PATH_CHECK(pos > start + 1 || in[start] != '-');
+					tstring digits(in + start, pos - start);
+					n[colons] = detail::ttoi64<char_t>(digits.c_str(), 0);
+					has[colons] = true;
+				}
+				JSON_PATH_SKIP_WHITE_SPACE();
+				JSON_PATH_CHECK(pos < len);
+				if(in[pos] == ':') {
+					JSON_PATH_CHECK(s.indexes.empty() && ++colons < 3);
+					s.kind = SLICE;
+				}
+				else if(in[pos] == ',') {
+					JSON_PATH_CHECK(s.kind != SLICE && has[0]);
+					s.indexes.push_back(n[0]);
+					has[0] = false;
+				}
+				else break;
+				++pos;
+			}
+			if(s.kind == SLICE) {
+				JSON_PATH_CHECK(!has[2] || n[2] != 0);
+				s.start = n[0]; s.has_start = has[0];
+				s.end = n[1]; s.has_end = has[1];
+				s.stride = n[2];
+			}
+			else {
+				JSON_PATH_CHECK(has[0]);
+				s.kind = INDEX;
+				s.indexes.push_back(n[0]);
+			}
+		}
+		JSON_PATH_SKIP_WHITE_SPACE();
+		JSON_PATH_CHECK(pos < len && in[pos] == ']');
+		return pos + 1;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t PathT<char_t, alloc_t>::parse_quoted(const char_t* in, size_t len, size_t pos, tstring& out)
+	{
+		const char_t quote = in[pos];
+		size_t start = ++pos;
+		while(pos < len && in[pos] != quote) {
+			if(in[pos] == '\\') {
+				out.append(in + start, pos - start);
+				JSON_PATH_CHECK(++pos < len);
+				start = pos;
+			}
+			++pos;
+		}
+		JSON_PATH_CHECK(pos < len);
+		out.append(in + start, pos - start);
+		return pos + 1;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t PathT<char_t, alloc_t>::parse_literal(const char_t* in, size_t len, size_t pos, ValueT<char_t, alloc_t>& out)
+	{
+		JSON_PATH_CHECK(pos < len);
+		if(in[pos] == '\'' || in[pos] == '\"') {
+			tstring s;
+			pos = parse_quoted(in, len, pos, s);
+			out.assign(s.data(), s.length(), AUTO_DETECT, false);
+			return pos;
+		}
+		const size_t start = pos;
+		while(pos < len && in[pos] != ' ' && in[pos] != '\t' && in[pos] != ')') ++pos;
+		const tstring token(in + start, pos - start);
+		if(token.length() == detail::boolean_true_length() && !memcmp(token.c_str(), detail::boolean<true, char_t>(), detail::boolean_true_length() * sizeof(char_t))) out = true;
+		else if(token.length() == detail::boolean_false_length() && !memcmp(token.c_str(), detail::boolean<false, char_t>(), detail::boolean_false_length() * sizeof(char_t))) out = false;
+		else if(token.length() == detail::nil_null_length() && !memcmp(token.c_str(), detail::nil_null<char_t>(), detail::nil_null_length() * sizeof(char_t))) out.clear();
+		else {
+			JSON_PATH_CHECK(!token.empty());
+			char_t* end = 0;
+			if(token.find('.') == tstring::npos && token.find('e') == tstring::npos && token.find('E') == tstring::npos)
+				out = detail::ttoi64<char_t>(token.c_str(), &end);
+			else
+				out = detail::ttod<char_t>(token.c_str(), &end);
+			JSON_PATH_CHECK(end == token.c_str() + token.length());
+		}
+		return pos;
+	}
+
+#undef JSON_PATH_SKIP_WHITE_SPACE
+#undef JSON_PATH_CHECK
+
+	template<class char_t, class alloc_t>
+	size_t PathT<char_t, alloc_t>::select(const ValueT<char_t, alloc_t>& v, vector<const ValueT<char_t, alloc_t>*>& out, size_t limit/* = size_t(-1)*/) const
+	{
+		context ctx = {&out, 0, 0, limit};
+		if(limit) match(0, v, ctx);
+		return ctx.count;
+	}
+
+	template<class char_t, class alloc_t>
+	const ValueT<char_t, alloc_t>* PathT<char_t, alloc_t>::first(const ValueT<char_t, alloc_t>& v) const
+	{
+		context ctx = {0, 0, 0, 1};
+		match(0, v, ctx);
+		return ctx.found;
+	}
+
+	template<class char_t, class alloc_t>
+	bool PathT<char_t, alloc_t>::match(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const
+	{
+		if(i == _steps.size()) {
+			if(ctx.out) ctx.out->push_back(&v);
+			else ctx.found = &v;
+			return ++ctx.count < ctx.limit;
+		}
+		return _steps[i].recursive ? descend(i, v, ctx) : apply(i, v, ctx);
+	}
+
+	template<class char_t, class alloc_t>
+	bool PathT<char_t, alloc_t>::descend(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const
+	{
+		if(!apply(i, v, ctx)) return false;
+		switch(v.type()) {
+			case OBJECT:
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it)
+					if(!descend(i, it->second, ctx)) return false;
+				break;
+			case ARRAY:
+				for(typename ArrayT<char_t, alloc_t>::const_iterator it = v.a().begin(); it != v.a().end(); ++it)
+					if(!descend(i, *it, ctx)) return false;
+				break;
+			default: break;
+		}
+		return true;
+	}
+
+	template<class char_t, class alloc_t>
+	bool PathT<char_t, alloc_t>::apply(size_t i, const ValueT<char_t, alloc_t>& v, context& ctx) const
+	{
+		const step& s = _steps[i];
+		if(v.type() == OBJECT) {
+			const ObjectT<char_t, alloc_t>& o = v.o();
+			switch(s.kind) {
+				case NAME:
+					for(size_t n = 0; n < s.names.size(); ++n) {
+						typename ObjectT<char_t, alloc_t>::const_iterator it = o.find(s.names[n]);
+						if(it != o.end() && !match(i + 1, it->second, ctx)) return false;
+					}
+					break;
+				case WILDCARD:
+				case FILTER:
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it)
+						if((s.kind == WILDCARD || test(s, it->second)) && !match(i + 1, it->second, ctx)) return false;
+					break;
+				default: break;
+			}
+		}
+		else if(v.type() == ARRAY) {
+			const ArrayT<char_t, alloc_t>& a = v.a();
+			const int64_t size = static_cast<int64_t>(a.size());
+			switch(s.kind) {
+				case INDEX:
+					for(size_t n = 0; n < s.indexes.size(); ++n) {
+						const int64_t index = s.indexes[n] < 0 ? s.indexes[n] + size : s.indexes[n];
+						if(index >= 0 && index < size && !match(i + 1, a[static_cast<size_t>(index)], ctx)) return false;
+					}
+					break;
+				case SLICE: {
+						// same as python
+						int64_t start = s.start < 0 ? s.start + size : s.start;
+						int64_t end = s.end < 0 ? s.end + size : s.end;
+						if(s.stride > 0) {
+							start = s.has_start ? std::min(std::max<int64_t>(start, 0), size) : 0;
+							end = s.has_end ? std::min(std::max<int64_t>(end, 0), size) : size;
+							for(int64_t n = start; n < end; n += s.stride)
+								if(!match(i + 1, a[static_cast<size_t>(n)], ctx)) return false;
+						}
+						else {
+							start = s.has_start ? std::min(std::max<int64_t>(start, -1), size - 1) : size - 1;
+							end = s.has_end ? std::min(std::max<int64_t>(end, -1), size - 1) : -1;
+							for(int64_t n = start; n > end; n += s.stride)
+								if(!match(i + 1, a[static_cast<size_t>(n)], ctx)) return false;
+						}
+					}
+					break;
+				case WILDCARD:
+				case FILTER:
+					for(typename ArrayT<char_t, alloc_t>::const_iterator it = a.begin(); it != a.end(); ++it)
+						if((s.kind == WILDCARD || test(s, *it)) && !match(i + 1, *it, ctx)) return false;
+					break;
+				default: break;
+			}
+		}
+		return true;
+	}
+
+	template<class char_t, class alloc_t>
+	bool PathT<char_t, alloc_t>::test(const step& s, const ValueT<char_t, alloc_t>& v) const
+	{
+		const ValueT<char_t, alloc_t>* p = &v;
+		for(size_t n = 0; n < s.rel.size(); ++n) {
+			if(p->type() != OBJECT) return false;
+			typename ObjectT<char_t, alloc_t>::const_iterator it = p->o().find(s.rel[n]);
+			if(it == p->o().end()) return false;
+			p = &it->second;
+		}
+		if(s.op == EXISTS) return true;
+		const ValueT<char_t, alloc_t>& l = s.literal;
+		int cmp = 0;
+		bool ordered = true;
+		if((p->type() == INTEGER || p->type() == FLOAT) && (l.type() == INTEGER || l.type() == FLOAT)) {
+			if(p->type() == INTEGER && l.type() == INTEGER) cmp = p->i() < l.i() ? -1 : p->i() > l.i();
+			else {
+				const long double x = p->type() == INTEGER ? p->i() : p->f();
+				const long double y = l.type() == INTEGER ? l.i() : l.f();
+				cmp = x < y ? -1 : x > y;
+			}
+		}
+		else if(p->type() == STRING && l.type() == STRING) {
+			cmp = char_traits<char_t>::compare(p->c_str(), l.c_str(), std::min(p->length(), l.length()));
+			if(!cmp) cmp = p->length() < l.length() ? -1 : p->length() > l.length();
+		}
+		else if(p->type() == l.type()) {
+			cmp = !(*p == l);
+			ordered = false;
+		}
+		else return s.op == NE;
+		switch(s.op) {
+			case EQ: return !cmp;
+			case NE: return cmp != 0;
+			case LT: return ordered && cmp < 0;
+			case LE: return ordered && cmp <= 0;
+			case GT: return ordered && cmp > 0;
+			case GE: return ordered && cmp >= 0;
+		}
+		return false;
+	}
+
+	template<class char_t, class alloc_t>
+	Type CursorT<char_t, alloc_t>::type() const
+	{
+		JSON_ASSERT_CHECK(_tape, std::logic_error, "Invalid cursor.");
+		switch(tag(_pos)) {
+			case 't': case 'f': return BOOLEAN;
+			case 'l':           return INTEGER;
+			case 'd':           return FLOAT;
+			case '\"':          return STRING;
+			case '{':           return OBJECT;
+			case '[':           return ARRAY;
+		}
+		return NIL;
+	}
+
+	template<class char_t, class alloc_t>
+	bool CursorT<char_t, alloc_t>::b() const
+	{
+		JSON_CHECK_TYPE(type(), BOOLEAN);
+		return tag(_pos) == 't';
+	}
+
+	template<class char_t, class alloc_t>
+	int64_t CursorT<char_t, alloc_t>::i() const
+	{
+		JSON_CHECK_TYPE(type(), INTEGER);
+		return static_cast<int64_t>(_tape[_pos + 1]);
+	}
+
+	template<class char_t, class alloc_t>
+	double CursorT<char_t, alloc_t>::f() const
+	{
+		JSON_CHECK_TYPE(type(), FLOAT);
+		double f;
+		memcpy(&f, &_tape[_pos + 1], sizeof(f));
+		return f;
+	}
+
+	template<class char_t, class alloc_t>
+	const char_t* CursorT<char_t, alloc_t>::c_str() const
+	{
+		JSON_CHECK_TYPE(type(), STRING);
+		return _strings + payload(_pos);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t CursorT<char_t, alloc_t>::length() const
+	{
+		JSON_CHECK_TYPE(type(), STRING);
+		return static_cast<size_t>(_tape[_pos + 1]);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t CursorT<char_t, alloc_t>::size() const
+	{
+		if(type() != ARRAY) JSON_CHECK_TYPE(type(), OBJECT);
+		return static_cast<size_t>(payload(static_cast<size_t>(payload(_pos)) - 1));
+	}
+
+	template<class char_t, class alloc_t>
+	CursorT<char_t, alloc_t> CursorT<char_t, alloc_t>::begin() const
+	{
+		if(type() != ARRAY) JSON_CHECK_TYPE(type(), OBJECT);
+		const bool object = (tag(_pos) == '{');
+		return CursorT(_tape, _strings, (object && tag(_pos + 1) != '}') ? _pos + 3 : _pos + 1, object);
+	}
+
+	template<class char_t, class alloc_t>
+	CursorT<char_t, alloc_t> CursorT<char_t, alloc_t>::end() const
+	{
+		if(type() != ARRAY) JSON_CHECK_TYPE(type(), OBJECT);
+		return CursorT(_tape, _strings, static_cast<size_t>(payload(_pos)) - 1, tag(_pos) == '{');
+	}
+
+	template<class char_t, class alloc_t>
+	CursorT<char_t, alloc_t>& CursorT<char_t, alloc_t>::operator++()
+	{
+		switch(tag(_pos)) {
+			case '{': case '[':           _pos = static_cast<size_t>(payload(_pos)); break;
+			case '\"': case 'l': case 'd': _pos += 2;                                break;
+			default:                      ++_pos;                                   break;
+		}
+		// skip key of next member
+		if(_member && tag(_pos) != '}') _pos += 2;
+		return *this;
+	}
+
+	template<class char_t, class alloc_t>
+	CursorT<char_t, alloc_t> CursorT<char_t, alloc_t>::find(const char_t* key, size_t len) const
+	{
+		JSON_CHECK_TYPE(type(), OBJECT);
+		const CursorT last = end();
+		for(CursorT it = begin(); it != last; ++it) {
+			const size_t k = it._pos - 2;
+			if(_tape[k + 1] == len && !memcmp(_strings + payload(k), key, len * sizeof(char_t))) return it;
+		}
+		return CursorT();
+	}
+
+	template<class char_t, class alloc_t>
+	void CursorT<char_t, alloc_t>::to_value(ValueT<char_t, alloc_t>& out) const
+	{
+		switch(type()) {
+			case BOOLEAN: out = b();                                    break;
+			case INTEGER: out = i();                                    break;
+			case FLOAT:   out = f();                                    break;
+			case STRING:  out.assign(c_str(), length(), AUTO_DETECT, false); break;
+			case OBJECT: {
+					out.clear(OBJECT);
+					ObjectT<char_t, alloc_t>& o = out.o();
+					const CursorT last = end();
+					for(CursorT it = begin(); it != last; ++it) it.to_value(o[it.key().s()]);
+				}
+				break;
+			case ARRAY: {
+					out.clear(ARRAY);
+					ArrayT<char_t, alloc_t>& a = out.a();
+					a.resize(size());
+					size_t i = 0;
+					const CursorT last = end();
+					for(CursorT it = begin(); it != last; ++it) it.to_value(a[i++]);
+				}
+				break;
+			default:      out.clear();                                  break;
+		}
+	}
 
-namespace JSON
-{
-	const char* get_type_name(int type)
+	template<class char_t, class alloc_t>
+	void DocumentT<char_t, alloc_t>::assign(const ValueT<char_t, alloc_t>& v)
 	{
-		switch(type) {
-			case NIL:     return "Null";
-			case BOOLEAN: return "Boolean";
-			case INTEGER: return "Integer";
-			case FLOAT:   return "Floating";
-			case STRING:  return "String";
-			case OBJECT:  return "Object";
-			case ARRAY:   return "Array";
+		clear();
+		string_table table;
+		build(v, table);
+	}
+
+	template<class char_t, class alloc_t>
+	void DocumentT<char_t, alloc_t>::build_string(const char_t* s, size_t len, string_table& table)
+	{
+		typename string_table::iterator it = table.find(tstring(s, len));
+		if(it == table.end()) {
+			it = table.insert(typename string_table::value_type(tstring(s, len), _strings.size())).first;
+			_strings.append(s, len);
+			_strings += char_t(0);
 		}
-		return "Unknown";
+		_tape.push_back(word('\"', it->second));
+		_tape.push_back(len);
 	}
 
-	template<class char_t>
-	ValueT<char_t>::ValueT(Type type)
-		: _type(type)
+	template<class char_t, class alloc_t>
+	void DocumentT<char_t, alloc_t>::build(const ValueT<char_t, alloc_t>& v, string_table& table)
 	{
-		switch(_type) {
-			case BOOLEAN: _b = false; break;
-			case INTEGER: _i = 0;     break;
-			case FLOAT:   _f = 0;     break;
-			case STRING:
-				_sso = true;
-				_sso_len = 0;
+		switch(v.type()) {
+			case NIL:     _tape.push_back(word('n', 0));              break;
+			case BOOLEAN: _tape.push_back(word(v.b() ? 't' : 'f', 0)); break;
+			case INTEGER:
+				_tape.push_back(word('l', 0));
+				_tape.push_back(static_cast<uint64_t>(v.i()));
+				break;
+			case FLOAT: {
+					const double f = v.f();
+					uint64_t bits;
+					memcpy(&bits, &f, sizeof(bits));
+					_tape.push_back(word('d', 0));
+					_tape.push_back(bits);
+				}
+				break;
+			case STRING: build_string(v.c_str(), static_cast<size_t>(v.length()), table); break;
+			case OBJECT: {
+					const size_t open = _tape.size();
+					_tape.push_back(word('{', 0));
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+						build_string(it->first.data(), it->first.size(), table);
+						build(it->second, table);
+					}
+					_tape[open] |= _tape.size() + 1;
+					_tape.push_back(word('}', v.o().size()));
+				}
+				break;
+			case ARRAY: {
+					const size_t open = _tape.size();
+					_tape.push_back(word('[', 0));
+					for(size_t i = 0; i < v.a().size(); ++i) build(v.a()[i], table);
+					_tape[open] |= _tape.size() + 1;
+					_tape.push_back(word(']', v.a().size()));
+				}
+				break;
+			case RAW: {
+					// unparsed text, parsed as a lazy value
+					ValueT<char_t, alloc_t> parsed;
+					parsed.raw(v.c_str(), static_cast<size_t>(v.length()));
+					parsed._e = true;
+					build(parsed, table);
+				}
 				break;
-			case OBJECT:  _o = new ObjectT<char_t>;  break;
-			case ARRAY:   _a = new ArrayT<char_t>;  break;
-			default:      break;
 		}
 	}
 
-	template<class char_t>
-	ValueT<char_t>::ValueT(const ValueT<char_t>& v)
-		: _type(v._type)
+	template<class char_t, class alloc_t>
+	void DocumentT<char_t, alloc_t>::save(std::string& out) const
 	{
-		if(this != &v) {
-			switch(_type) {
-				case NIL:     _type = NIL; break;
-				case BOOLEAN: _b = v._b;   break;
-				case INTEGER: _i = v._i;   break;
-				case FLOAT:   _f = v._f;   break;
-				case STRING:
-					_sso = true;
-					_sso_len = 0;
-					assign(v.c_str(), v.length(), v._e, v._dma);
-					break;
-				case OBJECT:  _o = new ObjectT<char_t>(*v._o); break;
-				case ARRAY:   _a = new ArrayT<char_t>(*v._a); break;
-			}
-		}
+		JSON_ASSERT_CHECK(!empty(), std::logic_error, "Snapshot error: empty document.");
+		detail::json_snapshot h;
+		memcpy(h.magic, "XPJS", 4);
+		h.order = 0x01020304;
+		h.version = 1;
+		h.char_size = sizeof(char_t);
+		h.words = _tape.size();
+		h.chars = _strings.size();
+		out.reserve(out.size() + sizeof(h) + _tape.size() * sizeof(uint64_t) + _strings.size() * sizeof(char_t));
+		out.append(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.append(reinterpret_cast<const char*>(&_tape[0]), _tape.size() * sizeof(uint64_t));
+		out.append(reinterpret_cast<const char*>(_strings.data()), _strings.size() * sizeof(char_t));
 	}
 
-	template<class char_t>
-	void ValueT<char_t>::assign(const char_t* s, size_t l, int escape, bool dma)
+	template<class char_t, class alloc_t>
+	void DocumentT<char_t, alloc_t>::load(const void* data, size_t size)
 	{
-		clear(STRING);
-		if(escape == AUTO_DETECT) {
-			escape = DONT_ESCAPE;
-			size_t pos = 0;
-			while(pos < l) {
-				if((escape = detail::check_need_conv<char_t>(s[pos])))
-					break;
-				++pos;
-			}
+		const detail::json_snapshot* h = detail::json_snapshot::check(data, size, sizeof(char_t));
+		const uint64_t* tape = reinterpret_cast<const uint64_t*>(h + 1);
+		_tape.assign(tape, tape + h->words);
+		_strings.assign(reinterpret_cast<const char_t*>(tape + h->words), static_cast<size_t>(h->chars));
+	}
+
+	template<class char_t, class alloc_t>
+	size_t MsgPackT<char_t, alloc_t>::size(const ValueT<char_t, alloc_t>& v)
+	{
+		switch(v.type()) {
+			case NIL:
+			case BOOLEAN: return 1;
+			case INTEGER: {
+					const int64_t i = v.i();
+					if(i >= 0) return i < 0x80 ? 1 : i < 0x100 ? 2 : i < 0x10000 ? 3 : i <= 0xFFFFFFFFLL ? 5 : 9;
+					return i >= -32 ? 1 : i >= -0x80 ? 2 : i >= -0x8000 ? 3 : i >= -0x80000000LL ? 5 : 9;
+				}
+			case FLOAT: {
+					const double f = v.f();
+					return (fabs(f) <= FLT_MAX && static_cast<double>(static_cast<float>(f)) == f) ? 5 : 9;
+				}
+			case STRING: {
+					const size_t n = detail::json_utf8<char_t>::size(v.c_str(), static_cast<size_t>(v.length()));
+					return header_size(n, 32) + n;
+				}
+			case OBJECT: {
+					size_t bytes = header_size(v.o().size(), 16);
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+						const size_t n = detail::json_utf8<char_t>::size(it->first.data(), it->first.size());
+						bytes += header_size(n, 32) + n + size(it->second);
+					}
+					return bytes;
+				}
+			case ARRAY: {
+					size_t bytes = header_size(v.a().size(), 16);
+					for(size_t i = 0; i < v.a().size(); ++i) bytes += size(v.a()[i]);
+					return bytes;
+				}
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					return size(parsed);
+				}
 		}
-		if((_e = escape)) {
-			if(_sso || _dma) {
-				_sso = _dma = false;
-				_s = new tstring(s, l);
-			}
-			else {
-				_s->assign(s, l);
-			}
+		return 0;
+	}
+
+	template<class char_t, class alloc_t> template<class sink_t>
+	void MsgPackT<char_t, alloc_t>::header(detail::json_binary_writer<sink_t>& w, size_t n, unsigned int fix, unsigned int code8, unsigned int code16, unsigned int code32)
+	{
+		// fixstr has 5 bits of length and str 8, fixmap & fixarray have 4 bits and no 8 bits form
+		const size_t limit = code8 ? 32 : 16;
+		if(n < limit) w.byte(fix | static_cast<unsigned int>(n));
+		else if(code8 && n < 0x100) {w.byte(code8); w.be(n, 1);}
+		else if(n < 0x10000) {w.byte(code16); w.be(n, 2);}
+		else {
+			JSON_ASSERT_CHECK(n <= 0xFFFFFFFFULL, std::length_error, "MessagePack error: length overflow.");
+			w.byte(code32);
+			w.be(n, 4);
 		}
-		else if(dma && l <= (uint)-1) {
-			if(!_sso && !_dma) delete _s;
-			_sso = false;
-			_dma = true;
-			_d = s;
-			_dma_len = l;
+	}
+
+	template<class char_t, class alloc_t> template<class sink_t>
+	void MsgPackT<char_t, alloc_t>::encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w)
+	{
+		switch(v.type()) {
+			case NIL:     w.byte(0xC0);                break;
+			case BOOLEAN: w.byte(v.b() ? 0xC3 : 0xC2); break;
+			case INTEGER: {
+					const int64_t i = v.i();
+					const uint64_t u = static_cast<uint64_t>(i);
+					if(i >= 0) {
+						if(i < 0x80) w.byte(static_cast<unsigned int>(i));
+						else if(i < 0x100) {w.byte(0xCC); w.be(u, 1);}
+						else if(i < 0x10000) {w.byte(0xCD); w.be(u, 2);}
+						else if(i <= 0xFFFFFFFFLL) {w.byte(0xCE); w.be(u, 4);}
+						else {w.byte(0xCF); w.be(u, 8);}
+					}
+					else {
+						if(i >= -32) w.byte(static_cast<unsigned int>(u & 0xFF));
+						else if(i >= -0x80) {w.byte(0xD0); w.be(u, 1);}
+						else if(i >= -0x8000) {w.byte(0xD1); w.be(u, 2);}
+						else if(i >= -0x80000000LL) {w.byte(0xD2); w.be(u, 4);}
+						else {w.byte(0xD3); w.be(u, 8);}
+					}
+				}
+				break;
+			case FLOAT: {
+					const double f = v.f();
+					if(fabs(f) <= FLT_MAX && static_cast<double>(static_cast<float>(f)) == f) {w.byte(0xCA); w.be(detail::json_bits(static_cast<float>(f)), 4);}
+					else {w.byte(0xCB); w.be(detail::json_bits(f), 8);}
+				}
+				break;
+			case STRING: {
+					const size_t n = static_cast<size_t>(v.length());
+					header(w, detail::json_utf8<char_t>::size(v.c_str(), n), 0xA0, 0xD9, 0xDA, 0xDB);
+					detail::json_utf8<char_t>::write(w, v.c_str(), n);
+				}
+				break;
+			case OBJECT:
+				header(w, v.o().size(), 0x80, 0, 0xDE, 0xDF);
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+					header(w, detail::json_utf8<char_t>::size(it->first.data(), it->first.size()), 0xA0, 0xD9, 0xDA, 0xDB);
+					detail::json_utf8<char_t>::write(w, it->first.data(), it->first.size());
+					encode(it->second, w);
+				}
+				break;
+			case ARRAY:
+				header(w, v.a().size(), 0x90, 0, 0xDC, 0xDD);
+				for(size_t i = 0; i < v.a().size(); ++i) encode(v.a()[i], w);
+				break;
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					encode(parsed, w);
+				}
+				break;
 		}
-		else if(l <= (15 / sizeof(char_t))) {
-			if(!_sso && !_dma) delete _s;
-			_sso = true;
-			_sso_len = l;
-			memcpy(_sso_s, s, l * sizeof(char_t));
+	}
+
+	template<class char_t, class alloc_t>
+	size_t MsgPackT<char_t, alloc_t>::read_length(detail::json_binary_reader& r, unsigned int b)
+	{
+		switch(b) {
+			case 0xC4: case 0xD9:            return static_cast<size_t>(r.be(1));
+			case 0xC5: case 0xDA: case 0xDC: case 0xDE: return static_cast<size_t>(r.be(2));
+			case 0xC6: case 0xDB: case 0xDD: case 0xDF: return static_cast<size_t>(r.be(4));
 		}
-		else {
-			if(_sso || _dma) {
-				_sso = _dma = false;
-				_s = new tstring(s, l);
-			}
-			else {
-				_s->assign(s, l);
-			}
+		// fixstr, fixarray, fixmap
+		return b & ((b & 0xE0) == 0xA0 ? 0x1F : 0x0F);
+	}
+
+	template<class char_t, class alloc_t>
+	void MsgPackT<char_t, alloc_t>::decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, bool dma)
+	{
+		const unsigned int b = r.byte();
+		if(b < 0x80) {v = static_cast<int64_t>(b); return;}
+		if(b >= 0xE0) {v = static_cast<int64_t>(b) - 0x100; return;}
+		switch(b) {
+			case 0xC0: v.clear(); break;
+			case 0xC2: v = false; break;
+			case 0xC3: v = true;  break;
+			case 0xCA: v = static_cast<double>(detail::json_float(static_cast<unsigned int>(r.be(4)))); break;
+			case 0xCB: v = detail::json_double(r.be(8)); break;
+			case 0xCC: v = static_cast<int64_t>(r.be(1)); break;
+			case 0xCD: v = static_cast<int64_t>(r.be(2)); break;
+			case 0xCE: v = static_cast<int64_t>(r.be(4)); break;
+			case 0xCF: {
+					// beyond int64 is kept as float
+					const uint64_t u = r.be(8);
+					if(u >> 63) v = static_cast<double>(u);
+					else v = static_cast<int64_t>(u);
+				}
+				break;
+			case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+					const size_t n = size_t(1) << (b - 0xD0);
+					uint64_t u = r.be(n);
+					if(n < 8 && (u >> (n * 8 - 1))) u |= ~uint64_t(0) << (n * 8);
+					v = static_cast<int64_t>(u);
+				}
+				break;
+			default:
+				if((b >= 0xA0 && b <= 0xBF) || (b >= 0xC4 && b <= 0xC6) || (b >= 0xD9 && b <= 0xDB)) {
+					const size_t n = read_length(r, b);
+					detail::json_utf8<char_t>::assign(v, r.bytes(n), n, dma);
+				}
+				else if(b <= 0x8F || b == 0xDE || b == 0xDF) {
+					const size_t n = read_length(r, b);
+					JSON_ASSERT_CHECK1(n <= (r.size() - r.pos()) / 2, "Decode error: truncated at pos=%zu.", r.pos());
+					v.clear(OBJECT);
+					ObjectT<char_t, alloc_t>& o = v.o();
+					tstring key;
+					for(size_t i = 0; i < n; ++i) {
+						const unsigned int k = r.byte();
+						JSON_ASSERT_CHECK1((k >= 0xA0 && k <= 0xBF) || (k >= 0xD9 && k <= 0xDB), "Decode error: key is not string at pos=%zu.", r.pos() - 1);
+						const size_t l = read_length(r, k);
+						detail::json_utf8<char_t>::read(r.bytes(l), l, key);
+						decode(o[key], r, dma);
+					}
+				}
+				else if(b <= 0x9F || b == 0xDC || b == 0xDD) {
+					const size_t n = read_length(r, b);
+					JSON_ASSERT_CHECK1(n <= r.size() - r.pos(), "Decode error: truncated at pos=%zu.", r.pos());
+					v.clear(ARRAY);
+					ArrayT<char_t, alloc_t>& a = v.a();
+					a.resize(n);
+					for(size_t i = 0; i < n; ++i) decode(a[i], r, dma);
+				}
+				else JSON_ASSERT_CHECK1(false, "Decode error: unsupported MessagePack type 0x%x.", b);
+				break;
 		}
 	}
 
-#ifdef __XPJSON_SUPPORT_MOVE__
-	template<class char_t>
-	void ValueT<char_t>::assign(tstring&& s, int escape)
+	template<class char_t, class alloc_t> template<class sink_t>
+	void CborT<char_t, alloc_t>::head(detail::json_binary_writer<sink_t>& w, unsigned int major, uint64_t n)
 	{
-		if(escape == AUTO_DETECT) {
-			escape = DONT_ESCAPE;
-			size_t pos = 0;
-			while(pos < s.length()) {
-				if((escape = detail::check_need_conv<char_t>(s[pos])))
-					break;
-				++pos;
-			}
+		major <<= 5;
+		if(n < 24) w.byte(major | static_cast<unsigned int>(n));
+		else if(n < 0x100) {w.byte(major | 24); w.be(n, 1);}
+		else if(n < 0x10000) {w.byte(major | 25); w.be(n, 2);}
+		else if(n <= 0xFFFFFFFFULL) {w.byte(major | 26); w.be(n, 4);}
+		else {w.byte(major | 27); w.be(n, 8);}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t CborT<char_t, alloc_t>::float_size(double f, unsigned int& half)
+	{
+		if(f != f) {half = 0x7E00; return 2;}
+		if(fabs(f) > FLT_MAX && fabs(f) != HUGE_VAL) return 8;
+		const float g = static_cast<float>(f);
+		if(static_cast<double>(g) != f) return 8;
+		const unsigned int bits = detail::json_bits(g);
+		const unsigned int sign = (bits >> 16) & 0x8000, exp = (bits >> 23) & 0xFF, mant = bits & 0x7FFFFF;
+		if(exp == 0xFF) {half = sign | 0x7C00; return 2;}
+		if(!exp) {
+			if(mant) return 4;
+			half = sign;
+			return 2;
 		}
-		clear(STRING);
-		if(_sso || _dma) {
-			_sso = _dma = false;
-			_s = new tstring;
+		if(exp >= 127 + 16) return 4;
+		if(exp > 127 - 15) {
+			if(mant & 0x1FFF) return 4;
+			half = sign | ((exp - 127 + 15) << 10) | (mant >> 13);
+			return 2;
 		}
-		_s->swap(s);
-		_e = escape;
+		// subnormal float 16
+		const unsigned int m = mant | 0x800000, shift = 126 - exp;
+		if(shift > 24 || (m & ((1u << shift) - 1))) return 4;
+		half = sign | (m >> shift);
+		return 2;
 	}
-#endif
 
-	template<class char_t>
-	void ValueT<char_t>::assign(const ValueT<char_t>& v)
+	template<class char_t, class alloc_t>
+	double CborT<char_t, alloc_t>::half_to_double(unsigned int half)
 	{
-		if(this != &v) {
-			clear(v._type);
-			switch(_type) {
-				case NIL:     _type = NIL; break;
-				case BOOLEAN: _b = v._b;   break;
-				case INTEGER: _i = v._i;   break;
-				case FLOAT:   _f = v._f;   break;
-				case STRING:
-					assign(v.c_str(), v.length(), v._e, v._dma);
-					break;
-				case OBJECT:  *_o = *v._o; break;
-				case ARRAY:   *_a = *v._a; break;
-			}
-		}
+		const unsigned int exp = (half >> 10) & 0x1F, mant = half & 0x3FF;
+		double d;
+		if(!exp) d = ldexp(static_cast<double>(mant), -24);
+		else if(exp != 31) d = ldexp(static_cast<double>(mant + 0x400), static_cast<int>(exp) - 25);
+		else d = mant ? detail::json_double(0x7FF8000000000000ULL) : HUGE_VAL;
+		return (half & 0x8000) ? -d : d;
 	}
 
-#ifdef __XPJSON_SUPPORT_MOVE__
-	template<class char_t>
-	void ValueT<char_t>::assign(ValueT<char_t>&& v)
+	template<class char_t, class alloc_t>
+	size_t CborT<char_t, alloc_t>::size(const ValueT<char_t, alloc_t>& v, bool indefinite/* = false*/)
 	{
-		if(this != &v) {
-			clear(v._type);
-			switch(_type) {
-				case NIL:     _type = NIL; break;
-				case BOOLEAN: _b = v._b;   break;
-				case INTEGER: _i = v._i;   break;
-				case FLOAT:   _f = v._f;   break;
-				case STRING:
-					if(!_sso && !_dma && !v._sso && !v._dma) {
-						swap(_s, v._s);
-						_e = v._e;
-					}
-					else {
-						assign(v.c_str(), v.length(), v._e, v._dma);
+		switch(v.type()) {
+			case NIL:
+			case BOOLEAN: return 1;
+			case INTEGER: return head_size(v.i() >= 0 ? static_cast<uint64_t>(v.i()) : ~static_cast<uint64_t>(v.i()));
+			case FLOAT: {
+					unsigned int half;
+					return 1 + float_size(static_cast<double>(v.f()), half);
+				}
+			case STRING: {
+					const size_t n = detail::json_utf8<char_t>::size(v.c_str(), static_cast<size_t>(v.length()));
+					return head_size(n) + n;
+				}
+			case OBJECT: {
+					size_t bytes = indefinite ? 2 : head_size(v.o().size());
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+						const size_t n = detail::json_utf8<char_t>::size(it->first.data(), it->first.size());
+						bytes += head_size(n) + n + size(it->second, indefinite);
 					}
-					break;
-				case OBJECT:  swap(_o, v._o); break;
-				case ARRAY:   swap(_a, v._a); break;
-			}
-			v.clear();
+					return bytes;
+				}
+			case ARRAY: {
+					size_t bytes = indefinite ? 2 : head_size(v.a().size());
+					for(size_t i = 0; i < v.a().size(); ++i) bytes += size(v.a()[i], indefinite);
+					return bytes;
+				}
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					return size(parsed, indefinite);
+				}
 		}
+		return 0;
 	}
-#endif
 
-	template<class char_t>
-	void ValueT<char_t>::clear(Type	type /*= NIL*/)
+	template<class char_t, class alloc_t> template<class sink_t>
+	void CborT<char_t, alloc_t>::encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w, bool indefinite)
 	{
-		if(_type != type) {
-			switch(_type) {
-				case STRING: if(!_sso && !_dma) delete _s; break;
-				case OBJECT: delete _o; break;
-				case ARRAY:  delete _a; break;
-				default: break;
-			}
-			switch(type) {
-				case STRING:
-					_sso = true;
-					_sso_len = 0;
-					break;
-				case OBJECT: _o = new ObjectT<char_t>; break;
-				case ARRAY:  _a = new ArrayT<char_t>;  break;
-				default: break;
-			}
-			_type = type;
-		}
-		else {
-			switch(_type) {
-				case STRING: if(!_sso && !_dma) _s->clear(); break;
-				case OBJECT: _o->clear(); break;
-				case ARRAY:  _a->clear(); break;
-				default: break;
-			}
+		switch(v.type()) {
+			case NIL:     w.byte(0xF6);                break;
+			case BOOLEAN: w.byte(v.b() ? 0xF5 : 0xF4); break;
+			case INTEGER:
+				// negative integer n is encoded as -1 - n, i.e. ~n
+				if(v.i() >= 0) head(w, 0, static_cast<uint64_t>(v.i()));
+				else head(w, 1, ~static_cast<uint64_t>(v.i()));
+				break;
+			case FLOAT: {
+					const double f = static_cast<double>(v.f());
+					unsigned int half = 0;
+					switch(float_size(f, half)) {
+						case 2:  w.byte(0xF9); w.be(half, 2);                                       break;
+						case 4:  w.byte(0xFA); w.be(detail::json_bits(static_cast<float>(f)), 4); break;
+						default: w.byte(0xFB); w.be(detail::json_bits(f), 8);                      break;
+					}
+				}
+				break;
+			case STRING: {
+					const size_t n = static_cast<size_t>(v.length());
+					head(w, 3, detail::json_utf8<char_t>::size(v.c_str(), n));
+					detail::json_utf8<char_t>::write(w, v.c_str(), n);
+				}
+				break;
+			case OBJECT:
+				if(indefinite) w.byte(0xBF);
+				else head(w, 5, v.o().size());
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+					head(w, 3, detail::json_utf8<char_t>::size(it->first.data(), it->first.size()));
+					detail::json_utf8<char_t>::write(w, it->first.data(), it->first.size());
+					encode(it->second, w, indefinite);
+				}
+				if(indefinite) w.byte(0xFF);
+				break;
+			case ARRAY:
+				if(indefinite) w.byte(0x9F);
+				else head(w, 4, v.a().size());
+				for(size_t i = 0; i < v.a().size(); ++i) encode(v.a()[i], w, indefinite);
+				if(indefinite) w.byte(0xFF);
+				break;
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					encode(parsed, w, indefinite);
+				}
+				break;
 		}
 	}
 
-	namespace detail
+	template<class char_t, class alloc_t>
+	uint64_t CborT<char_t, alloc_t>::argument(detail::json_binary_reader& r, unsigned int info)
 	{
-		namespace
-		{
-			template<class char_t, class T>
-			typename json_enable_if<json_is_arithmetic<T>::value, T>::type
-			internal_type_casting(const JSON::ValueT<char_t>& v, const T& value)
-			{
-				switch(v.type()) {
-					case NIL:     break;
-					case BOOLEAN: return T(v.b());
-					case INTEGER: return T(v.i());
-					case FLOAT:   return T(v.f());
-					case STRING:
-						if(v.length() == detail::boolean_true_length() && !memcmp(v.c_str(), detail::boolean<true, char_t>(), detail::boolean_true_length() * sizeof(char_t)))
-							return T(1);
-						else if(v.length() == detail::boolean_false_length() && !memcmp(v.c_str(), detail::boolean<false, char_t>(), detail::boolean_false_length() * sizeof(char_t)))
-							return T(0);
-						else {
-							char_t* end = 0;
-							double d = ttod(v.c_str(), &end);
-							JSON_ASSERT_CHECK1(end == v.c_str() + v.length(), "Type-casting error: (%s) to arithmetic.", detail::get_cstr(v.c_str(), v.length()).c_str());
-							return T(d);
+		if(info < 24) return info;
+		JSON_ASSERT_CHECK1(info < 28, "Decode error: invalid CBOR head at pos=%zu.", r.pos() - 1);
+		return r.be(size_t(1) << (info - 24));
+	}
+
+	template<class char_t, class alloc_t>
+	void CborT<char_t, alloc_t>::decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, bool dma)
+	{
+		const unsigned int b = r.byte();
+		const unsigned int major = b >> 5, info = b & 0x1F;
+		switch(major) {
+			case 0: {
+					// beyond int64 is kept as float
+					const uint64_t u = argument(r, info);
+					if(u >> 63) v = static_cast<double>(u);
+					else v = static_cast<int64_t>(u);
+				}
+				break;
+			case 1: {
+					const uint64_t u = argument(r, info);
+					if(u >> 63) v = -1.0 - static_cast<double>(u);
+					else v = -1 - static_cast<int64_t>(u);
+				}
+				break;
+			case 2:
+			case 3:
+				if(info == 31) {
+					// chunks of definite length strings of the same major type
+					std::string bytes;
+					for(unsigned int c = r.byte(); c != 0xFF; c = r.byte()) {
+						JSON_ASSERT_CHECK1((c >> 5) == major && (c & 0x1F) != 31, "Decode error: invalid CBOR chunk at pos=%zu.", r.pos() - 1);
+						const size_t n = static_cast<size_t>(argument(r, c & 0x1F));
+						bytes.append(r.bytes(n), n);
+					}
+					detail::json_utf8<char_t>::assign(v, bytes.data(), bytes.size(), false);
+				}
+				else {
+					const size_t n = static_cast<size_t>(argument(r, info));
+					detail::json_utf8<char_t>::assign(v, r.bytes(n), n, dma);
+				}
+				break;
+			case 4: {
+					v.clear(ARRAY);
+					ArrayT<char_t, alloc_t>& a = v.a();
+					if(info == 31) {
+						while(r.peek() != 0xFF) {
+							a.push_back(ValueT<char_t, alloc_t>());
+							decode(a.back(), r, dma);
 						}
-						JSON_ASSERT_CHECK1(false, "Type-casting error: (%s) to arithmetic.", detail::get_cstr(v.c_str(), v.length()).c_str());
-					default: JSON_ASSERT_CHECK1(false, "Type-casting error: from (%s) type to arithmetic.", get_type_name(v.type()));
+						r.byte();
+					}
+					else {
+						const uint64_t n = argument(r, info);
+						JSON_ASSERT_CHECK1(n <= r.size() - r.pos(), "Decode error: truncated at pos=%zu.", r.pos());
+						a.resize(static_cast<size_t>(n));
+						for(size_t i = 0; i < a.size(); ++i) decode(a[i], r, dma);
+					}
 				}
-				return T(value);
+				break;
+			case 5: {
+					v.clear(OBJECT);
+					ObjectT<char_t, alloc_t>& o = v.o();
+					const uint64_t n = (info == 31) ? uint64_t(-1) : argument(r, info);
+					JSON_ASSERT_CHECK1(info == 31 || n <= (r.size() - r.pos()) / 2, "Decode error: truncated at pos=%zu.", r.pos());
+					ValueT<char_t, alloc_t> key;
+					tstring k;
+					for(uint64_t i = 0; i < n; ++i) {
+						if(info == 31 && r.peek() == 0xFF) {r.byte(); break;}
+						const size_t pos = r.pos();
+						decode(key, r, false);
+						JSON_ASSERT_CHECK1(key.type() == STRING || key.type() == INTEGER, "Decode error: key is neither string nor integer at pos=%zu.", pos);
+						key.to_string(k);
+						decode(o[k], r, dma);
+					}
+				}
+				break;
+			case 6:
+				// tag, the tagged item is kept as it is
+				argument(r, info);
+				decode(v, r, dma);
+				break;
+			default:
+				switch(info) {
+					case 20: v = false;  break;
+					case 21: v = true;   break;
+					case 22:
+					case 23: v.clear();  break;
+					case 25: v = half_to_double(static_cast<unsigned int>(r.be(2)));                          break;
+					case 26: v = static_cast<double>(detail::json_float(static_cast<unsigned int>(r.be(4)))); break;
+					case 27: v = detail::json_double(r.be(8));                                                break;
+					default: JSON_ASSERT_CHECK1(false, "Decode error: unsupported CBOR simple value at pos=%zu.", r.pos() - 1);
+				}
+				break;
+		}
+	}
+
+	template<class char_t, class alloc_t> template<class sink_t>
+	void BsonT<char_t, alloc_t>::encode_root(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w)
+	{
+		if(v.type() == RAW) {
+			ValueT<char_t, alloc_t> parsed;
+			detail::json_value_access::parse_raw(v, parsed);
+			encode_root(parsed, w);
+			return;
+		}
+		JSON_CHECK_TYPE(v.type(), OBJECT);
+		encode_document(v, w);
+	}
+
+	template<class char_t, class alloc_t> template<class sink_t>
+	void BsonT<char_t, alloc_t>::encode_document(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w)
+	{
+		const size_t start = w.pos();
+		w.le(0, 4);
+		if(v.type() == OBJECT) {
+			for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it)
+				encode_element(it->first.data(), it->first.size(), it->second, w);
+		}
+		else {
+			// keys of array are indexes in decimal
+			char_t name[24];
+			for(size_t i = 0; i < v.a().size(); ++i) {
+				size_t n = sizeof(name) / sizeof(char_t);
+				for(size_t j = i; n == sizeof(name) / sizeof(char_t) || j; j /= 10) name[--n] = static_cast<char_t>('0' + j % 10);
+				encode_element(name + n, sizeof(name) / sizeof(char_t) - n, v.a()[i], w);
 			}
+		}
+		w.byte(0);
+		const size_t bytes = w.pos() - start;
+		JSON_ASSERT_CHECK1(bytes <= 0x7FFFFFFF, "Encode error: document of %zu bytes is too large.", bytes);
+		w.patch_le(start, bytes, 4);
+	}
 
-			template<class char_t, class T>
-			typename json_enable_if<json_is_same<JSON_TSTRING(char_t), T>::value, T>::type
-			internal_type_casting(const JSON::ValueT<char_t>& v, const T& value)
-			{
-				switch(v.type()) {
-					case NIL:     break;
-					case BOOLEAN: return T(v.b() ? detail::boolean<true, char_t>() : detail::boolean<false, char_t>());
-					case INTEGER: return to_string<int64_t, char_t>(v.i());
-					case FLOAT:   return to_string<double, char_t>(v.f());
-					case STRING:  return T(v.c_str(), v.length());
-					default: JSON_ASSERT_CHECK1(false, "Type-casting error: from (%s) type to string.", get_type_name(v.type()));
+	template<class char_t, class alloc_t> template<class sink_t>
+	void BsonT<char_t, alloc_t>::encode_element(const char_t* name, size_t n, const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w)
+	{
+		static const unsigned char types[] = {0x0A, 0x08, 0x00, 0x01, 0x02, 0x03, 0x04};
+		if(v.type() == RAW) {
+			ValueT<char_t, alloc_t> parsed;
+			detail::json_value_access::parse_raw(v, parsed);
+			encode_element(name, n, parsed, w);
+			return;
+		}
+		const bool int32 = v.type() == INTEGER && v.i() >= -2147483647 - 1 && v.i() <= 2147483647;
+		w.byte(v.type() == INTEGER ? (int32 ? 0x10 : 0x12) : types[v.type()]);
+		JSON_ASSERT_CHECK1(std::find(name, name + n, char_t(0)) == name + n, "Encode error: key of %zu chars contains nul.", n);
+		detail::json_utf8<char_t>::write(w, name, n);
+		w.byte(0);
+		switch(v.type()) {
+			case BOOLEAN: w.byte(v.b() ? 1 : 0);                                          break;
+			case INTEGER: w.le(static_cast<uint64_t>(v.i()), int32 ? 4 : 8);              break;
+			case FLOAT:   w.le(detail::json_bits(static_cast<double>(v.f())), 8);        break;
+			case STRING: {
+					const size_t len = static_cast<size_t>(v.length());
+					const size_t bytes = detail::json_utf8<char_t>::size(v.c_str(), len);
+					JSON_ASSERT_CHECK1(bytes < 0x7FFFFFFF, "Encode error: string of %zu bytes is too large.", bytes);
+					w.le(bytes + 1, 4);
+					detail::json_utf8<char_t>::write(w, v.c_str(), len);
+					w.byte(0);
 				}
-				return T(value);
+				break;
+			case OBJECT:
+			case ARRAY:   encode_document(v, w);                                          break;
+			default:                                                                      break;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	void BsonT<char_t, alloc_t>::decode_document(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, Type type, bool dma)
+	{
+		const size_t start = r.pos();
+		const uint64_t bytes = r.le(4);
+		JSON_ASSERT_CHECK1(bytes >= 5 && bytes <= 0x7FFFFFFF && bytes <= r.size() - start, "Decode error: bad document length at pos=%zu.", start);
+		v.clear(type);
+		tstring key;
+		for(unsigned int t = r.byte(); t; t = r.byte()) {
+			size_t n;
+			const char* name = r.cstring(n);
+			if(type == OBJECT) {
+				detail::json_utf8<char_t>::read(name, n, key);
+				decode_element(v.o()[key], r, t, dma);
+			}
+			else {
+				v.a().push_back(ValueT<char_t, alloc_t>());
+				decode_element(v.a().back(), r, t, dma);
 			}
 		}
+		JSON_ASSERT_CHECK1(r.pos() - start == bytes, "Decode error: bad document length at pos=%zu.", start);
+	}
+
+	template<class char_t, class alloc_t>
+	void BsonT<char_t, alloc_t>::decode_element(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, unsigned int type, bool dma)
+	{
+		switch(type) {
+			case 0x01: v = detail::json_double(r.le(8)); break;
+			case 0x02:
+			case 0x0D:
+			case 0x0E: {
+					const size_t n = static_cast<size_t>(r.le(4));
+					JSON_ASSERT_CHECK1(n, "Decode error: bad string length at pos=%zu.", r.pos() - 4);
+					const char* s = r.bytes(n);
+					JSON_ASSERT_CHECK1(!s[n - 1], "Decode error: string isn't nul terminated at pos=%zu.", r.pos() - 1);
+					detail::json_utf8<char_t>::assign(v, s, n - 1, dma);
+				}
+				break;
+			case 0x03: decode_document(v, r, OBJECT, dma); break;
+			case 0x04: decode_document(v, r, ARRAY, dma);  break;
+			case 0x05: {
+					const size_t n = static_cast<size_t>(r.le(4));
+					r.byte();
+					detail::json_utf8<char_t>::assign(v, r.bytes(n), n, dma);
+				}
+				break;
+			case 0x06:
+			case 0x0A: v.clear(); break;
+			case 0x07: {
+					static const char digits[] = "0123456789abcdef";
+					const unsigned char* id = reinterpret_cast<const unsigned char*>(r.bytes(12));
+					char hex[24];
+					for(size_t i = 0; i < 12; ++i) {
+						hex[i * 2] = digits[id[i] >> 4];
+						hex[i * 2 + 1] = digits[id[i] & 0xF];
+					}
+					detail::json_utf8<char_t>::assign(v, hex, sizeof(hex), false);
+				}
+				break;
+			case 0x08: {
+					const unsigned int b = r.byte();
+					JSON_ASSERT_CHECK1(b < 2, "Decode error: bad boolean at pos=%zu.", r.pos() - 1);
+					v = b != 0;
+				}
+				break;
+			case 0x09:
+			case 0x12: v = static_cast<int64_t>(r.le(8)); break;
+			case 0x10: v = static_cast<int64_t>(static_cast<int>(static_cast<unsigned int>(r.le(4)))); break;
+			case 0x11: {
+					const uint64_t u = r.le(8);
+					if(u >> 63) v = static_cast<double>(u);
+					else v = static_cast<int64_t>(u);
+				}
+				break;
+			default: JSON_ASSERT_CHECK1(false, "Decode error: unsupported BSON type at pos=%zu.", r.pos());
+		}
 	}
 
-	template<class char_t> template<class T>
-	T JSON::ValueT<char_t>::get(const T& default_value) const
+	template<class char_t, class alloc_t>
+	size_t UbjsonT<char_t, alloc_t>::size(const ValueT<char_t, alloc_t>& v)
 	{
-		return JSON_MOVE((detail::internal_type_casting <char_t, T>(*this, default_value)));
+		switch(v.type()) {
+			case NIL:
+			case BOOLEAN: return 1;
+			case INTEGER: return int_size(v.i());
+			case FLOAT: {
+					const double f = static_cast<double>(v.f());
+					if(!(fabs(f) <= DBL_MAX)) return 1;
+					return (fabs(f) <= FLT_MAX && static_cast<double>(static_cast<float>(f)) == f) ? 5 : 9;
+				}
+			case STRING: {
+					const size_t n = detail::json_utf8<char_t>::size(v.c_str(), static_cast<size_t>(v.length()));
+					return 1 + int_size(static_cast<int64_t>(n)) + n;
+				}
+			case OBJECT: {
+					size_t bytes = 2;
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+						const size_t n = detail::json_utf8<char_t>::size(it->first.data(), it->first.size());
+						bytes += int_size(static_cast<int64_t>(n)) + n + size(it->second);
+					}
+					return bytes;
+				}
+			case ARRAY: {
+					size_t bytes = 2;
+					for(size_t i = 0; i < v.a().size(); ++i) bytes += size(v.a()[i]);
+					return bytes;
+				}
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					return size(parsed);
+				}
+		}
+		return 0;
 	}
 
-	template<class char_t> template<class T>
-	T JSON::ValueT<char_t>::get(const tstring& key, const T& default_value) const
+	template<class char_t, class alloc_t> template<class sink_t>
+	void UbjsonT<char_t, alloc_t>::encode_int(detail::json_binary_writer<sink_t>& w, int64_t i)
 	{
-		JSON_CHECK_TYPE(_type, OBJECT);
-		typename ObjectT<char_t>::const_iterator it = _o->find(key);
-		if(it != _o->end()) return JSON_MOVE((detail::internal_type_casting <char_t, T>(it->second, default_value)));
-		return T(default_value);
+		if(i >= -128 && i < 128) {w.byte('i'); w.be(static_cast<uint64_t>(i), 1);}
+		else if(i >= 0 && i < 256) {w.byte('U'); w.be(static_cast<uint64_t>(i), 1);}
+		else if(i >= -32768 && i < 32768) {w.byte('I'); w.be(static_cast<uint64_t>(i), 2);}
+		else if(i >= -2147483647 - 1 && i <= 2147483647) {w.byte('l'); w.be(static_cast<uint64_t>(i), 4);}
+		else {w.byte('L'); w.be(static_cast<uint64_t>(i), 8);}
 	}
 
-	template<class char_t>
-	void ValueT<char_t>::write(tstring& out) const
+	template<class char_t, class alloc_t> template<class sink_t>
+	void UbjsonT<char_t, alloc_t>::encode(const ValueT<char_t, alloc_t>& v, detail::json_binary_writer<sink_t>& w)
 	{
-		switch(_type) {
-			case NIL:     out += detail::nil_null<char_t>(); break;
-			case INTEGER: detail::to_string(_i, out);        break;
-			case FLOAT:   detail::to_string(_f, out);        break;
-			case OBJECT:  WriterT<char_t>::write(*_o, out);  break;
-			case ARRAY:   WriterT<char_t>::write(*_a, out);  break;
-			case BOOLEAN:
-				out += (_b ? detail::boolean<true, char_t>() : detail::boolean<false, char_t>());
+		switch(v.type()) {
+			case NIL:     w.byte('Z');               break;
+			case BOOLEAN: w.byte(v.b() ? 'T' : 'F'); break;
+			case INTEGER: encode_int(w, v.i());      break;
+			case FLOAT: {
+					const double f = static_cast<double>(v.f());
+					if(!(fabs(f) <= DBL_MAX)) w.byte('Z');
+					else if(fabs(f) <= FLT_MAX && static_cast<double>(static_cast<float>(f)) == f) {w.byte('d'); w.be(detail::json_bits(static_cast<float>(f)), 4);}
+					else {w.byte('D'); w.be(detail::json_bits(f), 8);}
+				}
 				break;
-			case STRING:
-				out += '\"';
-				if(!_sso && !_dma && _e) detail::encode(_s->c_str(), _s->length(), out);
-				else out.append(c_str(), length());
-				out += '\"';
+			case STRING: {
+					const size_t n = static_cast<size_t>(v.length());
+					w.byte('S');
+					encode_int(w, static_cast<int64_t>(detail::json_utf8<char_t>::size(v.c_str(), n)));
+					detail::json_utf8<char_t>::write(w, v.c_str(), n);
+				}
+				break;
+			case OBJECT:
+				w.byte('{');
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = v.o().begin(); it != v.o().end(); ++it) {
+					encode_int(w, static_cast<int64_t>(detail::json_utf8<char_t>::size(it->first.data(), it->first.size())));
+					detail::json_utf8<char_t>::write(w, it->first.data(), it->first.size());
+					encode(it->second, w);
+				}
+				w.byte('}');
+				break;
+			case ARRAY:
+				w.byte('[');
+				for(size_t i = 0; i < v.a().size(); ++i) encode(v.a()[i], w);
+				w.byte(']');
+				break;
+			case RAW: {
+					ValueT<char_t, alloc_t> parsed;
+					detail::json_value_access::parse_raw(v, parsed);
+					encode(parsed, w);
+				}
 				break;
 		}
 	}
 
-	template<class char_t>
-	void ValueT<char_t>::to_string(tstring& out) const
+	template<class char_t, class alloc_t>
+	int64_t UbjsonT<char_t, alloc_t>::decode_int(detail::json_binary_reader& r, unsigned int marker)
 	{
-		if(_type == STRING) out = s();
-		else {out.clear(); write(out);}
+		switch(marker) {
+			case 'i': return static_cast<signed char>(r.be(1));
+			case 'U': return static_cast<int64_t>(r.be(1));
+			case 'I': return static_cast<short>(r.be(2));
+			case 'l': return static_cast<int>(static_cast<unsigned int>(r.be(4)));
+			case 'L': return static_cast<int64_t>(r.be(8));
+		}
+		JSON_ASSERT_CHECK1(false, "Decode error: integer expected at pos=%zu.", r.pos() - 1);
+		return 0;
 	}
 
-#define case_white_space	case ' ':case '\n':case '\r':case '\t'
-#define case_number_1_9		case '1':case '2':case '3':case '4':case '5':case '6':case '7':case '8':case '9'
-#define case_number_0_9		case '0':case_number_1_9
-#define case_number_ending	case_white_space: case ',':case ']':case '}'
+	template<class char_t, class alloc_t>
+	size_t UbjsonT<char_t, alloc_t>::decode_length(detail::json_binary_reader& r)
+	{
+		const int64_t n = decode_int(r, r.byte());
+		JSON_ASSERT_CHECK1(n >= 0 && static_cast<uint64_t>(n) <= r.size() - r.pos(), "Decode error: bad length at pos=%zu.", r.pos());
+		return static_cast<size_t>(n);
+	}
 
-	template<class char_t>
-	size_t ValueT<char_t>::read_string(const char_t* in, size_t len, bool dma)
+	template<class char_t, class alloc_t>
+	void UbjsonT<char_t, alloc_t>::decode(ValueT<char_t, alloc_t>& v, detail::json_binary_reader& r, unsigned int marker, bool dma)
 	{
-		enum {NONE = 0, NORMAL};
-		unsigned char state = NONE;
-		size_t pos = 0;
-		size_t start = 0;
-		_e = false;
-		while(pos < len) {
-			switch(state) {
-				case NONE:
-					switch(in[pos]) {
-						case '\"': state = NORMAL; start = pos + 1; break;
-						case_white_space:                           break;
-						default: JSON_PARSE_CHECK(false);
+		switch(marker) {
+			case 'Z': v.clear();   break;
+			case 'T': v = true;    break;
+			case 'F': v = false;   break;
+			case 'i':
+			case 'U':
+			case 'I':
+			case 'l':
+			case 'L': v = decode_int(r, marker);                                                          break;
+			case 'd': v = static_cast<double>(detail::json_float(static_cast<unsigned int>(r.be(4)))); break;
+			case 'D': v = detail::json_double(r.be(8));                                                break;
+			case 'C': detail::json_utf8<char_t>::assign(v, r.bytes(1), 1, false);                     break;
+			case 'S': {
+					const size_t n = decode_length(r);
+					detail::json_utf8<char_t>::assign(v, r.bytes(n), n, dma);
+				}
+				break;
+			case 'H': {
+					// high-precision number, a raw value referencing in with dma loses no digits, else it's parsed
+					const size_t n = decode_length(r);
+					const char* s = r.bytes(n);
+					size_t i = 0;
+					while(i < n && s[i] && strchr("0123456789+-.eE", s[i])) ++i;
+					JSON_ASSERT_CHECK1(n && i == n && s[0] != '+', "Decode error: bad number at pos=%zu.", r.pos() - n);
+					if(dma && sizeof(char_t) == sizeof(char)) v.raw(reinterpret_cast<const char_t*>(s), n);
+					else if(n < 19) {
+						tstring text;
+						detail::json_utf8<char_t>::read(s, n, text);
+						JSON_ASSERT_CHECK1(detail::json_value_access::read_number(v, text.data(), n) == n, "Decode error: bad number at pos=%zu.", r.pos() - n);
 					}
-					break;
-				case NORMAL:
-					switch(in[pos]) {
-						case '\"':
-							if(_e) {
-								clear(STRING);
-								if(_sso || _dma) {
-									_sso = _dma = false;
-									_s = new tstring;
-								}
-								detail::decode(in + start, pos - start, *_s);
-							}
-							else {
-								assign(in + start, pos - start, _e, dma);
-							}
-							return pos + 1;
-						default:
-							if(!_e) _e = detail::check_need_conv<char_t>(in[pos]);
-							if(_e && in[pos] == '\\') ++pos;
-							break;
+					else v = strtod(std::string(s, n).c_str(), NULL);
+				}
+				break;
+			case '[':
+			case '{': {
+					// optimized forms: '$' type & '#' count, or '#' count, else elements till the end marker
+					const bool object = marker == '{';
+					unsigned int type = 0;
+					size_t count = size_t(-1);
+					if(r.peek() == '$') {
+						r.byte();
+						type = r.byte();
+						JSON_ASSERT_CHECK1(r.peek() == '#', "Decode error: count expected at pos=%zu.", r.pos());
 					}
-					break;
+					if(r.peek() == '#') {
+						r.byte();
+						count = decode_length(r);
+					}
+					v.clear(object ? OBJECT : ARRAY);
+					tstring key;
+					for(size_t i = 0; i < count; ++i) {
+						unsigned int m = 0;
+						if(!type) {
+							while((m = r.peek()) == 'N') r.byte();
+							if(count == size_t(-1) && m == (object ? '}' : ']')) {r.byte(); break;}
+						}
+						ValueT<char_t, alloc_t>* item;
+						if(object) {
+							const size_t n = decode_length(r);
+							detail::json_utf8<char_t>::read(r.bytes(n), n, key);
+							item = &v.o()[key];
+						}
+						else {
+							v.a().push_back(ValueT<char_t, alloc_t>());
+							item = &v.a().back();
+						}
+						if(!type) {
+							while((m = r.byte()) == 'N');
+						}
+						decode(*item, r, type ? type : m, dma);
+					}
+				}
+				break;
+			default: JSON_ASSERT_CHECK1(false, "Decode error: unsupported UBJSON marker at pos=%zu.", r.pos() - 1);
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	bool equal(const ObjectT<char_t, alloc_t>& lhs, const ObjectT<char_t, alloc_t>& rhs, double epsilon)
+	{
+		if(&lhs == &rhs) return true;
+		if(lhs.size() != rhs.size()) return false;
+		if(!epsilon && lhs.cached() && rhs.cached() && lhs._hash != rhs._hash) return false;
+		typename ObjectT<char_t, alloc_t>::const_iterator lit = lhs.begin();
+		typename ObjectT<char_t, alloc_t>::const_iterator rit = rhs.begin();
+		for(; lit != lhs.end(); ++lit, ++rit) {
+			if(lit->first != rit->first || !equal(lit->second, rit->second, epsilon)) return false;
+		}
+		return true;
+	}
+
+	template<class char_t, class alloc_t>
+	bool equal(const ArrayT<char_t, alloc_t>& lhs, const ArrayT<char_t, alloc_t>& rhs, double epsilon)
+	{
+		if(&lhs == &rhs) return true;
+		if(lhs.size() != rhs.size()) return false;
+		if(!epsilon && lhs.cached() && rhs.cached() && lhs._hash != rhs._hash) return false;
+		typename ArrayT<char_t, alloc_t>::const_iterator lit = lhs.begin();
+		typename ArrayT<char_t, alloc_t>::const_iterator rit = rhs.begin();
+		for(; lit != lhs.end(); ++lit, ++rit) {
+			// runs of integers are compared inline
+			if(lit->type() == INTEGER && rit->type() == INTEGER) {
+				if(lit->i() != rit->i()) return false;
 			}
-			++pos;
+			else if(!equal(*lit, *rit, epsilon)) return false;
 		}
-		JSON_PARSE_CHECK(false);
+		return true;
 	}
 
-	template<class char_t>
-	size_t ValueT<char_t>::read_number(const char_t* in, size_t len, bool)
+	template<class char_t, class alloc_t>
+	bool equal(const ValueT<char_t, alloc_t>& lhs, const ValueT<char_t, alloc_t>& rhs, double epsilon)
 	{
-		enum {NONE = 0,SIGN, ZERO, DIGIT, POINT, DIGIT_FRAC, EXP, EXP_SIGN, DIGIT_EXP};
-		unsigned char state = NONE;
-		size_t pos = 0;
-		size_t start = 0;
-		while(pos < len) {
-			switch(state) {
-				case NONE:
-					switch(in[pos]) {
-						case '-':         state = SIGN;  start = pos; break;
-						case '0':         state = ZERO;  start = pos; break;
-						case_number_1_9:  state = DIGIT; start = pos; break;
-						case_white_space:                             break;
-						default: JSON_PARSE_CHECK(false);
+		if(lhs.type() != rhs.type()) return false;
+		switch(lhs.type()) {
+			case NIL:     return true;
+			case BOOLEAN: return lhs.b() == rhs.b();
+			case INTEGER: return lhs.i() == rhs.i();
+			case FLOAT: {
+					const double l = static_cast<double>(lhs.f()), r = static_cast<double>(rhs.f());
+					if(l == r) return true;
+					const double scale = std::max(1.0, std::max(fabs(l), fabs(r)));
+					return epsilon && fabs(l - r) <= epsilon * scale;
+				}
+			case STRING:
+			case RAW:     return lhs.length() == rhs.length() && !memcmp(lhs.c_str(), rhs.c_str(), lhs.length() * sizeof(char_t));
+			case OBJECT:  return equal(lhs.o(), rhs.o(), epsilon);
+			case ARRAY:   return equal(lhs.a(), rhs.a(), epsilon);
+		}
+		return true;
+	}
+
+	namespace detail
+	{
+		// JSON Patch & JSON Pointer
+		template<class char_t, class alloc_t> struct json_patch
+		{
+			typedef ValueT<char_t, alloc_t> value_t;
+			typedef typename value_t::tstring tstring;
+
+			static inline tstring name(const char* s) {return tstring(s, s + strlen(s));}
+
+			// equality of test op(RFC 6902 4.6), numbers are equal by value, e.g. 1 and 1.0
+			static bool same(const value_t& l, const value_t& r)
+			{
+				if(l.type() == INTEGER && r.type() == FLOAT) return same_number(l.i(), r.f());
+				if(l.type() == FLOAT && r.type() == INTEGER) return same_number(r.i(), l.f());
+				if(l.type() != r.type()) return false;
+				if(l.type() == OBJECT) {
+					const ObjectT<char_t, alloc_t>& lo = l.o();
+					const ObjectT<char_t, alloc_t>& ro = r.o();
+					if(lo.size() != ro.size()) return false;
+					for(typename ObjectT<char_t, alloc_t>::const_iterator lit = lo.begin(), rit = ro.begin(); lit != lo.end(); ++lit, ++rit) {
+						if(lit->first != rit->first || !same(lit->second, rit->second)) return false;
 					}
-					break;
-				case SIGN:
-					switch(in[pos]) {
-						case '0':        state = ZERO;  break;
-						case_number_1_9: state = DIGIT; break;
-						default: JSON_PARSE_CHECK(false);
+					return true;
+				}
+				if(l.type() == ARRAY) {
+					const ArrayT<char_t, alloc_t>& la = l.a();
+					const ArrayT<char_t, alloc_t>& ra = r.a();
+					if(la.size() != ra.size()) return false;
+					for(size_t i = 0; i < la.size(); ++i) if(!same(la[i], ra[i])) return false;
+					return true;
+				}
+				return l == r;
+			}
+			static inline bool same_number(int64_t i, double f)
+			{
+				// f is compared as int64_t only if it's integral & in range, so that large integers are exact
+				return f >= -9223372036854775808.0 && f < 9223372036854775808.0 && static_cast<double>(static_cast<int64_t>(f)) == f && static_cast<int64_t>(f) == i;
+			}
+
+			static void append_key(tstring& path, const tstring& key)
+			{
+				path += '/';
+				for(size_t i = 0; i < key.size(); ++i) {
+					if(key[i] == '~') {path += '~'; path += '0';}
+					else if(key[i] == '/') {path += '~'; path += '1';}
+					else path += key[i];
+				}
+			}
+			static void append_index(tstring& path, size_t i)
+			{
+				char_t digits[24];
+				size_t n = sizeof(digits) / sizeof(char_t);
+				do digits[--n] = static_cast<char_t>('0' + i % 10); while(i /= 10);
+				path += '/';
+				path.append(digits + n, sizeof(digits) / sizeof(char_t) - n);
+			}
+			static void op(value_t& patch, const char* type, const tstring& path, const value_t* value)
+			{
+				patch.a().push_back(value_t());
+				value_t& o = patch.a().back();
+				// strings are copied, assignment of tstring is dma
+				o[name("op")] = value_t(name(type));
+				o[name("path")] = value_t(path);
+				if(value) o[name("value")] = *value;
+			}
+
+			static void diff(const value_t& from, const value_t& to, tstring& path, value_t& patch)
+			{
+				const Type type = from.type();
+				if(type != to.type() || (type != OBJECT && type != ARRAY)) {
+					if(from != to) op(patch, "replace", path, &to);
+					return;
+				}
+				if(from.shared() && to.shared() && from.hash() == to.hash() && from == to) return;
+				const size_t len = path.size();
+				if(type == ARRAY) {
+					diff_array(from.a(), to.a(), path, patch);
+					return;
+				}
+				const ObjectT<char_t, alloc_t>& f = from.o();
+				const ObjectT<char_t, alloc_t>& t = to.o();
+				typename ObjectT<char_t, alloc_t>::const_iterator fit = f.begin(), tit = t.begin();
+				while(fit != f.end() || tit != t.end()) {
+					const int cmp = fit == f.end() ? 1 : tit == t.end() ? -1 : fit->first.compare(tit->first);
+					append_key(path, cmp <= 0 ? fit->first : tit->first);
+					if(cmp < 0) op(patch, "remove", path, NULL);
+					else if(cmp > 0) op(patch, "add", path, &tit->second);
+					else diff(fit->second, tit->second, path, patch);
+					path.resize(len);
+					if(cmp <= 0) ++fit;
+					if(cmp >= 0) ++tit;
+				}
+			}
+
+			static void diff_array(const ArrayT<char_t, alloc_t>& a, const ArrayT<char_t, alloc_t>& b, tstring& path, value_t& patch)
+			{
+				const size_t len = path.size();
+				size_t m = a.size(), n = b.size(), start = 0;
+				while(start < m && start < n && a[start] == b[start]) ++start;
+				while(m > start && n > start && a[m - 1] == b[n - 1]) {--m; --n;}
+				const size_t rows = m - start, cols = n - start;
+				size_t i = 0, j = 0, pos = start;
+				if(rows && cols && rows <= (size_t(1) << 20) / cols) {
+					// lcs[i][j] is the length of LCS of a[i..] & b[j..], elements are matched by hash first
+					vector<uint64_t> ha(rows), hb(cols);
+					for(size_t k = 0; k < rows; ++k) ha[k] = a[start + k].hash();
+					for(size_t k = 0; k < cols; ++k) hb[k] = b[start + k].hash();
+					vector<unsigned int> lcs((rows + 1) * (cols + 1), 0);
+					vector<char> same(rows * cols, 0);
+					for(size_t x = rows; x-- > 0; ) {
+						for(size_t y = cols; y-- > 0; ) {
+							unsigned int& l = lcs[x * (cols + 1) + y];
+							same[x * cols + y] = ha[x] == hb[y] && a[start + x] == b[start + y];
+							if(same[x * cols + y]) l = lcs[(x + 1) * (cols + 1) + y + 1] + 1;
+							else l = std::max(lcs[(x + 1) * (cols + 1) + y], lcs[x * (cols + 1) + y + 1]);
+						}
 					}
-					break;
-				case ZERO:
-					JSON_PARSE_CHECK(in[pos] != '0');
-				case DIGIT:
-					if(!isdigit(in[pos]) || state != DIGIT) {
-						switch(in[pos]) {
-							case '.': state = POINT; break;
-							case_number_ending:      goto GOTO_END;
-							default: JSON_PARSE_CHECK(false);
+					while(i < rows && j < cols) {
+						const unsigned int l = lcs[i * (cols + 1) + j];
+						append_index(path, pos);
+						if(same[i * cols + j]) {++i; ++j; ++pos;}
+						else if(lcs[(i + 1) * (cols + 1) + j + 1] == l) {
+							// neither is in the LCS, diff them in place
+							diff(a[start + i], b[start + j], path, patch);
+							++i; ++j; ++pos;
 						}
+						else if(lcs[(i + 1) * (cols + 1) + j] == l) {op(patch, "remove", path, NULL); ++i;}
+						else {op(patch, "add", path, &b[start + j]); ++j; ++pos;}
+						path.resize(len);
 					}
-					break;
-				case POINT:
-					switch(in[pos]) {
-						case_number_0_9: state = DIGIT_FRAC; break;
-						default: JSON_PARSE_CHECK(false);
+				}
+				else {
+					// too large for LCS, diff by position
+					for(; i < rows && j < cols; ++i, ++j, ++pos) {
+						append_index(path, pos);
+						diff(a[start + i], b[start + j], path, patch);
+						path.resize(len);
 					}
-					break;
-				case DIGIT_FRAC:
-					switch(in[pos]) {
-						case_number_0_9:    state = DIGIT_FRAC; break;
-						case 'e': case 'E': state = EXP;        break;
-						case_number_ending:                     goto GOTO_END;
+				}
+				append_index(path, pos);
+				for(; i < rows; ++i) op(patch, "remove", path, NULL);
+				path.resize(len);
+				for(; j < cols; ++j, ++pos) {
+					append_index(path, pos);
+					op(patch, "add", path, &b[start + j]);
+					path.resize(len);
+				}
+			}
+
+			// array index of token, "-" is the end
+			static bool index(const tstring& token, size_t size, size_t& i)
+			{
+				if(token.size() == 1 && token[0] == '-') {i = size; return true;}
+				if(token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1)) return false;
+				i = 0;
+				for(size_t k = 0; k < token.size(); ++k) {
+					if(token[k] < '0' || token[k] > '9') return false;
+					i = i * 10 + static_cast<size_t>(token[k] - '0');
+				}
+				return true;
+			}
+			// next unescaped token of path from pos
+			static bool token(const tstring& path, size_t& pos, tstring& out)
+			{
+				if(pos >= path.size() || path[pos] != '/') return false;
+				out.clear();
+				for(++pos; pos < path.size() && path[pos] != '/'; ++pos) {
+					if(path[pos] != '~') out += path[pos];
+					else if(pos + 1 < path.size() && (path[pos + 1] == '0' || path[pos + 1] == '1')) out += path[++pos] == '0' ? '~' : '/';
+					else return false;
+				}
+				return true;
+			}
+			// value at path, or its parent & the last token, NULL if not found
+			static value_t* resolve(value_t& root, const tstring& path, tstring* last)
+			{
+				value_t* v = &root;
+				size_t pos = 0;
+				tstring t;
+				while(pos < path.size()) {
+					if(!token(path, pos, t)) return NULL;
+					if(last && pos == path.size()) {
+						*last = t;
+						return v;
 					}
-					break;
-				case EXP:
-					switch(in[pos]) {
-						case_number_0_9:    state = DIGIT_EXP; break;
-						case '+': case '-': state = EXP_SIGN;  break;
-						default: JSON_PARSE_CHECK(false);
+					size_t i;
+					if(v->type() == OBJECT) {
+						typename ObjectT<char_t, alloc_t>::iterator it = v->o().find(t);
+						if(it == v->o().end()) return NULL;
+						v = &it->second;
 					}
-					break;
-				case EXP_SIGN:
-					switch(in[pos]) {
-						case_number_0_9: state = DIGIT_EXP; break;
-						default: JSON_PARSE_CHECK(false);
+					else if(v->type() == ARRAY && index(t, v->a().size(), i) && i < v->a().size()) v = &v->a()[i];
+					else return NULL;
+				}
+				return last ? NULL : v;
+			}
+
+			// value is moved into place
+			static bool add(value_t& root, const tstring& path, value_t& value)
+			{
+				if(path.empty()) {
+					root = JSON_MOVE(value);
+					return true;
+				}
+				tstring last;
+				value_t* parent = resolve(root, path, &last);
+				size_t i;
+				if(!parent) return false;
+				if(parent->type() == OBJECT) parent->o()[last] = JSON_MOVE(value);
+				else if(parent->type() == ARRAY && index(last, parent->a().size(), i) && i <= parent->a().size()) parent->a().insert(parent->a().begin() + i, JSON_MOVE(value));
+				else return false;
+				return true;
+			}
+			static bool remove(value_t& root, const tstring& path)
+			{
+				tstring last;
+				value_t* parent = resolve(root, path, &last);
+				size_t i;
+				if(!parent) return false;
+				if(parent->type() == OBJECT) return parent->o().erase(last) == 1;
+				if(parent->type() != ARRAY || !index(last, parent->a().size(), i) || i >= parent->a().size()) return false;
+				parent->a().erase(parent->a().begin() + i);
+				return true;
+			}
+			static const value_t* member(const value_t& op, const char* key)
+			{
+				typename ObjectT<char_t, alloc_t>::const_iterator it = op.o().find(name(key));
+				return it == op.o().end() ? NULL : &it->second;
+			}
+			static void apply(value_t& v, const value_t& patch)
+			{
+				JSON_CHECK_TYPE(patch.type(), ARRAY);
+				for(size_t k = 0; k < patch.a().size(); ++k) {
+					const value_t& o = patch.a()[k];
+					JSON_ASSERT_CHECK1(o.type() == OBJECT, "Patch error: bad op #%zu.", k);
+					const value_t* type = member(o, "op");
+					const value_t* path = member(o, "path");
+					const value_t* value = member(o, "value");
+					const value_t* from = member(o, "from");
+					JSON_ASSERT_CHECK1(type && type->type() == STRING && path && path->type() == STRING, "Patch error: bad op #%zu.", k);
+					const tstring t(type->c_str(), static_cast<size_t>(type->length()));
+					const tstring p(path->c_str(), static_cast<size_t>(path->length()));
+					bool ok;
+					if(t == name("add")) {
+						JSON_ASSERT_CHECK1(value, "Patch error: bad op #%zu.", k);
+						value_t copy(*value);
+						ok = add(v, p, copy);
 					}
-					break;
-				case DIGIT_EXP:
-					switch(in[pos]) {
-						case_number_0_9:    break;
-						case_number_ending: goto GOTO_END;
+					else if(t == name("remove")) ok = remove(v, p);
+					else if(t == name("replace")) {
+						JSON_ASSERT_CHECK1(value, "Patch error: bad op #%zu.", k);
+						value_t* target = resolve(v, p, NULL);
+						if((ok = target != NULL)) {
+							value_t copy(*value);
+							*target = JSON_MOVE(copy);
+						}
+					}
+					else if(t == name("test")) {
+						JSON_ASSERT_CHECK1(value, "Patch error: bad op #%zu.", k);
+						const value_t* target = resolve(v, p, NULL);
+						JSON_ASSERT_CHECK1(target && same(*target, *value), "Patch error: test op #%zu failed.", k);
+						ok = true;
+					}
+					else {
+						const bool move = t == name("move");
+						JSON_ASSERT_CHECK1((move || t == name("copy")) && from && from->type() == STRING, "Patch error: bad op #%zu.", k);
+						const tstring f(from->c_str(), static_cast<size_t>(from->length()));
+						// a value can't be moved into one of its children
+						JSON_ASSERT_CHECK1(!move || p.size() <= f.size() || p[f.size()] != '/' || p.compare(0, f.size(), f), "Patch error: bad op #%zu.", k);
+						value_t* source = resolve(v, f, NULL);
+						if((ok = source != NULL) && !(move && p == f)) {
+							value_t copy;
+							if(move) {
+								copy = JSON_MOVE(*source);
+								remove(v, f);
+							}
+							else copy = *source;
+							ok = add(v, p, copy);
+						}
+					}
+					JSON_ASSERT_CHECK1(ok, "Patch error: path of op #%zu not found.", k);
+				}
+			}
+
+			static void merge(value_t& v, const value_t& patch)
+			{
+				if(patch.type() != OBJECT) {
+					v = patch;
+					return;
+				}
+				if(v.type() != OBJECT) v.clear(OBJECT);
+				ObjectT<char_t, alloc_t>& o = v.o();
+				for(typename ObjectT<char_t, alloc_t>::const_iterator it = patch.o().begin(); it != patch.o().end(); ++it) {
+					if(it->second.type() == NIL) o.erase(it->first);
+					else merge(o[it->first], it->second);
+				}
+			}
+#ifdef __XPJSON_SUPPORT_MOVE__
+			// nulls of a merged object which is new to the value are dropped
+			static void drop_nulls(value_t& v)
+			{
+				ObjectT<char_t, alloc_t>& o = v.o();
+				for(typename ObjectT<char_t, alloc_t>::iterator it = o.begin(); it != o.end(); ) {
+					if(it->second.type() == NIL) o.erase(it++);
+					else {
+						if(it->second.type() == OBJECT) drop_nulls(it->second);
+						++it;
 					}
-					break;
+				}
 			}
-			++pos;
-		}
-GOTO_END:
-		char_t* end = 0;
-		switch(state) {
-			case ZERO:
-			case DIGIT:
-				clear(INTEGER);
-				_i = detail::ttoi64<char_t>(in + start, &end);
-				JSON_PARSE_CHECK(end == in + pos);
-				return pos;
-			case DIGIT_FRAC:
-			case DIGIT_EXP:
-				clear(FLOAT);
-				_f = detail::ttod<char_t>(in + start, &end);
-				JSON_PARSE_CHECK(end == in + pos);
-				return pos;
-		}
-		JSON_PARSE_CHECK(false);
+			static void merge(value_t& v, value_t&& patch)
+			{
+				if(patch.type() != OBJECT || v.type() != OBJECT) {
+					const bool object = patch.type() == OBJECT;
+					v = JSON_MOVE(patch);
+					if(object) drop_nulls(v);
+					return;
+				}
+				ObjectT<char_t, alloc_t>& o = v.o();
+				for(typename ObjectT<char_t, alloc_t>::iterator it = patch.o().begin(); it != patch.o().end(); ++it) {
+					if(it->second.type() == NIL) o.erase(it->first);
+					else merge(o[it->first], JSON_MOVE(it->second));
+				}
+			}
+#endif
+		};
 	}
 
-	template<class char_t>
-	size_t ValueT<char_t>::read_nil(const char_t* in, size_t len, bool)
+	template<class char_t, class alloc_t>
+	void diff(const ValueT<char_t, alloc_t>& from, const ValueT<char_t, alloc_t>& to, ValueT<char_t, alloc_t>& patch)
 	{
-		size_t pos = 0;
-		while(pos < len) {
-			switch(in[pos]) {
-				case 'n':
-					JSON_PARSE_CHECK(len - pos >= detail::nil_null_length());
-					if(! memcmp(in + pos, detail::nil_null<char_t>(), detail::nil_null_length() * sizeof(char_t))) {
-						clear();
-						return pos + detail::nil_null_length();
-					}
-					break;
-				case_white_space: break;
-				default: JSON_PARSE_CHECK(false);
-			}
-			++pos;
-		}
-		JSON_PARSE_CHECK(false);
+		if(patch.type() != ARRAY) patch.clear(ARRAY);
+		typename ValueT<char_t, alloc_t>::tstring path;
+		detail::json_patch<char_t, alloc_t>::diff(from, to, path, patch);
 	}
 
-	template<class char_t>
-	size_t ValueT<char_t>::read_boolean(const char_t* in, size_t len, bool)
+	template<class char_t, class alloc_t>
+	void apply_patch(ValueT<char_t, alloc_t>& v, const ValueT<char_t, alloc_t>& patch)
 	{
-		size_t pos = 0;
-		while(pos < len) {
-			switch(in[pos]) {
-				case 't':
-					JSON_PARSE_CHECK(len - pos >= detail::boolean_true_length());
-					if(!memcmp(in + pos, detail::boolean<true, char_t>(), detail::boolean_true_length() * sizeof(char_t))) {
-						clear(BOOLEAN);
-						_b = true;
-						return pos + detail::boolean_true_length();
-					}
-					break;
-				case 'f':
-					JSON_PARSE_CHECK(len - pos >= detail::boolean_false_length());
-					if(!memcmp(in + pos, detail::boolean<false, char_t>(), detail::boolean_false_length() * sizeof(char_t))) {
-						clear(BOOLEAN);
-						_b = false;
-						return pos + detail::boolean_false_length();
-					}
-					break;
-				case_white_space: break;
-				default: JSON_PARSE_CHECK(false);
-			}
-			++pos;
-		}
-		JSON_PARSE_CHECK(false);
+		detail::json_patch<char_t, alloc_t>::apply(v, patch);
 	}
 
-#define OBJECT_ARRAY_PARSE_END(type) {									\
-		JSON_PARSE_CHECK(pv.back()->_type == type);						\
-		pv.pop_back();													\
-		if(pv.empty()) return pos + 1;/* Object/Array parse finished. */\
-		if(pv.back()->_type == OBJECT) state = OBJECT_PAIR_VALUE;		\
-		else if(pv.back()->_type == ARRAY) state = ARRAY_ELEM;			\
+	template<class char_t, class alloc_t>
+	void merge_patch(ValueT<char_t, alloc_t>& v, const ValueT<char_t, alloc_t>& patch)
+	{
+		detail::json_patch<char_t, alloc_t>::merge(v, patch);
 	}
 
-#define PUSH_VALUE_TO_STACK(type)										\
-	if(pv.back()->_type == NIL) pv.back()->clear(type);					\
-	else {																\
-		pv.back()->_a->push_back(JSON_MOVE(ValueT<char_t>(type)));		\
-		pv.push_back(&pv.back()->_a->back());							\
+#ifdef __XPJSON_SUPPORT_MOVE__
+	template<class char_t, class alloc_t>
+	void merge_patch(ValueT<char_t, alloc_t>& v, ValueT<char_t, alloc_t>&& patch)
+	{
+		detail::json_patch<char_t, alloc_t>::merge(v, JSON_MOVE(patch));
 	}
+#endif
+
+#define SKIP_WHITE_SPACE() while(pos < len && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\r' || in[pos] == '\t')) ++pos
 
-	template<class char_t>
-	size_t ValueT<char_t>::read(const char_t* in, size_t len, bool dma/* = true*/)
+	namespace detail
 	{
-		// Indicate current parse state
-		enum {NONE = 0,
-			OBJECT_LBRACE,          /* { */
-			OBJECT_PAIR_KEY_QUOTE,  /* {"," */
-			OBJECT_PAIR_KEY,        /* "..." */
-			OBJECT_PAIR_COLON,      /* "...": */
-			OBJECT_PAIR_VALUE,      /* "...":"..." */
-			OBJECT_COMMA,           /* {..., */
-			ARRAY_LBRACKET,         /* [ */
-			ARRAY_ELEM,             /* [...[...,... */
-			ARRAY_COMMA             /* [..., */
+		enum {JSON_BIND_STRUCT = 0, JSON_BIND_BOOLEAN, JSON_BIND_INTEGER, JSON_BIND_FLOAT};
+
+		template<class T> struct json_bind_kind
+		{
+			enum {value = json_is_same<T, bool>::value ? JSON_BIND_BOOLEAN : json_is_integral<T>::value ? JSON_BIND_INTEGER :
+				json_is_floating_point<T>::value ? JSON_BIND_FLOAT : JSON_BIND_STRUCT};
 		};
-		unsigned char state = NONE;
-		size_t pos = 0;
-		union {
-			size_t start;
-			size_t(ValueT<char_t>::*fp)(const char_t*, size_t, bool);
-		} u;
-		memset(&u, 0, sizeof(u));
-		vector<ValueT<char_t>*> pv(1, this);
-		while(pos < len) {
-			switch(state) {
-				case NONE:
-					// Topmost value parse.
-					switch(in[pos]) {
-						case '{': state = OBJECT_LBRACE;  clear(OBJECT); break;
-						case '[': state = ARRAY_LBRACKET; clear(ARRAY);  break;
-						case_white_space:                                break;
-						default: JSON_PARSE_CHECK(false);
+
+		// reads & writes a bound type, see the specializations below
+		template<class char_t, class alloc_t, class T, int kind = json_bind_kind<T>::value> struct json_binder;
+
+		// true if the value at in is null, pos is moved after it
+		template<class char_t>
+		inline bool json_bind_null(const char_t* in, size_t len, size_t& pos)
+		{
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] != 'n') return false;
+			JSON_PARSE_CHECK(len - pos >= nil_null_length() && !memcmp(in + pos, nil_null<char_t>(), nil_null_length() * sizeof(char_t)));
+			pos += nil_null_length();
+			return true;
+		}
+
+		template<class char_t, class alloc_t, class T>
+		struct json_bind_field
+		{
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+			tstring name;
+			tstring prefix; // ,"name":
+			virtual ~json_bind_field() {}
+			virtual size_t read(T& obj, const char_t* in, size_t len) const = 0;
+			virtual void write(const T& obj, tstring& out) const = 0;
+		};
+
+		template<class char_t, class alloc_t, class T, class M>
+		struct json_bind_member : public json_bind_field<char_t, alloc_t, T>
+		{
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+			explicit json_bind_member(M T::* m) : member(m) {}
+			size_t read(T& obj, const char_t* in, size_t len) const {return json_binder<char_t, alloc_t, M>::read(obj.*member, in, len);}
+			void write(const T& obj, tstring& out) const {json_binder<char_t, alloc_t, M>::write(obj.*member, out);}
+
+			M T::* member;
+		};
+
+		// fields of T with a perfect hash of their names, seed & size are searched until no slot collides
+		template<class char_t, class alloc_t, class T>
+		class json_bind_table
+		{
+		public:
+			typedef json_bind_field<char_t, alloc_t, T> field_t;
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+			static const json_bind_table& get()
+			{
+				static const json_bind_table table;
+				return table;
+			}
+
+			template<class M> void field(const char* name, M T::* member)
+			{
+				tstring key;
+				for(const char* p = name; *p; ++p) key += static_cast<char_t>(static_cast<unsigned char>(*p));
+				for(size_t i = 0; i < _fields.size(); ++i) JSON_ASSERT_CHECK1(_fields[i]->name != key, "Bind error: duplicate key %.200s.", name);
+				_fields.reserve(_fields.size() + 1);
+				field_t* f = new json_bind_member<char_t, alloc_t, T, M>(member);
+				f->name.swap(key);
+				f->prefix += ',';
+				f->prefix += '\"';
+				encode(f->name.data(), f->name.size(), f->prefix);
+				f->prefix += '\"';
+				f->prefix += ':';
+				_fields.push_back(f);
+			}
+
+			inline const field_t* find(const char_t* key, size_t n) const
+			{
+				const size_t i = _slots[hash(key, n, _seed) & _mask];
+				if(i >= _fields.size()) return 0;
+				const field_t* f = _fields[i];
+				return f->name.size() == n && !memcmp(f->name.data(), key, n * sizeof(char_t)) ? f : 0;
+			}
+
+			inline const std::vector<field_t*>& fields() const {return _fields;}
+
+		private:
+			json_bind_table() : _seed(0), _mask(0)
+			{
+				try {T::json_bind(*this);} catch(...) {clear(); throw;}
+				size_t size = 1;
+				while(size < _fields.size()) size <<= 1;
+				for(;; size <<= 1) {
+					// unique keys are separated long before, unless the hash is degenerate
+					if(size > (_fields.size() << 8)) {
+						clear();
+						JSON_ASSERT_CHECK(false, std::logic_error, "Bind error: no perfect hash of fields.");
 					}
-					break;
-				case OBJECT_LBRACE:
-				case OBJECT_COMMA:
-					switch(in[pos]) {
-						case '\"': state = OBJECT_PAIR_KEY_QUOTE; u.start = pos + 1; break;
-#if __XPJSON_SUPPORT_DANGLING_COMMA__
-						case '}': OBJECT_ARRAY_PARSE_END(OBJECT) break;
-#else
-						case '}':
-							if(state == OBJECT_LBRACE) OBJECT_ARRAY_PARSE_END(OBJECT)
-							else JSON_PARSE_CHECK(false);
-							break;
-#endif
-						case_white_space: break;
-						default: JSON_PARSE_CHECK(false);
+					_mask = size - 1;
+					for(_seed = 0; _seed < 256; ++_seed) {
+						_slots.assign(size, static_cast<size_t>(-1));
+						size_t i = 0;
+						for(; i < _fields.size(); ++i) {
+							size_t& slot = _slots[hash(_fields[i]->name.data(), _fields[i]->name.size(), _seed) & _mask];
+							if(slot != static_cast<size_t>(-1)) break;
+							slot = i;
+						}
+						if(i == _fields.size()) return;
 					}
-					break;
-				case OBJECT_PAIR_KEY_QUOTE:
-					switch(in[pos]) {
-						case '\\':
-							while(++pos < len) {
-								if(in[pos] == '\"' && in[pos - 1] != '\\') {
-									state = OBJECT_PAIR_KEY;
-									JSON_TSTRING(char_t) key;
-									detail::decode(in + u.start, pos - u.start, key);
-									pv.push_back(&(*pv.back()->_o)[JSON_MOVE(key)]);
-									break;
-								}
-							}
-							JSON_PARSE_CHECK(state == OBJECT_PAIR_KEY);
-							break;
-						case '\"':
-							state = OBJECT_PAIR_KEY;
-							// Insert a value
-							pv.push_back(&(*pv.back()->_o)[JSON_MOVE(JSON_TSTRING(char_t)(in + u.start, pos - u.start))]);
-							u.start = 0;
-							break;
-						default: break;
+				}
+			}
+			~json_bind_table() {clear();}
+			void clear()
+			{
+				for(size_t i = 0; i < _fields.size(); ++i) delete _fields[i];
+				_fields.clear();
+			}
+			json_bind_table(const json_bind_table&);
+			json_bind_table& operator=(const json_bind_table&);
+
+			static inline uint32_t hash(const char_t* s, size_t n, uint32_t seed)
+			{
+				uint32_t h = 2166136261U ^ (seed * 0x9E3779B9U);
+				for(size_t i = 0; i < n; ++i) h = (h ^ static_cast<uint32_t>(s[i])) * 16777619U;
+				return h ^ (h >> 15);
+			}
+
+			std::vector<field_t*> _fields;
+			std::vector<size_t> _slots;
+			uint32_t _seed;
+			size_t _mask;
+		};
+
+		template<class char_t, class alloc_t, class T>
+		struct json_binder<char_t, alloc_t, T, JSON_BIND_STRUCT>
+		{
+			typedef json_bind_table<char_t, alloc_t, T> table_t;
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+			static size_t read(T& obj, const char_t* in, size_t len)
+			{
+				const table_t& table = table_t::get();
+				size_t pos = 0;
+				if(json_bind_null(in, len, pos)) return pos;
+				JSON_PARSE_CHECK(in[pos] == '{');
+				++pos;
+				SKIP_WHITE_SPACE();
+				JSON_PARSE_CHECK(pos < len);
+				if(in[pos] == '}') return pos + 1;
+				tstring key;
+				for(;;) {
+					JSON_PARSE_CHECK(in[pos] == '\"');
+					const size_t start = ++pos;
+					bool escaped = false;
+					for(;; pos = std::min(pos + 2, len)) {
+						pos += json_find_quote(in + pos, len - pos);
+						JSON_PARSE_CHECK(pos < len);
+						if(in[pos] == '\"') break;
+						escaped = true;
 					}
-					break;
-				case OBJECT_PAIR_KEY:
-					switch(in[pos]) {
-						case ':': state = OBJECT_PAIR_COLON; break;
-						case_white_space:                    break;
-						default: JSON_PARSE_CHECK(false);
+					const typename table_t::field_t* f;
+					if(escaped) {
+						key.clear();
+						decode(in + start, pos - start, key);
+						f = table.find(key.data(), key.size());
 					}
-					break;
-				case OBJECT_PAIR_COLON:
-				case ARRAY_LBRACKET:
-				case ARRAY_COMMA:
-					switch(in[pos]) {
-						case '\"':                 u.fp = &ValueT::read_string;       break;
-						case '-': case_number_0_9: u.fp = &ValueT::read_number;       break;
-						case 't': case 'f':        u.fp = &ValueT::read_boolean;      break;
-						case 'n':                  u.fp = &ValueT::read_nil;          break;
-						case '{': state = OBJECT_LBRACE;  PUSH_VALUE_TO_STACK(OBJECT) break;
-						case '[': state = ARRAY_LBRACKET; PUSH_VALUE_TO_STACK(ARRAY)  break;
-						case ']':
+					else f = table.find(in + start, pos - start);
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+					++pos;
+					if(f) pos += f->read(obj, in + pos, len - pos);
+					else pos += json_skip(in + pos, len - pos);
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == '}') return pos + 1;
+					JSON_PARSE_CHECK(in[pos] == ',');
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+					if(in[pos] == '}') return pos + 1;
+#endif
+				}
+			}
+
+			static void write(const T& obj, tstring& out)
+			{
+				const std::vector<typename table_t::field_t*>& fields = table_t::get().fields();
+				out += '{';
+				for(size_t i = 0; i < fields.size(); ++i) {
+					out.append(fields[i]->prefix.data() + !i, fields[i]->prefix.size() - !i);
+					fields[i]->write(obj, out);
+				}
+				out += '}';
+			}
+		};
+
+		template<class char_t, class alloc_t, class T>
+		struct json_binder<char_t, alloc_t, T, JSON_BIND_BOOLEAN>
+		{
+			static size_t read(T& b, const char_t* in, size_t len)
+			{
+				ValueT<char_t, alloc_t> v;
+				const size_t pos = json_value_access::read_value(v, in, len);
+				if(v.type() != NIL) {JSON_CHECK_TYPE(v.type(), BOOLEAN); b = v.b();}
+				return pos;
+			}
+			static inline void write(T b, typename ValueT<char_t, alloc_t>::tstring& out)
+			{
+				out += (b ? boolean<true, char_t>() : boolean<false, char_t>());
+			}
+		};
+
+		// parse an integer of json text into sign and magnitude up to uint64_t, return chars consumed, 0 if it's not an integer
+		template<class char_t> size_t json_bind_integer(const char_t* in, size_t len, uint64_t& n, bool& negative)
+		{
+			size_t pos = 0;
+			while(pos < len && (in[pos] == ' ' || in[pos] == '\n' || in[pos] == '\r' || in[pos] == '\t')) ++pos;
+			negative = pos < len && in[pos] == '-';
+			if(negative) ++pos;
+			const size_t start = pos;
+			for(n = 0; pos < len && in[pos] >= '0' && in[pos] <= '9'; ++pos) {
+				const uint64_t digit = static_cast<uint64_t>(in[pos] - '0');
+				JSON_ASSERT_CHECK1(n <= (~static_cast<uint64_t>(0) - digit) / 10, "Range error: in=%.50s.", get_cstr(in, len).c_str());
+				n = n * 10 + digit;
+			}
+			// leading zeros, fractions and exponents are left to the parser
+			if(pos == start || (in[start] == '0' && pos - start > 1)) return 0;
+			if(pos < len && (in[pos] == '.' || in[pos] == 'e' || in[pos] == 'E')) return 0;
+			return pos;
+		}
+
+		template<class char_t, class alloc_t, class T>
+		struct json_binder<char_t, alloc_t, T, JSON_BIND_INTEGER>
+		{
+			enum {is_signed = static_cast<T>(-1) < static_cast<T>(0)};
+
+			static size_t read(T& i, const char_t* in, size_t len)
+			{
+				uint64_t n;
+				bool negative;
+				size_t pos = json_bind_integer(in, len, n, negative);
+				if(!pos) {
+					ValueT<char_t, alloc_t> v;
+					pos = json_value_access::read_value(v, in, len);
+					if(v.type() != NIL) JSON_CHECK_TYPE(v.type(), INTEGER);
+					return pos;
+				}
+				// values which don't fit T are rejected rather than truncated
+				const uint64_t max = is_signed ? ~static_cast<uint64_t>(0) >> (65 - 8 * sizeof(T)) : static_cast<uint64_t>(static_cast<T>(~static_cast<T>(0)));
+				JSON_ASSERT_CHECK1(negative && n ? is_signed && n - 1 <= max : n <= max, "Range error: in=%.50s.", get_cstr(in, len).c_str());
+				i = negative && n ? static_cast<T>(-static_cast<int64_t>(n - 1) - 1) : static_cast<T>(n);
+				return pos;
+			}
+			static inline void write(T i, typename ValueT<char_t, alloc_t>::tstring& out)
+			{
+				if(is_signed) to_string(static_cast<int64_t>(i), out);
+				else to_string(static_cast<uint64_t>(i), out);
+			}
+		};
+
+		template<class char_t, class alloc_t, class T>
+		struct json_binder<char_t, alloc_t, T, JSON_BIND_FLOAT>
+		{
+			static size_t read(T& f, const char_t* in, size_t len)
+			{
+				ValueT<char_t, alloc_t> v;
+				const size_t pos = json_value_access::read_value(v, in, len);
+				if(v.type() == INTEGER) f = static_cast<T>(v.i());
+				else if(v.type() != NIL) {JSON_CHECK_TYPE(v.type(), FLOAT); f = static_cast<T>(v.f());}
+				return pos;
+			}
+			static inline void write(T f, typename ValueT<char_t, alloc_t>::tstring& out) {to_string(static_cast<double>(f), out);}
+		};
+
+		// strings are decoded straight into the member
+		template<class char_t, class alloc_t, class traits_t, class salloc_t>
+		struct json_binder<char_t, alloc_t, basic_string<char_t, traits_t, salloc_t>, JSON_BIND_STRUCT>
+		{
+			static size_t read(basic_string<char_t, traits_t, salloc_t>& s, const char_t* in, size_t len)
+			{
+				size_t pos = 0;
+				if(json_bind_null(in, len, pos)) return pos;
+				if(in[pos] != '\"') {
+					ValueT<char_t, alloc_t> v;
+					json_value_access::read_value(v, in + pos, len - pos);
+					JSON_CHECK_TYPE(v.type(), STRING);
+				}
+				const size_t start = ++pos;
+				bool escaped = false;
+				for(;; pos = std::min(pos + 2, len)) {
+					pos += json_find_quote(in + pos, len - pos);
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == '\"') break;
+					escaped = true;
+				}
+				s.clear();
+				if(escaped) decode(in + start, pos - start, s);
+				else s.assign(in + start, pos - start);
+				return pos + 1;
+			}
+			template<class string_t> static inline void write(const basic_string<char_t, traits_t, salloc_t>& s, string_t& out)
+			{
+				out += '\"';
+				encode(s.data(), s.size(), out);
+				out += '\"';
+			}
+		};
+
+		template<class char_t, class alloc_t, class container_t>
+		struct json_bind_sequence
+		{
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+			typedef json_binder<char_t, alloc_t, typename container_t::value_type> element_t;
+
+			static size_t read(container_t& c, const char_t* in, size_t len)
+			{
+				size_t pos = 0;
+				if(json_bind_null(in, len, pos)) return pos;
+				JSON_PARSE_CHECK(in[pos] == '[');
+				c.clear();
+				++pos;
+				SKIP_WHITE_SPACE();
+				JSON_PARSE_CHECK(pos < len);
+				if(in[pos] == ']') return pos + 1;
+				for(;;) {
+					c.resize(c.size() + 1);
+					pos += element_t::read(c.back(), in + pos, len - pos);
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == ']') return pos + 1;
+					JSON_PARSE_CHECK(in[pos] == ',');
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
 #if __XPJSON_SUPPORT_DANGLING_COMMA__
-							if(state != OBJECT_PAIR_COLON)
-#else
-							if(state == ARRAY_LBRACKET)
+					if(in[pos] == ']') return pos + 1;
 #endif
-							  OBJECT_ARRAY_PARSE_END(ARRAY)
-							else JSON_PARSE_CHECK(false);
+				}
+			}
+
+			static void write(const container_t& c, tstring& out)
+			{
+				out += '[';
+				for(typename container_t::const_iterator it = c.begin(); it != c.end(); ++it) {
+					if(it != c.begin()) out += ',';
+					element_t::write(*it, out);
+				}
+				out += ']';
+			}
+		};
+
+		template<class char_t, class alloc_t, class T, class valloc_t>
+		struct json_binder<char_t, alloc_t, std::vector<T, valloc_t>, JSON_BIND_STRUCT> : public json_bind_sequence<char_t, alloc_t, std::vector<T, valloc_t> > {};
+		template<class char_t, class alloc_t, class T, class dalloc_t>
+		struct json_binder<char_t, alloc_t, std::deque<T, dalloc_t>, JSON_BIND_STRUCT> : public json_bind_sequence<char_t, alloc_t, std::deque<T, dalloc_t> > {};
+
+		template<class char_t, class alloc_t, class traits_t, class salloc_t, class T, class compare_t, class malloc_t>
+		struct json_binder<char_t, alloc_t, std::map<basic_string<char_t, traits_t, salloc_t>, T, compare_t, malloc_t>, JSON_BIND_STRUCT>
+		{
+			typedef std::map<basic_string<char_t, traits_t, salloc_t>, T, compare_t, malloc_t> map_t;
+			typedef json_binder<char_t, alloc_t, basic_string<char_t, traits_t, salloc_t> > key_t;
+			typedef typename ValueT<char_t, alloc_t>::tstring tstring;
+
+			static size_t read(map_t& m, const char_t* in, size_t len)
+			{
+				size_t pos = 0;
+				if(json_bind_null(in, len, pos)) return pos;
+				JSON_PARSE_CHECK(in[pos] == '{');
+				m.clear();
+				++pos;
+				SKIP_WHITE_SPACE();
+				JSON_PARSE_CHECK(pos < len);
+				if(in[pos] == '}') return pos + 1;
+				basic_string<char_t, traits_t, salloc_t> key;
+				for(;;) {
+					JSON_PARSE_CHECK(in[pos] == '\"');
+					pos += key_t::read(key, in + pos, len - pos);
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+					++pos;
+					pos += json_binder<char_t, alloc_t, T>::read(m[key], in + pos, len - pos);
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == '}') return pos + 1;
+					JSON_PARSE_CHECK(in[pos] == ',');
+					++pos;
+					SKIP_WHITE_SPACE();
+					JSON_PARSE_CHECK(pos < len);
+#if __XPJSON_SUPPORT_DANGLING_COMMA__
+					if(in[pos] == '}') return pos + 1;
+#endif
+				}
+			}
+
+			static void write(const map_t& m, tstring& out)
+			{
+				out += '{';
+				for(typename map_t::const_iterator it = m.begin(); it != m.end(); ++it) {
+					if(it != m.begin()) out += ',';
+					key_t::write(it->first, out);
+					out += ':';
+					json_binder<char_t, alloc_t, T>::write(it->second, out);
+				}
+				out += '}';
+			}
+		};
+
+		// untyped members keep the DOM
+		template<class char_t, class alloc_t>
+		struct json_binder<char_t, alloc_t, ValueT<char_t, alloc_t>, JSON_BIND_STRUCT>
+		{
+			static inline size_t read(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len) {return json_value_access::read_value(v, in, len);}
+			static inline void write(const ValueT<char_t, alloc_t>& v, typename ValueT<char_t, alloc_t>::tstring& out) {v.write(out);}
+		};
+	}
+
+	template<class char_t, class alloc_t>
+	template<class T>
+	size_t BinderT<char_t, alloc_t>::read(T& obj, const char_t* in, size_t len)
+	{
+		return detail::json_binder<char_t, alloc_t, T>::read(obj, in, len);
+	}
+
+	template<class char_t, class alloc_t>
+	template<class T>
+	void BinderT<char_t, alloc_t>::write(const T& obj, tstring& out)
+	{
+		detail::json_binder<char_t, alloc_t, T>::write(obj, out);
+	}
+
+	template<class char_t, class alloc_t>
+	void FormatterT<char_t, alloc_t>::write(const ValueT<char_t, alloc_t>& v, size_t depth, tstring& out) const
+	{
+		if(!_indent) {
+			v.write(out);
+			return;
+		}
+		switch(v.type()) {
+			case OBJECT: {
+					const ObjectT<char_t, alloc_t>& o = v.o();
+					out += '{';
+					if(o.empty()) {out += '}'; break;}
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
+						if(it != o.begin()) out += ',';
+						newline(depth + 1, out);
+						out += '\"';
+						detail::encode(it->first.c_str(), it->first.length(), out);
+						out += '\"';
+						out += ':';
+						out += ' ';
+						write(it->second, depth + 1, out);
+					}
+					newline(depth, out);
+				}
+				out += '}';
+				break;
+			case ARRAY: {
+					const ArrayT<char_t, alloc_t>& a = v.a();
+					if(_inline_width) {
+						// written on one line until a container or the width is met
+						const size_t mark = out.size();
+						out += '[';
+						size_t i = 0;
+						for(; i < a.size() && a[i].type() != OBJECT && a[i].type() != ARRAY && out.size() - mark <= _inline_width; ++i) {
+							if(i) {out += ','; out += ' ';}
+							a[i].write(out);
+						}
+						if(i == a.size() && out.size() - mark < _inline_width) {
+							out += ']';
 							break;
-						case_white_space: break;
-						default: JSON_PARSE_CHECK(false);
+						}
+						out.resize(mark);
 					}
-					if(u.fp) {
-						// If top elem is array, push a elem.
-						if(pv.back()->_type == ARRAY) {
-							pv.back()->_a->push_back(JSON_MOVE(ValueT<char_t>()));
-							pv.push_back(&pv.back()->_a->back());
+					out += '[';
+					if(a.empty()) {out += ']'; break;}
+					for(size_t i = 0; i < a.size(); ++i) {
+						if(i) out += ',';
+						newline(depth + 1, out);
+						write(a[i], depth + 1, out);
+					}
+					newline(depth, out);
+					out += ']';
+				}
+				break;
+			default: v.write(out); break;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	size_t FormatterT<char_t, alloc_t>::token(const char_t* in, size_t len, tstring& out)
+	{
+		size_t pos = 0;
+		if(in[pos] == '\"') {
+			for(++pos; ; pos = std::min(pos + 2, len)) {
+				pos += detail::json_find_quote(in + pos, len - pos);
+				JSON_PARSE_CHECK(pos < len);
+				if(in[pos] == '\"') break;
+			}
+			++pos;
+		}
+		else {
+			while(pos < len && in[pos] != ',' && in[pos] != ':' && in[pos] != '}' && in[pos] != ']' && in[pos] != '{' && in[pos] != '['
+				&& in[pos] != '\"' && in[pos] != ' ' && in[pos] != '\t' && in[pos] != '\r' && in[pos] != '\n') ++pos;
+			JSON_PARSE_CHECK(pos);
+		}
+		out.append(in, pos);
+		return pos;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t FormatterT<char_t, alloc_t>::inline_array(const char_t* in, size_t len, tstring& out) const
+	{
+		// 0 if the array doesn't fit in a line, nothing is appended then
+		const size_t mark = out.size();
+		size_t pos = 1;
+		out += '[';
+		for(;;) {
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] == '{' || in[pos] == '[') break;
+			if(in[pos] == ']') {
+				JSON_PARSE_CHECK(out.size() == mark + 1);
+				break;
+			}
+			pos += token(in + pos, len - pos, out);
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(out.size() - mark >= _inline_width) break;
+			if(in[pos] == ']') break;
+			JSON_PARSE_CHECK(in[pos] == ',');
+			++pos;
+			out += ',';
+			out += ' ';
+		}
+		if(in[pos] == ']' && out.size() - mark < _inline_width) {
+			out += ']';
+			return pos + 1;
+		}
+		out.resize(mark);
+		return 0;
+	}
+
+	template<class char_t, class alloc_t>
+	size_t FormatterT<char_t, alloc_t>::format(const char_t* in, size_t len, tstring& out) const
+	{
+		// brackets opened, and what's expected next: a value, a key, a colon, or a comma/closing bracket
+		enum {VALUE, KEY, COLON, NEXT};
+		tstring opened;
+		int expect = VALUE;
+		size_t pos = 0;
+		for(;;) {
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			switch(in[pos]) {
+				case '{': case '[': {
+						JSON_PARSE_CHECK(expect == VALUE);
+						expect = NEXT;
+						if(in[pos] == '[' && _inline_width) {
+							const size_t n = inline_array(in + pos, len - pos, out);
+							if(n) {
+								pos += n;
+								break;
+							}
 						}
-						// ++pos at last, so minus 1 here.
-						pos += (pv.back()->*u.fp)(in + pos, len - pos, dma) - 1;
-						u.fp = 0;
-						// pop nil/number/boolean/string Value
-						pv.pop_back();
-						JSON_PARSE_CHECK(!pv.empty());
-						switch(pv.back()->_type) {
-							case OBJECT: state = OBJECT_PAIR_VALUE; break;
-							case ARRAY:  state = ARRAY_ELEM;        break;
-							default: JSON_PARSE_CHECK(false);
+						const char_t end = in[pos] == '{' ? '}' : ']';
+						out += in[pos++];
+						SKIP_WHITE_SPACE();
+						JSON_PARSE_CHECK(pos < len);
+						if(in[pos] == end) {
+							out += in[pos++];
+							break;
 						}
+						opened += (end == '}' ? '{' : '[');
+						expect = end == '}' ? KEY : VALUE;
+						newline(opened.length(), out);
 					}
+					continue;
+				case '}': case ']':
+					JSON_PARSE_CHECK(expect == NEXT && !opened.empty() && opened[opened.length() - 1] == (in[pos] == '}' ? '{' : '['));
+					opened.resize(opened.length() - 1);
+					newline(opened.length(), out);
+					out += in[pos++];
 					break;
-				case OBJECT_PAIR_VALUE:
-					switch(in[pos]) {
-						case '}': OBJECT_ARRAY_PARSE_END(OBJECT)  break;
-						case ',': state = OBJECT_COMMA;           break;
-						case_white_space:                         break;
-						default: JSON_PARSE_CHECK(false);
+				case ',':
+					JSON_PARSE_CHECK(expect == NEXT && !opened.empty());
+					expect = opened[opened.length() - 1] == '{' ? KEY : VALUE;
+					out += in[pos++];
+					newline(opened.length(), out);
+					continue;
+				case ':':
+					JSON_PARSE_CHECK(expect == COLON);
+					expect = VALUE;
+					out += in[pos++];
+					if(_indent) out += ' ';
+					continue;
+				default:
+					JSON_PARSE_CHECK(expect == VALUE || (expect == KEY && in[pos] == '\"'));
+					pos += token(in + pos, len - pos, out);
+					if(expect == KEY) {
+						expect = COLON;
+						continue;
 					}
+					expect = NEXT;
 					break;
-				case ARRAY_ELEM:
-					switch(in[pos]) {
-						case ']': OBJECT_ARRAY_PARSE_END(ARRAY)  break;
-						case ',': state = ARRAY_COMMA;           break;
-						case_white_space:                        break;
-						default: JSON_PARSE_CHECK(false);
+			}
+			if(opened.empty()) return pos;
+		}
+	}
+
+	template<class char_t, class alloc_t>
+	SchemaT<char_t, alloc_t>::node::node()
+		: flags(0), types(~0U), minimum(0), maximum(0), exclusive_minimum(0), exclusive_maximum(0), multiple_of(0)
+		, min_length(0), max_length(npos), min_items(0), max_items(npos), min_properties(0), max_properties(npos)
+		, items(npos), additional_items(npos), additional(npos), required(0)
+	{
+	}
+
+	namespace detail
+	{
+		// compiling helpers of SchemaT
+		template<class char_t> inline bool json_schema_is(const char_t* key, size_t n, const char* keyword)
+		{
+			size_t i = 0;
+			for(; i < n && keyword[i]; ++i) if(key[i] != static_cast<char_t>(keyword[i])) return false;
+			return i == n && !keyword[i];
+		}
+
+		template<class char_t, class alloc_t> inline long double json_schema_number(const ValueT<char_t, alloc_t>& v, const char* keyword)
+		{
+			JSON_ASSERT_CHECK1(v.type() == INTEGER || v.type() == FLOAT, "Schema error: bad %s.", keyword);
+			return v.type() == INTEGER ? static_cast<long double>(v.i()) : v.f();
+		}
+
+		template<class char_t, class alloc_t> inline size_t json_schema_count(const ValueT<char_t, alloc_t>& v, const char* keyword)
+		{
+			JSON_ASSERT_CHECK1(v.type() == INTEGER && v.i() >= 0, "Schema error: bad %s.", keyword);
+			return static_cast<size_t>(v.i());
+		}
+
+		template<class char_t, class alloc_t> unsigned int json_schema_type(const ValueT<char_t, alloc_t>& v)
+		{
+			static const char* names[] = {"null", "boolean", "integer", "number", "string", "object", "array"};
+			static const unsigned int masks[] = {1U << NIL, 1U << BOOLEAN, (1U << INTEGER) | (1U << (RAW + 1)), (1U << INTEGER) | (1U << FLOAT), 1U << STRING, 1U << OBJECT, 1U << ARRAY};
+			if(v.type() == ARRAY) {
+				unsigned int types = 0;
+				for(typename ArrayT<char_t, alloc_t>::const_iterator it = v.a().begin(); it != v.a().end(); ++it) types |= json_schema_type(*it);
+				return types;
+			}
+			JSON_ASSERT_CHECK1(v.type() == STRING, "Schema error: bad %s.", "type");
+			for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+				if(json_schema_is(v.c_str(), static_cast<size_t>(v.length()), names[i])) return masks[i];
+			}
+			JSON_ASSERT_CHECK1(false, "Schema error: bad %s.", "type");
+			return 0;
+		}
+
+		struct json_schema_less
+		{
+			template<class pair_t> inline bool operator()(const pair_t& lhs, const pair_t& rhs) const {return lhs.first < rhs.first;}
+		};
+	}
+
+	template<class char_t, class alloc_t>
+	void SchemaT<char_t, alloc_t>::compile(const ValueT<char_t, alloc_t>& schema)
+	{
+		_nodes.clear();
+		compile_node(schema);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t SchemaT<char_t, alloc_t>::compile_node(const ValueT<char_t, alloc_t>& schema)
+	{
+		// nodes may be reallocated by children, so they are referred by index
+		const size_t n = _nodes.size();
+		_nodes.push_back(node());
+		if(schema.type() == BOOLEAN) {
+			_nodes[n].flags = schema.b() ? ANY : NEVER;
+			return n;
+		}
+		JSON_ASSERT_CHECK1(schema.type() == OBJECT, "Schema error: bad %s.", "schema");
+		std::vector<tstring> required;
+		std::vector<property_t> properties;
+		const ObjectT<char_t, alloc_t>& o = schema.o();
+		for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
+			const char_t* k = it->first.data();
+			const size_t kn = it->first.size();
+			const ValueT<char_t, alloc_t>& v = it->second;
+			if(detail::json_schema_is(k, kn, "type")) _nodes[n].types = detail::json_schema_type(v);
+			else if(detail::json_schema_is(k, kn, "enum")) {
+				JSON_ASSERT_CHECK1(v.type() == ARRAY, "Schema error: bad %s.", "enum");
+				_nodes[n].enums = v;
+				_nodes[n].flags |= HAS_ENUM;
+			}
+			else if(detail::json_schema_is(k, kn, "const")) {
+				_nodes[n].enums.clear(ARRAY);
+				_nodes[n].enums.a().push_back(v);
+				_nodes[n].flags |= HAS_ENUM;
+			}
+			else if(detail::json_schema_is(k, kn, "minimum")) {
+				_nodes[n].minimum = detail::json_schema_number(v, "minimum");
+				_nodes[n].flags |= HAS_MINIMUM;
+			}
+			else if(detail::json_schema_is(k, kn, "maximum")) {
+				_nodes[n].maximum = detail::json_schema_number(v, "maximum");
+				_nodes[n].flags |= HAS_MAXIMUM;
+			}
+			else if(detail::json_schema_is(k, kn, "exclusiveMinimum")) {
+				_nodes[n].exclusive_minimum = detail::json_schema_number(v, "exclusiveMinimum");
+				_nodes[n].flags |= EXCLUSIVE_MINIMUM;
+			}
+			else if(detail::json_schema_is(k, kn, "exclusiveMaximum")) {
+				_nodes[n].exclusive_maximum = detail::json_schema_number(v, "exclusiveMaximum");
+				_nodes[n].flags |= EXCLUSIVE_MAXIMUM;
+			}
+			else if(detail::json_schema_is(k, kn, "multipleOf")) {
+				_nodes[n].multiple_of = detail::json_schema_number(v, "multipleOf");
+				JSON_ASSERT_CHECK1(_nodes[n].multiple_of > 0, "Schema error: bad %s.", "multipleOf");
+				_nodes[n].flags |= MULTIPLE_OF;
+			}
+			else if(detail::json_schema_is(k, kn, "minLength"))     _nodes[n].min_length = detail::json_schema_count(v, "minLength");
+			else if(detail::json_schema_is(k, kn, "maxLength"))     _nodes[n].max_length = detail::json_schema_count(v, "maxLength");
+			else if(detail::json_schema_is(k, kn, "minItems"))      _nodes[n].min_items = detail::json_schema_count(v, "minItems");
+			else if(detail::json_schema_is(k, kn, "maxItems"))      _nodes[n].max_items = detail::json_schema_count(v, "maxItems");
+			else if(detail::json_schema_is(k, kn, "minProperties")) _nodes[n].min_properties = detail::json_schema_count(v, "minProperties");
+			else if(detail::json_schema_is(k, kn, "maxProperties")) _nodes[n].max_properties = detail::json_schema_count(v, "maxProperties");
+			else if(detail::json_schema_is(k, kn, "pattern")) {
+				JSON_ASSERT_CHECK1(v.type() == STRING, "Schema error: bad %s.", "pattern");
+#if __XPJSON_SUPPORT_REGEX__
+				_nodes[n].pattern.assign(v.c_str(), v.c_str() + v.length());
+				_nodes[n].flags |= HAS_PATTERN;
+#else
+				JSON_ASSERT_CHECK1(false, "Schema error: %s needs __XPJSON_SUPPORT_REGEX__.", "pattern");
+#endif
+			}
+			else if(detail::json_schema_is(k, kn, "items")) {
+				if(v.type() == ARRAY) {
+					for(typename ArrayT<char_t, alloc_t>::const_iterator e = v.a().begin(); e != v.a().end(); ++e) {
+						const size_t c = compile_node(*e);
+						_nodes[n].tuple.push_back(c);
 					}
-					break;
+				}
+				else {
+					const size_t c = compile_node(v);
+					_nodes[n].items = c;
+				}
+			}
+			else if(detail::json_schema_is(k, kn, "additionalItems")) {
+				const size_t c = compile_node(v);
+				_nodes[n].additional_items = c;
+			}
+			else if(detail::json_schema_is(k, kn, "additionalProperties")) {
+				const size_t c = compile_node(v);
+				_nodes[n].additional = c;
+			}
+			else if(detail::json_schema_is(k, kn, "properties")) {
+				JSON_ASSERT_CHECK1(v.type() == OBJECT, "Schema error: bad %s.", "properties");
+				for(typename ObjectT<char_t, alloc_t>::const_iterator m = v.o().begin(); m != v.o().end(); ++m) {
+					const property p = {compile_node(m->second), npos};
+					properties.push_back(property_t(m->first, p));
+				}
+			}
+			else if(detail::json_schema_is(k, kn, "required")) {
+				JSON_ASSERT_CHECK1(v.type() == ARRAY, "Schema error: bad %s.", "required");
+				for(typename ArrayT<char_t, alloc_t>::const_iterator e = v.a().begin(); e != v.a().end(); ++e) {
+					JSON_ASSERT_CHECK1(e->type() == STRING, "Schema error: bad %s.", "required");
+					required.push_back(tstring(e->c_str(), static_cast<size_t>(e->length())));
+				}
 			}
-			++pos;
 		}
-		JSON_PARSE_CHECK(false);
+
+		// required names join properties, so that a member is looked up once
+		node& s = _nodes[n];
+		for(size_t i = 0; i < required.size(); ++i) {
+			typename std::vector<property_t>::iterator it = properties.begin();
+			while(it != properties.end() && it->first != required[i]) ++it;
+			if(it == properties.end()) {
+				const property p = {npos, npos};
+				it = properties.insert(it, property_t(required[i], p));
+			}
+			if(it->second.required == npos) it->second.required = s.required++;
+		}
+		std::sort(properties.begin(), properties.end(), detail::json_schema_less());
+		s.properties.swap(properties);
+		// unconstrained subschemas are skipped as a whole
+		if(s.items != npos && (_nodes[s.items].flags & ANY)) s.items = npos;
+		if(s.additional_items != npos && (_nodes[s.additional_items].flags & ANY)) s.additional_items = npos;
+		if(s.additional != npos && (_nodes[s.additional].flags & ANY)) s.additional = npos;
+		for(size_t i = 0; i < s.properties.size(); ++i) {
+			if(s.properties[i].second.node != npos && (_nodes[s.properties[i].second.node].flags & ANY)) s.properties[i].second.node = npos;
+		}
+		if(!s.flags && s.types == ~0U && !s.min_length && s.max_length == npos && !s.min_items && s.max_items == npos
+			&& !s.min_properties && s.max_properties == npos && s.items == npos && s.additional_items == npos && s.additional == npos
+			&& s.tuple.empty() && !s.required) {
+			bool any = true;
+			for(size_t i = 0; any && i < s.properties.size(); ++i) any = s.properties[i].second.node == npos;
+			if(any) s.flags = ANY;
+		}
+		return n;
 	}
 
-#undef case_white_space
-#undef case_number_1_9
-#undef case_number_0_9
-#undef case_number_ending
-#undef OBJECT_ARRAY_PARSE_END
-#undef PUSH_VALUE_TO_STACK
+	template<class char_t, class alloc_t>
+	bool SchemaT<char_t, alloc_t>::validate(const ValueT<char_t, alloc_t>& v, std::string* error) const
+	{
+		path_t path;
+		const char* keyword = check_value(0, v, path);
+		if(keyword && error) format(keyword, path, *error);
+		return !keyword;
+	}
 
-	template<class char_t>
-	void WriterT<char_t>::write(const ObjectT<char_t>& o, JSON_TSTRING(char_t)& out)
+	template<class char_t, class alloc_t>
+	size_t SchemaT<char_t, alloc_t>::read(ValueT<char_t, alloc_t>& v, const char_t* in, size_t len, bool dma) const
 	{
-		out += '{';
-		for(typename ObjectT<char_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
-			out += '\"';
-			detail::encode(it->first.c_str(), it->first.length(), out);
-			out += '\"';
-			out += ':';
-			it->second.write(out);
-			out += ',';
+		path_t path;
+		return parse(0, &v, in, len, dma, path);
+	}
+
+	template<class char_t, class alloc_t>
+	size_t SchemaT<char_t, alloc_t>::check(const char_t* in, size_t len) const
+	{
+		path_t path;
+		return parse(0, 0, in, len, false, path);
+	}
+
+	template<class char_t, class alloc_t>
+	const typename SchemaT<char_t, alloc_t>::property* SchemaT<char_t, alloc_t>::find(const node& s, const char_t* key, size_t n) const
+	{
+		size_t low = 0, high = s.properties.size();
+		while(low < high) {
+			const size_t mid = (low + high) / 2;
+			const tstring& name = s.properties[mid].first;
+			const int c = name.compare(0, name.size(), key, n);
+			if(!c) return &s.properties[mid].second;
+			if(c < 0) low = mid + 1;
+			else high = mid;
 		}
-		if(out[out.length() - 1] != '{') out[out.length() - 1] = '}'; else out += '}';
+		return 0;
 	}
 
-	template<class char_t>
-	void WriterT<char_t>::write(const ArrayT<char_t>& a, JSON_TSTRING(char_t)& out)
+	template<class char_t, class alloc_t>
+	const char* SchemaT<char_t, alloc_t>::check_number(const node& s, long double x) const
 	{
-		out += '[';
-		for(size_t i = 0; i < a.size(); ++i) {
-			a[i].write(out);
-			out += ',';
+		if((s.flags & HAS_MINIMUM) && x < s.minimum) return "minimum";
+		if((s.flags & HAS_MAXIMUM) && x > s.maximum) return "maximum";
+		if((s.flags & EXCLUSIVE_MINIMUM) && x <= s.exclusive_minimum) return "exclusiveMinimum";
+		if((s.flags & EXCLUSIVE_MAXIMUM) && x >= s.exclusive_maximum) return "exclusiveMaximum";
+		if(s.flags & MULTIPLE_OF) {
+			const long double q = x / s.multiple_of;
+			if(fabs(q - floor(q + 0.5)) > 1e-9) return "multipleOf";
 		}
-		if(out[out.length() - 1] != '[') out[out.length() - 1] = ']'; else out += ']';
+		return 0;
 	}
 
-	template<class char_t>
-	bool operator==(const ObjectT<char_t>& lhs, const ObjectT<char_t>& rhs)
+	template<class char_t, class alloc_t>
+	const char* SchemaT<char_t, alloc_t>::check_string(const node& s, const char_t* str, size_t n) const
 	{
-		if(lhs.size() != rhs.size()) return false;
-		typename ObjectT<char_t>::const_iterator lit = lhs.begin();
-		typename ObjectT<char_t>::const_iterator rit = rhs.begin();
-		for(; lit != lhs.end(); ++lit, ++rit) {
-			if(lit->first != rit->first || lit->second != rit->second) return false;
+		if(s.min_length || s.max_length != npos) {
+			// bytes & units are upper bounds of code points
+			if(n < s.min_length) return "minLength";
+			const size_t points = (n > s.max_length || n / 4 < s.min_length) ? detail::json_code_points(str, n) : n;
+			if(points < s.min_length) return "minLength";
+			if(points > s.max_length) return "maxLength";
 		}
-		return true;
+#if __XPJSON_SUPPORT_REGEX__
+		if((s.flags & HAS_PATTERN) && !std::regex_search(str, str + n, s.pattern)) return "pattern";
+#endif
+		return 0;
 	}
 
-	template<class char_t>
-	bool operator==(const ArrayT<char_t>& lhs, const ArrayT<char_t>& rhs)
+	template<class char_t, class alloc_t>
+	const char* SchemaT<char_t, alloc_t>::check_value(size_t n, const ValueT<char_t, alloc_t>& v, path_t& path) const
 	{
-		if(lhs.size() != rhs.size()) return false;
-		for(size_t i = 0; i < lhs.size(); ++i) {
-			if(lhs[i] != rhs[i]) return false;
+		const node& s = _nodes[n];
+		if(s.flags & ANY) return 0;
+		if(s.flags & NEVER) return "false";
+		const Type type = v.type();
+		if(!(s.types & (1U << type)) && !(type == FLOAT && (s.types & INTEGRAL) && v.f() == floor(v.f()))) return "type";
+		if(s.flags & HAS_ENUM) {
+			const ArrayT<char_t, alloc_t>& enums = s.enums.a();
+			typename ArrayT<char_t, alloc_t>::const_iterator it = enums.begin();
+			for(; it != enums.end(); ++it) {
+				// 1 & 1.0 are the same number
+				if((type == INTEGER || type == FLOAT) && (it->type() == INTEGER || it->type() == FLOAT)) {
+					if(detail::json_schema_number(*it, "enum") == detail::json_schema_number(v, "enum")) break;
+				}
+				else if(*it == v) break;
+			}
+			if(it == enums.end()) return "enum";
 		}
-		return true;
+		switch(type) {
+			case INTEGER: return check_number(s, static_cast<long double>(v.i()));
+			case FLOAT:   return check_number(s, v.f());
+			case STRING:  return check_string(s, v.c_str(), static_cast<size_t>(v.length()));
+			case ARRAY: {
+					const ArrayT<char_t, alloc_t>& a = v.a();
+					if(a.size() < s.min_items) return "minItems";
+					if(a.size() > s.max_items) return "maxItems";
+					for(size_t i = 0; i < a.size(); ++i) {
+						const size_t c = i < s.tuple.size() ? s.tuple[i] : s.tuple.empty() ? s.items : s.additional_items;
+						if(c == npos) continue;
+						const token t = {0, 0, i};
+						path.push_back(t);
+						if(const char* keyword = check_value(c, a[i], path)) return keyword;
+						path.pop_back();
+					}
+				}
+				break;
+			case OBJECT: {
+					const ObjectT<char_t, alloc_t>& o = v.o();
+					if(o.size() < s.min_properties) return "minProperties";
+					if(o.size() > s.max_properties) return "maxProperties";
+					if(s.required) {
+						for(size_t i = 0; i < s.properties.size(); ++i) {
+							if(s.properties[i].second.required != npos && o.find(s.properties[i].first) == o.end()) return "required";
+						}
+					}
+					for(typename ObjectT<char_t, alloc_t>::const_iterator it = o.begin(); it != o.end(); ++it) {
+						const property* p = find(s, it->first.data(), it->first.size());
+						const size_t c = p ? p->node : s.additional;
+						if(c == npos) continue;
+						const token t = {it->first.data(), it->first.size(), 0};
+						path.push_back(t);
+						if(const char* keyword = check_value(c, it->second, path)) return keyword;
+						path.pop_back();
+					}
+				}
+				break;
+			default: break;
+		}
+		return 0;
 	}
 
-	template<class char_t>
-	bool operator==(const ValueT<char_t>& lhs, const ValueT<char_t>& rhs)
+	template<class char_t, class alloc_t>
+	size_t SchemaT<char_t, alloc_t>::parse(size_t n, ValueT<char_t, alloc_t>* out, const char_t* in, size_t len, bool dma, path_t& path) const
 	{
-		if(lhs.type() != rhs.type()) return false;
-		switch(lhs.type()) {
-			case NIL:     return true;
-			case BOOLEAN: return lhs.b() == rhs.b();
-			case INTEGER: return lhs.i() == rhs.i();
-			case FLOAT:   return fabs(lhs.f() - rhs.f()) < JSON_EPSILON;
-			case STRING:  return lhs.length() == rhs.length() && !memcmp(lhs.c_str(), rhs.c_str(), lhs.length());
-			case OBJECT:  return lhs.o() == rhs.o();
-			case ARRAY:   return lhs.a() == rhs.a();
+		const node& s = _nodes[n];
+		if(s.flags & ANY) return out ? detail::json_value_access::read_value(*out, in, len, dma) : detail::json_skip(in, len);
+		if(s.flags & NEVER) fail("false", path);
+		size_t pos = 0;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		if((in[pos] != '{' && in[pos] != '[') || (s.flags & HAS_ENUM)) {
+			// scalars & enumerated values are checked after parsed
+			ValueT<char_t, alloc_t> value;
+			ValueT<char_t, alloc_t>& v = out ? *out : value;
+			pos += detail::json_value_access::read_value(v, in + pos, len - pos, dma);
+			if(const char* keyword = check_value(n, v, path)) fail(keyword, path);
+			return pos;
 		}
-		return true;
+		// containers are checked while parsed, rejected before their remaining members
+		const bool object = in[pos] == '{';
+		if(!(s.types & (1U << (object ? OBJECT : ARRAY)))) fail("type", path);
+		if(out) out->clear(object ? OBJECT : ARRAY);
+		const char_t end = object ? '}' : ']';
+		++pos;
+		SKIP_WHITE_SPACE();
+		JSON_PARSE_CHECK(pos < len);
+		size_t count = 0;
+		std::vector<bool> seen;
+		size_t found = 0;
+		tstring key;
+		// properties are distinct keys like validate, repeated ones are counted once
+		const bool distinct = object && (s.min_properties || s.max_properties != npos);
+		std::vector<tstring> keys;
+		size_t properties = 0;
+		while(in[pos] != end) {
+			if(++count > s.max_items && !object) fail("maxItems", path);
+			ValueT<char_t, alloc_t>* child = 0;
+			size_t c;
+			token t = {0, 0, count - 1};
+			if(object) {
+				JSON_PARSE_CHECK(in[pos] == '\"');
+				const size_t start = ++pos;
+				bool escaped = false;
+				for(;; pos = std::min(pos + 2, len)) {
+					pos += detail::json_find_quote(in + pos, len - pos);
+					JSON_PARSE_CHECK(pos < len);
+					if(in[pos] == '\"') break;
+					escaped = true;
+				}
+				t.key = in + start;
+				t.n = pos - start;
+				if(escaped || out) {
+					key.clear();
+					if(escaped) detail::decode(in + start, pos - start, key);
+					else key.assign(in + start, pos - start);
+					t.key = key.data();
+					t.n = key.size();
+				}
+				++pos;
+				SKIP_WHITE_SPACE();
+				JSON_PARSE_CHECK(pos < len && in[pos] == ':');
+				++pos;
+				const property* p = find(s, t.key, t.n);
+				c = p ? p->node : s.additional;
+				if(p && p->required != npos) {
+					if(seen.empty()) seen.resize(s.required);
+					if(!seen[p->required]) {seen[p->required] = true; ++found;}
+				}
+				if(out) child = &out->o()[key];
+				if(distinct) {
+					if(out) properties = out->o().size();
+					else {
+						const tstring k(t.key, t.n);
+						typename std::vector<tstring>::iterator it = std::lower_bound(keys.begin(), keys.end(), k);
+						if(it == keys.end() || *it != k) {
+							keys.insert(it, k);
+							++properties;
+						}
+					}
+					if(properties > s.max_properties) fail("maxProperties", path);
+				}
+			}
+			else {
+				const size_t i = count - 1;
+				c = i < s.tuple.size() ? s.tuple[i] : s.tuple.empty() ? s.items : s.additional_items;
+				if(out) {
+					out->a().push_back(ValueT<char_t, alloc_t>());
+					child = &out->a().back();
+				}
+			}
+			path.push_back(t);
+			if(c != npos) pos += parse(c, child, in + pos, len - pos, dma, path);
+			else pos += child ? detail::json_value_access::read_value(*child, in + pos, len - pos, dma) : detail::json_skip(in + pos, len - pos);
+			path.pop_back();
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+			if(in[pos] == end) break;
+			JSON_PARSE_CHECK(in[pos] == ',');
+			++pos;
+			SKIP_WHITE_SPACE();
+			JSON_PARSE_CHECK(pos < len);
+#if !__XPJSON_SUPPORT_DANGLING_COMMA__
+			JSON_PARSE_CHECK(in[pos] != end);
+#endif
+		}
+		if(object) {
+			if(properties < s.min_properties) fail("minProperties", path);
+			if(found < s.required) fail("required", path);
+		}
+		else if(count < s.min_items) fail("minItems", path);
+		return pos + 1;
+	}
+
+	template<class char_t, class alloc_t>
+	void SchemaT<char_t, alloc_t>::format(const char* keyword, const path_t& path, std::string& out)
+	{
+		tstring pointer;
+		pointer += '#';
+		for(size_t i = 0; i < path.size(); ++i) {
+			pointer += '/';
+			if(!path[i].key) {
+				detail::to_string(static_cast<int64_t>(path[i].index), pointer);
+				continue;
+			}
+			for(size_t j = 0; j < path[i].n; ++j) {
+				switch(path[i].key[j]) {
+					case '~': pointer += '~'; pointer += '0'; break;
+					case '/': pointer += '~'; pointer += '1'; break;
+					default:  pointer += path[i].key[j];      break;
+				}
+			}
+		}
+		out = keyword;
+		out += " at ";
+		out += detail::get_cstr(pointer.data(), pointer.size());
+	}
+
+	template<class char_t, class alloc_t>
+	void SchemaT<char_t, alloc_t>::fail(const char* keyword, const path_t& path)
+	{
+		std::string error;
+		format(keyword, path, error);
+		JSON_ASSERT_CHECK1(false, "Schema error: %.200s.", error.c_str());
 	}
 }
 
+#undef SKIP_WHITE_SPACE
+
 #endif // __XPJSON_HPP__
\ No newline at end of file